@@ -0,0 +1,394 @@
+/**
+ * @file base64.c
+ * @author Daniel Avisse (djavisse)
+ * This is the base64 component and is the main component of libbase64. This component
+ * encodes and decodes buffers in memory, either all at once or one block at a time,
+ * using the codec for whole groups and a State24 for the groups split between blocks.
+ * Nothing in this component allocates memory, the caller supplies every buffer and can
+ * use the length functions to work out how big they need to be. The encode and decode
+ * programs are built on top of this component.
+ */
+
+#include "base64.h"
+#include "codec.h"
+
+/** The most equal signs that can pad the last group */
+#define MAX_PADDING 2
+
+size_t encodedLength ( size_t length, bool wrap, bool padding )
+{
+    Encoder encoder;
+    initEncoder( &encoder, wrap, padding );
+    return encoderLength( &encoder, length );
+}
+
+size_t encoderLength ( Encoder const *encoder, size_t length )
+{
+    //Every 3 bytes become 4 chars, the bytes left at the end are padded up to 4 chars
+    size_t chars = length / MAX_NUMBER_OF_BYTES * MAX_NUMBER_OF_CHARS;
+    size_t leftover = length % MAX_NUMBER_OF_BYTES;
+    if ( leftover > 0 ) {
+        chars += encoder->padding ? MAX_NUMBER_OF_CHARS : leftover + 1;
+    }
+    //Add a line ending between each full line and at the end
+    size_t lineBreaks = 0;
+    if ( encoder->lineLength > 0 && chars > 0 ) {
+        lineBreaks = ( chars - 1 ) / encoder->lineLength;
+    }
+    return chars + ( lineBreaks + 1 ) * encoder->endingLength;
+}
+
+size_t encoderOffset ( Encoder const *encoder, size_t offset )
+{
+    size_t chars = offset / MAX_NUMBER_OF_BYTES * MAX_NUMBER_OF_CHARS;
+    if ( encoder->lineLength == 0 || chars == 0 ) {
+        return chars;
+    }
+    return chars + ( chars - 1 ) / encoder->lineLength * encoder->endingLength;
+}
+
+size_t decodedCharsLength ( size_t chars )
+{
+    //Every 4 chars make 3 bytes, and 2 or 3 chars left at the end make 1 or 2 bytes
+    size_t length = chars / MAX_NUMBER_OF_CHARS * MAX_NUMBER_OF_BYTES;
+    if ( chars % MAX_NUMBER_OF_CHARS > 1 ) {
+        length += chars % MAX_NUMBER_OF_CHARS - 1;
+    }
+    return length;
+}
+
+size_t decodedLength ( char const data[], size_t length )
+{
+    //Count the newlines and equal signs, since they don't decode to any bits
+    size_t skipped = 0;
+    for ( size_t i = 0; i < length; i++ ) {
+        skipped += data[i] == '\n' || data[i] == '=';
+    }
+    return decodedCharsLength( length - skipped );
+}
+
+/**
+ * This function is a helper function that adds the line ending into the output buffer.
+ * @param encoder The Encoder holding the line ending
+ * @param output The buffer that will get the encoded chars
+ * @param outCount The number of chars currently in the output buffer
+ */
+static void addEnding ( Encoder *encoder, char output[], size_t *outCount )
+{
+    memcpy( output + *outCount, encoder->ending, encoder->endingLength );
+    *outCount += encoder->endingLength;
+}
+
+/**
+ * This function is a helper function that adds one encoded char into the output buffer.
+ * If line breaks are being used then the line ending is added before the char once the
+ * current line is full. The line position is kept in the Encoder so
+ * the line breaks stay in the right place across blocks.
+ * @param encoder The Encoder holding the line position
+ * @param ch The encoded char being added to the output buffer
+ * @param output The buffer that will get the encoded chars
+ * @param outCount The number of chars currently in the output buffer
+ */
+static void addEncodedChar ( Encoder *encoder, char ch, char output[], size_t *outCount )
+{
+    //Add a line break before the char if the line is full
+    if ( encoder->lineLength > 0 ) {
+        if ( encoder->charCount == encoder->lineLength ) {
+            addEnding( encoder, output, outCount );
+            encoder->charCount = 0;
+        }
+        encoder->charCount++;
+    }
+    output[( *outCount )++] = ch;
+}
+
+void initEncoder ( Encoder *encoder, bool wrap, bool padding )
+{
+    initEncoderLines( encoder, wrap ? DEFAULT_LINE_LENGTH : 0, false, padding );
+}
+
+void initEncoderLines ( Encoder *encoder, size_t lineLength, bool crlf, bool padding )
+{
+    initState( &encoder->state );
+    encoder->charCount = 0;
+    encoder->lineLength = lineLength;
+    encoder->endingLength = 0;
+    if ( crlf ) {
+        encoder->ending[encoder->endingLength++] = '\r';
+    }
+    encoder->ending[encoder->endingLength++] = '\n';
+    encoder->padding = padding;
+}
+
+size_t encodeUpdate ( Encoder *encoder, byte const data[], size_t length, char output[] )
+{
+    State24 *state = &encoder->state;
+    size_t outCount = 0;
+    //Create a miniBuffer that will temporarily hold the chars from the State24
+    char miniCharbuffer[MAX_NUMBER_OF_CHARS];
+    int miniCharBufferCount = 0;
+    size_t i = 0;
+    //Finish the group left in the State24 from the last block one byte at a time
+    while ( state->byteCount > 0 && i < length ) {
+        addByte( state, data[i++] );
+        //Get the chars from the State24 once it has the max amount of bytes
+        if ( state->byteCount == MAX_NUMBER_OF_BYTES ) {
+            miniCharBufferCount = getChars( state, miniCharbuffer );
+            for ( int j = 0; j < miniCharBufferCount; j++ ) {
+                addEncodedChar( encoder, miniCharbuffer[j], output, &outCount );
+            }
+        }
+    }
+    //Encode all the whole groups at once if there are no line breaks
+    size_t groups = ( length - i ) / MAX_NUMBER_OF_BYTES;
+    if ( encoder->lineLength == 0 ) {
+        outCount += encodeGroups( data + i, groups, output + outCount );
+        i += groups * MAX_NUMBER_OF_BYTES;
+    }
+    //Otherwise encode the whole groups up to the end of each line
+    else {
+        size_t lineGroups = encoder->lineLength / MAX_NUMBER_OF_CHARS;
+        while ( groups > 0 ) {
+            //Start a new line if the current line is full
+            if ( encoder->charCount == encoder->lineLength ) {
+                addEnding( encoder, output, &outCount );
+                encoder->charCount = 0;
+            }
+            //Encode the full lines with more groups after them in one pass, along with
+            //their line endings, leaving the ending of the last line for the next group
+            if ( encoder->charCount == 0 && groups > lineGroups ) {
+                size_t lines = ( groups - 1 ) / lineGroups;
+                outCount += encodeLines( data + i, lines, lineGroups, encoder->ending,
+                                         encoder->endingLength, output + outCount );
+                i += lines * lineGroups * MAX_NUMBER_OF_BYTES;
+                groups -= lines * lineGroups;
+            }
+            //Encode the groups up to the end of the current line
+            size_t count = ( encoder->lineLength - encoder->charCount ) / MAX_NUMBER_OF_CHARS;
+            if ( count > groups ) {
+                count = groups;
+            }
+            outCount += encodeGroups( data + i, count, output + outCount );
+            encoder->charCount += count * MAX_NUMBER_OF_CHARS;
+            i += count * MAX_NUMBER_OF_BYTES;
+            groups -= count;
+        }
+    }
+    //Add the bytes that don't make up a whole group into the State24
+    while ( i < length ) {
+        addByte( state, data[i++] );
+    }
+    return outCount;
+}
+
+size_t encodeFinish ( Encoder *encoder, char output[] )
+{
+    size_t outCount = 0;
+    //Encode the bytes left in the State24 when the end of the input is reached
+    if ( encoder->state.byteCount > 0 ) {
+        char miniCharbuffer[MAX_NUMBER_OF_CHARS];
+        int miniCharBufferCount = getChars( &encoder->state, miniCharbuffer );
+        for ( int j = 0; j < MAX_NUMBER_OF_CHARS; j++ ) {
+            //Add the chars into the output
+            if ( j < miniCharBufferCount ) {
+                addEncodedChar( encoder, miniCharbuffer[j], output, &outCount );
+            }
+            //Add the equal signs at the end of the input if padding is used
+            else if ( encoder->padding ) {
+                addEncodedChar( encoder, '=', output, &outCount );
+            }
+        }
+    }
+    //Print a line ending at the end
+    addEnding( encoder, output, &outCount );
+    return outCount;
+}
+
+bool resumeEncoder ( Encoder *encoder, char const tail[], size_t length, size_t total,
+                     size_t *keep )
+{
+    //An empty output has nothing to carry on from
+    *keep = 0;
+    if ( total == 0 ) {
+        return true;
+    }
+    //The output has to end with the line ending
+    size_t endingLength = encoder->endingLength;
+    if ( length < endingLength || length > total ||
+         memcmp( tail + length - endingLength, encoder->ending, endingLength ) != 0 ) {
+        return false;
+    }
+    size_t end = length - endingLength;
+    //Find the chars in the last line, the whole output is one line if it isn't broken
+    size_t lineChars = total - endingLength;
+    if ( encoder->lineLength > 0 ) {
+        size_t start = end;
+        while ( start > 0 && tail[start - 1] != '\n' ) {
+            start--;
+        }
+        //The last line has to start where it would if every line before it was full
+        size_t lineStart = total - length + start;
+        if ( ( start == 0 && lineStart > 0 ) ||
+             lineStart % ( encoder->lineLength + endingLength ) != 0 ||
+             ( start > 0 && memcmp( tail + start - endingLength, encoder->ending,
+                                    endingLength ) != 0 ) ) {
+            return false;
+        }
+        lineChars = end - start;
+        if ( lineChars > encoder->lineLength ) {
+            return false;
+        }
+    }
+    //Only the output of an empty input has an empty last line
+    if ( lineChars == 0 ) {
+        return total == endingLength;
+    }
+    //Find the last group if it isn't whole, with its padding if it has any
+    int padding = 0;
+    while ( padding < MAX_PADDING && padding < end &&
+            tail[end - 1 - padding] == '=' ) {
+        padding++;
+    }
+    size_t groupChars = padding > 0 ? MAX_NUMBER_OF_CHARS : lineChars % MAX_NUMBER_OF_CHARS;
+    if ( groupChars == 1 || groupChars > end ||
+         ( padding > 0 && ( lineChars % MAX_NUMBER_OF_CHARS != 0 || !encoder->padding ) ) ||
+         ( padding == 0 && groupChars > 0 && encoder->padding ) ) {
+        return false;
+    }
+    //Decode the chars of the group back into the bytes they came from
+    char const *group = tail + end - groupChars;
+    State24 state;
+    initState( &state );
+    for ( int i = 0; i < groupChars - padding; i++ ) {
+        if ( !validChar( group[i] ) ) {
+            return false;
+        }
+        addChar( &state, group[i] );
+    }
+    byte bytes[MAX_NUMBER_OF_BYTES];
+    int count = getBytes( &state, bytes );
+    //The bytes have to encode back into the same chars, or the last bits weren't zero
+    for ( int i = 0; i < count; i++ ) {
+        addByte( &state, bytes[i] );
+    }
+    char chars[MAX_NUMBER_OF_CHARS];
+    if ( count > 0 && ( getChars( &state, chars ) != groupChars - padding ||
+                        memcmp( chars, group, groupChars - padding ) != 0 ) ) {
+        return false;
+    }
+    //Put the bytes back into the Encoder and carry on from where the group starts
+    for ( int i = 0; i < count; i++ ) {
+        addByte( &encoder->state, bytes[i] );
+    }
+    encoder->charCount = lineChars - groupChars;
+    *keep = end - groupChars;
+    return true;
+}
+
+size_t encodeBase64 ( byte const data[], size_t length, char output[], bool wrap,
+                      bool padding )
+{
+    Encoder encoder;
+    initEncoder( &encoder, wrap, padding );
+    size_t outCount = encodeUpdate( &encoder, data, length, output );
+    return outCount + encodeFinish( &encoder, output + outCount );
+}
+
+void initDecoder ( Decoder *decoder )
+{
+    initDecoderLenient( decoder, false );
+}
+
+void initDecoderLenient ( Decoder *decoder, bool lenient )
+{
+    initState( &decoder->state );
+    decoder->equalFlag = false;
+    decoder->lenient = lenient;
+}
+
+/**
+ * This function is a helper function that decodes one block of chars where the only
+ * chars that are skipped are newlines. Whole groups up to each newline are decoded using
+ * the codec, and everything else goes through the State24.
+ * @param decoder The Decoder holding where the last block left off
+ * @param data The chars being decoded
+ * @param length The number of chars
+ * @param output The buffer that will get the decoded bytes
+ * @param outCount The number of bytes in the output buffer, this is added to
+ * @return true If all the chars were valid
+ * @return false If an invalid char was found
+ */
+static bool decodeChars ( Decoder *decoder, char const data[], size_t length, byte output[],
+                          size_t *outCount )
+{
+    State24 *state = &decoder->state;
+    size_t i = 0;
+    while ( i < length ) {
+        //Decode whole groups of chars up to the next newline using the lookup tables
+        if ( state->bitCount == 0 && !decoder->equalFlag ) {
+            char const *newline = ( char const * )memchr( data + i, '\n', length - i );
+            size_t run = ( newline ? ( size_t )( newline - data ) : length ) - i;
+            size_t groups = decodeGroups( data + i, run / MAX_NUMBER_OF_CHARS,
+                                          output + *outCount );
+            i += groups * MAX_NUMBER_OF_CHARS;
+            *outCount += groups * MAX_NUMBER_OF_BYTES;
+            if ( i == length ) {
+                break;
+            }
+        }
+        //Handle the next char using the State24
+        char ch = data[i++];
+        //If the char is valid and doesn't come after a equal sign then add it to the State24
+        if ( validChar( ch ) && !decoder->equalFlag ) {
+            addChar( state, ch );
+            //If the State24 has reached max bit count, then get bytes from it
+            if ( state->bitCount == MAX_NUMBER_OF_BITS ) {
+                *outCount += getBytes( state, output + *outCount );
+            }
+        }
+        //Set the equal flag to true once an equal sign is found
+        else if ( ch == '=' ) {
+            decoder->equalFlag = true;
+        }
+        //The char wasn't valid or a newline
+        else if ( ch != '\n' ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool decodeUpdate ( Decoder *decoder, char const data[], size_t length, byte output[],
+                    size_t *outCount )
+{
+    if ( !decoder->lenient ) {
+        return decodeChars( decoder, data, length, output, outCount );
+    }
+    //Pack the chars that aren't whitespace together one block at a time and decode them
+    char packed[LENIENT_BLOCK_SIZE];
+    for ( size_t i = 0; i < length; i += LENIENT_BLOCK_SIZE ) {
+        size_t block = length - i < LENIENT_BLOCK_SIZE ? length - i : LENIENT_BLOCK_SIZE;
+        size_t count = compactSpace( data + i, block, packed );
+        if ( !decodeChars( decoder, packed, count, output, outCount ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t decodeFinish ( Decoder *decoder, byte output[] )
+{
+    return getBytes( &decoder->state, output );
+}
+
+bool decodeBase64 ( char const data[], size_t length, byte output[], size_t *outLength )
+{
+    Decoder decoder;
+    initDecoder( &decoder );
+    *outLength = 0;
+    if ( !decodeUpdate( &decoder, data, length, output, outLength ) ) {
+        return false;
+    }
+    *outLength += decodeFinish( &decoder, output + *outLength );
+    return true;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file base64.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the base64.c component. In this file it contains all the
+ * constants, structs and protypes used in base64.c. Together with the codec, state24
+ * and filebuffer components this makes up libbase64, which can be used to encode and
+ * decode buffers in memory without going through files. The alphabet used is the one
+ * picked with selectAlphabet, the standard alphabet by default.
+ */
+
+#ifndef _BASE64_H_
+#define _BASE64_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include state24 to get the byte type and the State24 used to carry partial groups.
+#include "state24.h"
+
+/** Number of chars in each line of the encoded output by default, like MIME uses */
+#define DEFAULT_LINE_LENGTH 76
+
+/** The most chars that can be put in one line of the encoded output */
+#define MAX_LINE_LENGTH 1048576
+
+/** The most chars that can end a line, a carriage return and newline */
+#define MAX_ENDING_LENGTH 2
+
+/** Number of chars packed together at a time when whitespace is skipped while decoding */
+#define LENIENT_BLOCK_SIZE 4096
+
+/**
+ * This is the Encoder struct. It holds everything needed to keep encoding where the
+ * last block of bytes left off, so an input can be encoded one block at a time.
+ */
+typedef struct {
+  /** Holds the bytes at the end of the last block that don't make up a whole group. */
+  State24 state;
+
+  /** The number of chars that have been output in the current line. */
+  size_t charCount;
+
+  /** The number of chars in each line, or zero if the output isn't broken into lines. */
+  size_t lineLength;
+
+  /** The chars that end each line, either a newline or a carriage return and newline. */
+  char ending[MAX_ENDING_LENGTH];
+
+  /** The number of chars in the line ending. */
+  size_t endingLength;
+
+  /** True if equal signs are added at the end to pad the last group. */
+  bool padding;
+} Encoder;
+
+/**
+ * This is the Decoder struct. It holds everything needed to keep decoding where the
+ * last block of chars left off, so an input can be decoded one block at a time.
+ */
+typedef struct {
+  /** Holds the chars at the end of the last block that don't make up a whole group. */
+  State24 state;
+
+  /** True once an equal sign has been found. */
+  bool equalFlag;
+
+  /** True if all whitespace is skipped, not just newlines. */
+  bool lenient;
+} Decoder;
+
+/**
+ * This function works out the exact number of chars an input with the given number of
+ * bytes encodes to, including the padding, the line breaks and the newline at the end.
+ * @param length The number of bytes in the input
+ * @param wrap True if the output is broken into lines
+ * @param padding True if equal signs are added at the end
+ * @return size_t The number of chars in the encoded output
+ */
+size_t encodedLength ( size_t length, bool wrap, bool padding );
+
+/**
+ * This function works out the exact number of chars an input with the given number of
+ * bytes encodes to using the line length, line ending and padding of an Encoder.
+ * @param encoder The Encoder with the options being used
+ * @param length The number of bytes in the input
+ * @return size_t The number of chars in the encoded output
+ */
+size_t encoderLength ( Encoder const *encoder, size_t length );
+
+/**
+ * This function works out how many chars come before the chars for a byte in the encoded
+ * output. The byte should be at the start of a group, and a line ending is counted between
+ * every full line of chars that comes before it. If the byte starts a new line then the
+ * line ending before it isn't counted, so this is where that line ending goes.
+ * @param encoder The Encoder with the options being used
+ * @param offset The offset of the byte in the input
+ * @return size_t The number of chars in the encoded output before the byte
+ */
+size_t encoderOffset ( Encoder const *encoder, size_t offset );
+
+/**
+ * This function works out the exact number of bytes a given number of chars from the
+ * Base64 alphabet decode to. Newlines and equal signs shouldn't be counted.
+ * @param chars The number of chars from the Base64 alphabet
+ * @return size_t The number of bytes the chars decode to
+ */
+size_t decodedCharsLength ( size_t chars );
+
+/**
+ * This function works out the exact number of bytes an encoded input decodes to by
+ * counting the chars in it that aren't newlines or equal signs. If the input isn't valid
+ * then this is the most bytes that decoding it can output.
+ * @param data The encoded input
+ * @param length The number of chars in the encoded input
+ * @return size_t The number of bytes the input decodes to
+ */
+size_t decodedLength ( char const data[], size_t length );
+
+/**
+ * This function starts a new Encoder with the given options. Lines have
+ * DEFAULT_LINE_LENGTH chars and end with a newline.
+ * @param encoder The Encoder being started
+ * @param wrap True if the output is broken into lines
+ * @param padding True if equal signs are added at the end
+ */
+void initEncoder ( Encoder *encoder, bool wrap, bool padding );
+
+/**
+ * This function starts a new Encoder with the given line length and line ending. The
+ * line length should be a multiple of 4 up to MAX_LINE_LENGTH, so each full line holds
+ * whole groups and can be encoded in one pass.
+ * @param encoder The Encoder being started
+ * @param lineLength The number of chars in each line, or zero to not break the output
+ * @param crlf True if lines end with a carriage return and newline instead of a newline
+ * @param padding True if equal signs are added at the end
+ */
+void initEncoderLines ( Encoder *encoder, size_t lineLength, bool crlf, bool padding );
+
+/**
+ * This function encodes one block of bytes into the output buffer. The bytes at the end
+ * that don't make up a whole group are kept in the Encoder for the next block. Full lines
+ * are encoded along with their line endings in one pass by the codec. The output buffer
+ * needs room for encoderLength( encoder, length + 2 ) chars.
+ * @param encoder The Encoder holding where the last block left off
+ * @param data The bytes being encoded
+ * @param length The number of bytes
+ * @param output The buffer that will get the encoded chars
+ * @return size_t The number of chars added into the output buffer
+ */
+size_t encodeUpdate ( Encoder *encoder, byte const data[], size_t length, char output[] );
+
+/**
+ * This function finishes encoding by adding the chars for the bytes left in the Encoder,
+ * the padding and the line ending at the end. The output buffer needs room for 8 chars.
+ * @param encoder The Encoder being finished
+ * @param output The buffer that will get the encoded chars
+ * @return size_t The number of chars added into the output buffer
+ */
+size_t encodeFinish ( Encoder *encoder, char output[] );
+
+/**
+ * This function sets up an Encoder to carry on from the end of an output it encoded
+ * before, so bytes appended to the input only need those bytes to be encoded. The
+ * line ending at the end and the last group, if it isn't whole, are taken off: the
+ * chars of that group are decoded back into the State24, its padding is dropped and
+ * the line position is set to where the group starts. Encoding the appended bytes
+ * from there gives exactly the output of encoding the whole input again. The tail
+ * needs the last line and the line ending before it, so at most
+ * lineLength + 2 * MAX_ENDING_LENGTH chars, or the last 4 chars and the line ending
+ * if the output isn't broken into lines.
+ * @param encoder An Encoder just started with the options the output was encoded with
+ * @param tail The chars at the end of the output
+ * @param length The number of chars in the tail
+ * @param total The number of chars in the whole output
+ * @param keep Gets the number of chars at the start of the tail that stay in the output
+ * @return true If the end of the output was encoded with the options of the Encoder
+ * @return false If it wasn't, and the Encoder can't carry on from it
+ */
+bool resumeEncoder ( Encoder *encoder, char const tail[], size_t length, size_t total,
+                     size_t *keep );
+
+/**
+ * This function encodes a whole input into the output buffer. The output buffer needs
+ * room for encodedLength( length, wrap, padding ) chars.
+ * @param data The bytes being encoded
+ * @param length The number of bytes
+ * @param output The buffer that will get the encoded chars
+ * @param wrap True if the output is broken into lines
+ * @param padding True if equal signs are added at the end
+ * @return size_t The number of chars added into the output buffer
+ */
+size_t encodeBase64 ( byte const data[], size_t length, char output[], bool wrap,
+                      bool padding );
+
+/**
+ * This function starts a new Decoder.
+ * @param decoder The Decoder being started
+ */
+void initDecoder ( Decoder *decoder );
+
+/**
+ * This function starts a new Decoder that can skip all whitespace. When it is lenient,
+ * spaces, tabs, carriage returns and the other whitespace chars are skipped along with
+ * newlines, so input that was indented or has Windows line endings can be decoded. The
+ * whitespace is packed out of each block by the codec before the block is decoded, so
+ * this is almost as fast as decoding input with only newlines.
+ * @param decoder The Decoder being started
+ * @param lenient True if all whitespace is skipped, false if only newlines are
+ */
+void initDecoderLenient ( Decoder *decoder, bool lenient );
+
+/**
+ * This function decodes one block of chars into the output buffer. Whole groups of chars
+ * are decoded using the codec, and the chars at the end that don't make up a whole group
+ * are kept in the Decoder for the next block. If the Decoder is lenient then the
+ * whitespace is packed out of the chars first. The output buffer needs room for
+ * length / 4 * 3 + 3 bytes.
+ * @param decoder The Decoder holding where the last block left off
+ * @param data The chars being decoded
+ * @param length The number of chars
+ * @param output The buffer that will get the decoded bytes
+ * @param outCount The number of bytes in the output buffer, this is added to
+ * @return true If all the chars were valid
+ * @return false If an invalid char was found
+ */
+bool decodeUpdate ( Decoder *decoder, char const data[], size_t length, byte output[],
+                    size_t *outCount );
+
+/**
+ * This function finishes decoding by adding the bytes for the chars left in the Decoder.
+ * The output buffer needs room for 3 bytes.
+ * @param decoder The Decoder being finished
+ * @param output The buffer that will get the decoded bytes
+ * @return size_t The number of bytes added into the output buffer
+ */
+size_t decodeFinish ( Decoder *decoder, byte output[] );
+
+/**
+ * This function decodes a whole input into the output buffer. The output buffer needs
+ * room for decodedLength( data, length ) bytes.
+ * @param data The chars being decoded
+ * @param length The number of chars
+ * @param output The buffer that will get the decoded bytes
+ * @param outLength Gets the number of bytes added into the output buffer
+ * @return true If the input was valid
+ * @return false If an invalid char was found
+ */
+bool decodeBase64 ( char const data[], size_t length, byte output[], size_t *outLength );
+
+#endif
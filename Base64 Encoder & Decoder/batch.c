@@ -0,0 +1,487 @@
+/**
+ * @file batch.c
+ * @author Daniel Avisse (djavisse)
+ * This is the batch component. This component lets the encode and decode programs
+ * convert many files in one run. The files come from a manifest or a directory tree,
+ * and are converted by a pool of threads that steal jobs from each other when they run
+ * out. Each thread takes one input and one output FileBuffer from a FileBufferPool and
+ * reuses them for every file it converts, so converting lots of small files doesn't
+ * keep allocating memory.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "batch.h"
+
+/** The number of jobs there is room for when the list of jobs is first made */
+#define INITIAL_JOBS 64
+
+/** Number of bytes there is room for in each buffer when a thread starts */
+#define INITIAL_BUFFER_SIZE 65536
+
+/** The most threads that can be used in a batch */
+#define MAX_BATCH_THREADS 1024
+
+/** The permissions used when creating output directories */
+#define DIRECTORY_MODE 0777
+
+/** The permissions used when creating output files */
+#define FILE_MODE 0666
+
+/**
+ * This is the JobList struct. It holds the jobs while they are being read, and grows
+ * as more are added.
+ */
+typedef struct {
+  /** Resizable array of jobs. */
+  BatchJob *jobs;
+
+  /** The number of jobs there is room for. */
+  size_t capacity;
+
+  /** The number of jobs in the list. */
+  size_t count;
+} JobList;
+
+/**
+ * This is the JobRange struct. It holds the jobs one thread still has to convert. The
+ * thread takes jobs from the start of its range, and other threads steal from the end.
+ */
+typedef struct {
+  /** The next job the thread will take. */
+  size_t next;
+
+  /** One past the last job in the range. */
+  size_t end;
+
+  /** Lock used when taking or stealing jobs from this range. */
+  pthread_mutex_t lock;
+} JobRange;
+
+/**
+ * This is the BatchPool struct. It holds everything the threads share.
+ */
+typedef struct {
+  /** The jobs being converted. */
+  BatchJob *jobs;
+
+  /** The range of jobs each thread still has to convert. */
+  JobRange *ranges;
+
+  /** The number of threads. */
+  int threads;
+
+  /** The function used to convert each file. */
+  BatchFunction function;
+
+  /** The options passed to the function. */
+  void *options;
+
+  /** The filebuffers the threads take when they start and give back when they finish. */
+  FileBufferPool buffers;
+} BatchPool;
+
+/**
+ * This is the BatchWorker struct. It holds what belongs to one thread.
+ */
+typedef struct {
+  /** The pool the thread is part of. */
+  BatchPool *pool;
+
+  /** The index of the thread and its range. */
+  int id;
+} BatchWorker;
+
+/**
+ * This function is a helper function that copies a string into new memory.
+ * @param str The string being copied
+ * @param length The number of chars to copy
+ * @return char* The copy of the string
+ */
+static char *copyString ( char const *str, size_t length )
+{
+    char *copy = ( char * )malloc( length + 1 );
+    memcpy( copy, str, length );
+    copy[length] = '\0';
+    return copy;
+}
+
+/**
+ * This function is a helper function that adds a job to the end of a list of jobs.
+ * @param list The list of jobs
+ * @param input The input file, this is owned by the job
+ * @param output The output file, this is owned by the job
+ * @param error The error already found for this job, or zero
+ * @param outputFailed True if the error is for the output file
+ */
+static void addJob ( JobList *list, char *input, char *output, int error, bool outputFailed )
+{
+    //Make the list bigger if it is full
+    if ( list->count == list->capacity ) {
+        list->capacity *= DOUBLE_SIZE;
+        list->jobs = ( BatchJob * )realloc( list->jobs, list->capacity * sizeof( BatchJob ) );
+    }
+    list->jobs[list->count].input = input;
+    list->jobs[list->count].output = output;
+    list->jobs[list->count].error = error;
+    list->jobs[list->count].outputFailed = outputFailed;
+    list->jobs[list->count].bytesIn = 0;
+    list->jobs[list->count].bytesOut = 0;
+    list->count++;
+}
+
+/**
+ * This function is a helper function that starts an empty list of jobs.
+ * @param list The list of jobs
+ */
+static void initJobList ( JobList *list )
+{
+    list->capacity = INITIAL_JOBS;
+    list->count = 0;
+    list->jobs = ( BatchJob * )malloc( list->capacity * sizeof( BatchJob ) );
+}
+
+BatchJob *readManifest ( char const *filename, size_t *count )
+{
+    FILE *stream = fopen( filename, "r" );
+    if ( !stream ) {
+        perror( filename );
+        exit( EXIT_FAILURE );
+    }
+    JobList list;
+    initJobList( &list );
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    while ( ( length = getline( &line, &size, stream ) ) != -1 ) {
+        //Remove the newline at the end of the line and skip empty lines
+        if ( length > 0 && line[length - 1] == '\n' ) {
+            line[--length] = '\0';
+        }
+        if ( length == 0 ) {
+            continue;
+        }
+        //Split the line into the input file and the output file
+        char *separator = strchr( line, MANIFEST_SEPARATOR );
+        if ( !separator || separator[1] == '\0' ) {
+            addJob( &list, copyString( line, length ), NULL, EINVAL, false );
+        } else {
+            addJob( &list, copyString( line, separator - line ),
+                    copyString( separator + 1, line + length - separator - 1 ), 0, false );
+        }
+    }
+    free( line );
+    if ( ferror( stream ) ) {
+        perror( filename );
+        exit( EXIT_FAILURE );
+    }
+    fclose( stream );
+    *count = list.count;
+    return list.jobs;
+}
+
+/**
+ * This function is a helper function that joins a directory and a name into a path.
+ * @param directory The directory
+ * @param name The name inside the directory
+ * @return char* The path, this needs to be freed
+ */
+static char *joinPath ( char const *directory, char const *name )
+{
+    size_t length = strlen( directory );
+    char *path = ( char * )malloc( length + strlen( name ) + DOUBLE_SIZE );
+    strcpy( path, directory );
+    path[length] = '/';
+    strcpy( path + length + 1, name );
+    return path;
+}
+
+/**
+ * This function is a helper function that adds a job for every regular file in a
+ * directory and the directories inside it. The output directory is skipped if it is
+ * inside the input directory, so the outputs aren't converted again.
+ * @param list The list of jobs
+ * @param inputDir The input directory
+ * @param outputDir The matching output directory, this is created if it doesn't exist
+ * @param root The info of the top output directory, or NULL if it couldn't be found
+ */
+static void addTree ( JobList *list, char const *inputDir, char const *outputDir,
+                      struct stat const *root )
+{
+    DIR *dir = opendir( inputDir );
+    if ( !dir ) {
+        addJob( list, copyString( inputDir, strlen( inputDir ) ), NULL, errno, false );
+        return;
+    }
+    if ( mkdir( outputDir, DIRECTORY_MODE ) != 0 && errno != EEXIST ) {
+        addJob( list, copyString( inputDir, strlen( inputDir ) ),
+                copyString( outputDir, strlen( outputDir ) ), errno, true );
+        closedir( dir );
+        return;
+    }
+    struct dirent *entry;
+    while ( ( entry = readdir( dir ) ) ) {
+        if ( strcmp( entry->d_name, "." ) == 0 || strcmp( entry->d_name, ".." ) == 0 ) {
+            continue;
+        }
+        char *input = joinPath( inputDir, entry->d_name );
+        char *output = joinPath( outputDir, entry->d_name );
+        //Only look at the type of the entry if readdir didn't give it
+        struct stat info;
+        unsigned char type = entry->d_type;
+        if ( type == DT_UNKNOWN ) {
+            type = lstat( input, &info ) != 0 ? DT_UNKNOWN : S_ISDIR( info.st_mode ) ?
+                   DT_DIR : S_ISREG( info.st_mode ) ? DT_REG : DT_UNKNOWN;
+        }
+        //Skip the output directory if it is inside the input directory
+        if ( type == DT_DIR && root && stat( input, &info ) == 0 &&
+             info.st_dev == root->st_dev && info.st_ino == root->st_ino ) {
+            type = DT_UNKNOWN;
+        }
+        if ( type == DT_DIR ) {
+            addTree( list, input, output, root );
+            free( input );
+            free( output );
+        } else if ( type == DT_REG ) {
+            addJob( list, input, output, 0, false );
+        } else {
+            free( input );
+            free( output );
+        }
+    }
+    closedir( dir );
+}
+
+BatchJob *readTree ( char const *inputDir, char const *outputDir, size_t *count )
+{
+    //Make sure the input directory can be read before starting
+    DIR *dir = opendir( inputDir );
+    if ( !dir ) {
+        perror( inputDir );
+        exit( EXIT_FAILURE );
+    }
+    closedir( dir );
+    //Create the output directory first so it can be found if it is inside the input
+    //directory
+    struct stat root;
+    bool found = ( mkdir( outputDir, DIRECTORY_MODE ) == 0 || errno == EEXIST ) &&
+                 stat( outputDir, &root ) == 0;
+    JobList list;
+    initJobList( &list );
+    addTree( &list, inputDir, outputDir, found ? &root : NULL );
+    *count = list.count;
+    return list.jobs;
+}
+
+/**
+ * This function is a helper function that reads a whole file into a reused buffer.
+ * @param filename The file being read
+ * @param buffer The buffer that gets the bytes of the file
+ * @return int Zero if the file was read, otherwise the errno value
+ */
+static int readBatchFile ( char const *filename, FileBuffer *buffer )
+{
+    int fd = open( filename, O_RDONLY );
+    if ( fd < 0 ) {
+        return errno;
+    }
+    //Make room for the whole file using its size, and keep reading if it has grown
+    struct stat info;
+    buffer->count = 0;
+    if ( fstat( fd, &info ) == 0 && S_ISREG( info.st_mode ) ) {
+        reserveFileBuffer( buffer, info.st_size + 1 );
+    }
+    ssize_t length;
+    do {
+        byte *end = reserveFileBuffer( buffer, 1 );
+        length = read( fd, end, buffer->capacity - buffer->count );
+        if ( length < 0 ) {
+            int error = errno;
+            close( fd );
+            return error;
+        }
+        buffer->count += length;
+    } while ( length > 0 );
+    close( fd );
+    return 0;
+}
+
+/**
+ * This function is a helper function that writes a buffer to a file.
+ * @param filename The file being written
+ * @param buffer The buffer holding the bytes of the file
+ * @return int Zero if the file was written, otherwise the errno value
+ */
+static int writeBatchFile ( char const *filename, FileBuffer *buffer )
+{
+    int fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, FILE_MODE );
+    if ( fd < 0 ) {
+        return errno;
+    }
+    size_t written = 0;
+    while ( written < buffer->count ) {
+        ssize_t length = write( fd, buffer->data + written, buffer->count - written );
+        if ( length < 0 ) {
+            int error = errno;
+            close( fd );
+            return error;
+        }
+        written += length;
+    }
+    if ( close( fd ) != 0 ) {
+        return errno;
+    }
+    return 0;
+}
+
+/**
+ * This function is a helper function used by a thread to take its next job. If its own
+ * range is empty then it steals the second half of the jobs left in another range.
+ * @param worker The thread taking a job
+ * @param job Gets the index of the job that was taken
+ * @return true If a job was taken
+ * @return false If there are no jobs left to take
+ */
+static bool takeJob ( BatchWorker *worker, size_t *job )
+{
+    BatchPool *pool = worker->pool;
+    JobRange *own = &pool->ranges[worker->id];
+    pthread_mutex_lock( &own->lock );
+    bool taken = own->next < own->end;
+    if ( taken ) {
+        *job = own->next++;
+    }
+    pthread_mutex_unlock( &own->lock );
+    //Steal from the other threads, starting with the one after this one
+    for ( int i = 1; !taken && i < pool->threads; i++ ) {
+        JobRange *victim = &pool->ranges[( worker->id + i ) % pool->threads];
+        pthread_mutex_lock( &victim->lock );
+        size_t start = victim->end;
+        size_t end = victim->end;
+        if ( victim->next < victim->end ) {
+            start = victim->next + ( victim->end - victim->next ) / DOUBLE_SIZE;
+            victim->end = start;
+        }
+        pthread_mutex_unlock( &victim->lock );
+        if ( start < end ) {
+            *job = start;
+            taken = true;
+            pthread_mutex_lock( &own->lock );
+            own->next = start + 1;
+            own->end = end;
+            pthread_mutex_unlock( &own->lock );
+        }
+    }
+    return taken;
+}
+
+/**
+ * This function is run by each thread in the pool. It keeps taking jobs and converting
+ * them using its own buffers until there are none left.
+ * @param arg The BatchWorker for the thread
+ * @return void* NULL once there are no jobs left
+ */
+static void *batchWorker ( void *arg )
+{
+    BatchWorker *worker = ( BatchWorker * )arg;
+    BatchPool *pool = worker->pool;
+    FileBuffer *input = takeFileBuffer( &pool->buffers );
+    FileBuffer *output = takeFileBuffer( &pool->buffers );
+    reserveFileBuffer( input, INITIAL_BUFFER_SIZE );
+    reserveFileBuffer( output, INITIAL_BUFFER_SIZE );
+    size_t index;
+    while ( takeJob( worker, &index ) ) {
+        BatchJob *job = &pool->jobs[index];
+        //Skip the jobs that already failed while they were being read
+        if ( job->error != 0 ) {
+            continue;
+        }
+        job->error = readBatchFile( job->input, input );
+        if ( job->error != 0 ) {
+            continue;
+        }
+        job->bytesIn = input->count;
+        output->count = 0;
+        job->error = pool->function( input, output, pool->options );
+        //Remove the output file if the input wasn't valid, like when converting one file
+        if ( job->error != 0 ) {
+            remove( job->output );
+        } else {
+            job->error = writeBatchFile( job->output, output );
+            job->outputFailed = job->error != 0;
+            job->bytesOut = output->count;
+        }
+    }
+    giveFileBuffer( &pool->buffers, input );
+    giveFileBuffer( &pool->buffers, output );
+    return NULL;
+}
+
+bool runBatch ( BatchJob *jobs, size_t count, int threads, BatchFunction function,
+                void *options, Stats *stats )
+{
+    switchPhase( stats, PHASE_CONVERT );
+    if ( threads > MAX_BATCH_THREADS ) {
+        threads = MAX_BATCH_THREADS;
+    }
+    BatchPool pool;
+    pool.jobs = jobs;
+    pool.threads = threads;
+    pool.function = function;
+    pool.options = options;
+    pool.ranges = ( JobRange * )malloc( threads * sizeof( JobRange ) );
+    initFileBufferPool( &pool.buffers );
+    BatchWorker workers[MAX_BATCH_THREADS];
+    pthread_t ids[MAX_BATCH_THREADS];
+    //Give each thread an equal share of the jobs
+    for ( int i = 0; i < threads; i++ ) {
+        pool.ranges[i].next = count * i / threads;
+        pool.ranges[i].end = count * ( i + 1 ) / threads;
+        pthread_mutex_init( &pool.ranges[i].lock, NULL );
+        workers[i].pool = &pool;
+        workers[i].id = i;
+    }
+    for ( int i = 0; i < threads; i++ ) {
+        if ( pthread_create( &ids[i], NULL, batchWorker, &workers[i] ) != 0 ) {
+            perror( "pthread_create" );
+            exit( EXIT_FAILURE );
+        }
+    }
+    for ( int i = 0; i < threads; i++ ) {
+        pthread_join( ids[i], NULL );
+    }
+    for ( int i = 0; i < threads; i++ ) {
+        pthread_mutex_destroy( &pool.ranges[i].lock );
+    }
+    free( pool.ranges );
+    freeFileBufferPool( &pool.buffers );
+    switchPhase( stats, PHASE_FINISH );
+    //Print every job that failed
+    bool success = true;
+    for ( size_t i = 0; i < count; i++ ) {
+        stats->bytesIn += jobs[i].bytesIn;
+        stats->bytesOut += jobs[i].bytesOut;
+        if ( jobs[i].error == INVALID_INPUT ) {
+            fprintf( stderr, "%s: Invalid input file\n", jobs[i].input );
+            success = false;
+        } else if ( jobs[i].error != 0 ) {
+            fprintf( stderr, "%s: %s\n", jobs[i].outputFailed ? jobs[i].output : jobs[i].input,
+                     strerror( jobs[i].error ) );
+            success = false;
+        }
+    }
+    return success;
+}
+
+void freeBatch ( BatchJob *jobs, size_t count )
+{
+    for ( size_t i = 0; i < count; i++ ) {
+        free( jobs[i].input );
+        free( jobs[i].output );
+    }
+    free( jobs );
+}
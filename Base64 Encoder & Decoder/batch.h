@@ -0,0 +1,119 @@
+/**
+ * @file batch.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the batch.c component. In this file it contains all the
+ * constants, structs and protypes used in batch.c
+ */
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include filebuffer to get the FileBuffer used to hold each file.
+#include "filebuffer.h"
+
+// Include stats to count the time and bytes used by a batch.
+#include "stats.h"
+
+/** The command used to read the input and output files from a manifest */
+#define BATCH_COMMAND "--batch"
+
+/** The command used to go through every file in a directory tree */
+#define TREE_COMMAND "--tree"
+
+/** The char between the input file and the output file on each line of a manifest */
+#define MANIFEST_SEPARATOR '\t'
+
+/** Error code used when a file isn't valid Base64 */
+#define INVALID_INPUT -1
+
+/**
+ * This is the BatchJob struct. It holds one input file and the output file it is
+ * converted into, along with the error found while converting it.
+ */
+typedef struct {
+  /** The path of the input file. */
+  char *input;
+
+  /** The path of the output file. */
+  char *output;
+
+  /** Zero if the file was converted, otherwise an errno value or INVALID_INPUT. */
+  int error;
+
+  /** True if the error is for the output file, not the input file. */
+  bool outputFailed;
+
+  /** The number of bytes read from the input file. */
+  size_t bytesIn;
+
+  /** The number of bytes written to the output file. */
+  size_t bytesOut;
+} BatchJob;
+
+/**
+ * This is the BatchFunction type. It converts the bytes in the input buffer and puts the
+ * result in the output buffer. Both buffers belong to the thread and are reused for every
+ * file it converts, the output buffer is empty when the function is called and
+ * reserveFileBuffer can be used to make room in it.
+ * @param input The bytes of the input file
+ * @param output The buffer that gets the bytes of the output file
+ * @param options The options passed to runBatch
+ * @return int Zero if the file was converted, otherwise INVALID_INPUT
+ */
+typedef int ( *BatchFunction )( FileBuffer *input, FileBuffer *output, void *options );
+
+/**
+ * This function reads a manifest with one job on each line. Each line has the input file
+ * and the output file separated by a tab. Empty lines are skipped, and lines without an
+ * output file are reported as failed jobs. The program exits with an error message if
+ * the manifest can't be read.
+ * @param filename The path of the manifest
+ * @param count Gets the number of jobs
+ * @return BatchJob* The jobs in the manifest
+ */
+BatchJob *readManifest ( char const *filename, size_t *count );
+
+/**
+ * This function makes a job for every regular file in a directory tree. The output file
+ * of each job has the same path inside the output directory as the input file has inside
+ * the input directory, and the directories in the output directory are created as they
+ * are needed. Directories that can't be read are reported as failed jobs. The program
+ * exits with an error message if the input directory can't be read.
+ * @param inputDir The input directory
+ * @param outputDir The output directory
+ * @param count Gets the number of jobs
+ * @return BatchJob* The jobs for the files in the directory tree
+ */
+BatchJob *readTree ( char const *inputDir, char const *outputDir, size_t *count );
+
+/**
+ * This function converts all the jobs using a pool of threads. Each thread starts with an
+ * equal share of the jobs, and once it runs out it steals half of the jobs left in the
+ * share of another thread. A failed job doesn't stop the others, and every failure is
+ * printed along with the file it is for once all the jobs are done. The time used is counted in the convert phase of
+ * the stats, along with the bytes read and written.
+ * @param jobs The jobs being converted
+ * @param count The number of jobs
+ * @param threads The number of threads to use
+ * @param function The function used to convert each file
+ * @param options The options passed to the function
+ * @param stats The stats kept for --stats
+ * @return true If every job was converted
+ * @return false If any job failed
+ */
+bool runBatch ( BatchJob *jobs, size_t count, int threads, BatchFunction function,
+                void *options, Stats *stats );
+
+/**
+ * This function frees the memory used by the jobs.
+ * @param jobs The jobs being freed
+ * @param count The number of jobs
+ */
+void freeBatch ( BatchJob *jobs, size_t count );
+
+#endif
@@ -0,0 +1,252 @@
+/**
+ * @file bench.c
+ * @author Daniel Avisse (djavisse)
+ * This is the bench component and is the main component of the benchmark program that
+ * is run by make bench. It encodes and decodes payloads from a few bytes up to several GB
+ * using libbase64, with every engine the CPU supports, both with line breaks and padding
+ * and without them (like -b -p). For each one it prints the throughput in GB/s and the
+ * cycles used for each byte, and for the small payloads it also prints the p50 and p99
+ * latency of a single call.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "base64.h"
+#include "codec.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+/** The biggest payload used when no size is given, this is 4 GB */
+#define DEFAULT_MAX_SIZE ( ( size_t )4 << 30 )
+
+/** Payloads up to this size are small, and get their latency measured */
+#define SMALL_SIZE 65536
+
+/** How long each payload is run for, in seconds */
+#define RUN_TIME 0.2
+
+/** The most calls timed on their own for the latency of a small payload */
+#define MAX_SAMPLES 200000
+
+/** Percentiles printed for the latency of small payloads */
+#define P50 50
+#define P99 99
+
+/** Number of nanoseconds in a second */
+#define NANOSECONDS 1000000000.0
+
+/** Number of bytes in a GB */
+#define GIGABYTE 1e9
+
+/** The buffers can use this many quarters of the physical memory */
+#define MEMORY_QUARTERS 3
+
+/** Number of quarters in the whole */
+#define QUARTERS 4
+
+/** The sizes of the payloads, from a few bytes up to several GB */
+static size_t const sizes[] = {
+    3, 16, 57, 100, 1024, 4096, SMALL_SIZE, 1 << 20, 16 << 20, 256 << 20,
+    ( size_t )1 << 30, ( size_t )4 << 30
+};
+
+/**
+ * This is the Run struct. It holds the buffers and options for one payload being
+ * encoded or decoded.
+ */
+typedef struct {
+  /** The bytes being encoded. */
+  byte *data;
+
+  /** The encoded chars. */
+  char *chars;
+
+  /** The bytes decoded from the chars. */
+  byte *decoded;
+
+  /** The number of bytes in the payload. */
+  size_t size;
+
+  /** The number of encoded chars. */
+  size_t length;
+
+  /** True if the output is broken into lines and padded, false for -b -p. */
+  bool wrap;
+} Run;
+
+/**
+ * This function is a helper function that gets the current time in seconds.
+ * @return double The time in seconds
+ */
+static double now ()
+{
+    struct timespec time;
+    clock_gettime( CLOCK_MONOTONIC, &time );
+    return time.tv_sec + time.tv_nsec / NANOSECONDS;
+}
+
+/**
+ * This function is a helper function that reads the CPU cycle counter, or returns zero
+ * if the CPU doesn't have one.
+ * @return uint64_t The number of cycles
+ */
+static uint64_t cycles ()
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * This function is a helper function that encodes or decodes a payload once.
+ * @param run The payload being used
+ * @param decode True to decode the payload, false to encode it
+ */
+static void runOnce ( Run *run, bool decode )
+{
+    if ( decode ) {
+        size_t length;
+        if ( !decodeBase64( run->chars, run->length, run->decoded, &length ) ||
+             length != run->size ) {
+            fprintf( stderr, "Decoded payload of %zu bytes is wrong\n", run->size );
+            exit( EXIT_FAILURE );
+        }
+    } else {
+        run->length = encodeBase64( run->data, run->size, run->chars, run->wrap, run->wrap );
+    }
+}
+
+/**
+ * This function is used by qsort to sort the latencies.
+ * @param a The first latency
+ * @param b The second latency
+ * @return int Less than, equal to or more than zero if a is less than, equal to or more than b
+ */
+static int compareTimes ( void const *a, void const *b )
+{
+    double x = *( double const * )a;
+    double y = *( double const * )b;
+    return ( x > y ) - ( x < y );
+}
+
+/**
+ * This function is a helper function that runs a payload over and over for a short time
+ * and prints the results on one line.
+ * @param engine The name of the engine being used
+ * @param run The payload being used
+ * @param decode True to decode the payload, false to encode it
+ * @param samples The buffer used to hold the time of each call for small payloads
+ */
+static void measure ( char const *engine, Run *run, bool decode, double samples[] )
+{
+    size_t count = 0;
+    uint64_t startCycles = cycles();
+    double start = now();
+    double end = start;
+    //Keep running until the run time is used, timing each call if the payload is small
+    do {
+        if ( run->size <= SMALL_SIZE && count < MAX_SAMPLES ) {
+            double before = now();
+            runOnce( run, decode );
+            end = now();
+            samples[count] = end - before;
+        } else {
+            runOnce( run, decode );
+            end = now();
+        }
+        count++;
+    } while ( end - start < RUN_TIME );
+    uint64_t usedCycles = cycles() - startCycles;
+    double bytes = ( double )run->size * count;
+    printf( "%-11s %-7s %-6s %12zu %9.3f %10.3f", engine, decode ? "decode" : "encode",
+            run->wrap ? "wrap" : "-b -p", run->size, bytes / ( end - start ) / GIGABYTE,
+            usedCycles / bytes );
+    //Print the latency percentiles of a single call for small payloads
+    if ( run->size <= SMALL_SIZE ) {
+        size_t timed = count < MAX_SAMPLES ? count : MAX_SAMPLES;
+        qsort( samples, timed, sizeof( double ), compareTimes );
+        printf( " %10.0f %10.0f\n", samples[timed * P50 / 100] * NANOSECONDS,
+                samples[timed * P99 / 100] * NANOSECONDS );
+    } else {
+        printf( " %10s %10s\n", "-", "-" );
+    }
+    fflush( stdout );
+}
+
+/**
+ * This is the main function of the benchmark. The biggest payload can be given as the
+ * first argument, in bytes. Payloads that need more than three quarters of the physical
+ * memory are skipped.
+ * @param argc Number of command-line arguments
+ * @param argv Array containing the different command-line arguments
+ * @return int EXIT_SUCCESS
+ */
+int main ( int argc, char *argv[] )
+{
+    size_t maxSize = DEFAULT_MAX_SIZE;
+    if ( argc > 1 ) {
+        char *end;
+        maxSize = strtoull( argv[1], &end, 10 );
+        if ( *end != '\0' || maxSize == 0 ) {
+            fprintf( stderr, "usage: benchmark [max-bytes]\n" );
+            exit( EXIT_FAILURE );
+        }
+    }
+    //Leave out the payloads that won't fit in memory
+    size_t memory = ( size_t )sysconf( _SC_PHYS_PAGES ) * sysconf( _SC_PAGESIZE );
+    size_t largest = 0;
+    for ( size_t i = 0; i < sizeof( sizes ) / sizeof( sizes[0] ); i++ ) {
+        size_t needed = sizes[i] * DOUBLE_SIZE + encodedLength( sizes[i], true, true );
+        if ( sizes[i] <= maxSize && needed <= memory / QUARTERS * MEMORY_QUARTERS ) {
+            largest = sizes[i];
+        } else if ( sizes[i] <= maxSize ) {
+            printf( "Skipping %zu byte payloads, they need more memory\n", sizes[i] );
+        }
+    }
+    //Fill the payload with bytes that look random, but are the same every time
+    Run run;
+    run.data = ( byte * )malloc( largest );
+    run.chars = ( char * )malloc( encodedLength( largest, true, true ) );
+    run.decoded = ( byte * )malloc( largest + MAX_NUMBER_OF_BYTES );
+    double *samples = ( double * )malloc( MAX_SAMPLES * sizeof( double ) );
+    uint64_t seed = 0x9E3779B97F4A7C15;
+    for ( size_t i = 0; i < largest; i++ ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        run.data[i] = seed;
+    }
+    printf( "%-11s %-7s %-6s %12s %9s %10s %10s %10s\n", "engine", "op", "mode", "bytes",
+            "GB/s", "cycles/B", "p50 ns", "p99 ns" );
+    //Run every payload with every engine the CPU supports
+    for ( Engine const *engine = listEngines(); engine->name; engine++ ) {
+        if ( !engine->supported() ) {
+            printf( "%-11s not supported by this CPU\n", engine->name );
+            continue;
+        }
+        selectEngine( engine->name );
+        for ( int wrap = 1; wrap >= 0; wrap-- ) {
+            run.wrap = wrap;
+            for ( size_t i = 0; i < sizeof( sizes ) / sizeof( sizes[0] ) &&
+                                sizes[i] <= largest; i++ ) {
+                run.size = sizes[i];
+                measure( engine->name, &run, false, samples );
+                measure( engine->name, &run, true, samples );
+            }
+        }
+    }
+    free( run.data );
+    free( run.chars );
+    free( run.decoded );
+    free( samples );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,345 @@
+/**
+ * @file cache.c
+ * @author Daniel Avisse (djavisse)
+ * This is the cache component. This component keeps the encoded outputs of input files
+ * in a directory, named after the hash of the input file and the options it was encoded
+ * with, so encoding the same input with the same options again only has to copy the
+ * output. The hash of each input file is kept in a record along with its size and
+ * times, so an input file that hasn't changed isn't even read. Outputs are copied by
+ * cloning their blocks when the file system can, otherwise by copy_file_range, so the
+ * bytes never pass through the program. Every file in the cache is marked when it is
+ * used, and the ones used the longest time ago are removed once the cache is too big.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include "cache.h"
+#include "codec.h"
+#include "hash.h"
+
+/** Number of bytes in a kilobyte, each size suffix is this many times the last one */
+#define KILOBYTE 1024
+
+/** The size suffixes, each one is a kilobyte times the one before it */
+#define SIZE_SUFFIXES "KMG"
+
+/** Added to the start of the name of a file in the cache that is still being written */
+#define TEMPORARY_PREFIX "tmp-"
+
+/** The permissions a new cache directory is made with, before the umask */
+#define DIRECTORY_MODE 0777
+
+/** The permissions a new file is made with, before the umask */
+#define FILE_MODE 0666
+
+/**
+ * This is the CacheFile struct. It holds one file found in the cache directory when
+ * working out which files to remove.
+ */
+typedef struct {
+  /** The name of the file in the cache directory. */
+  char name[CACHE_NAME_LENGTH];
+
+  /** The number of bytes in the file. */
+  uint64_t size;
+
+  /** The time the file was last used. */
+  struct timespec used;
+} CacheFile;
+
+/**
+ * This function is a helper function that makes the path of a file in the cache
+ * directory.
+ * @param directory The cache directory
+ * @param name The name of the file
+ * @return char* The path of the file, which needs to be freed
+ */
+static char *cachePath ( char const *directory, char const *name )
+{
+    char *path = ( char * )malloc( strlen( directory ) + strlen( name ) + DOUBLE_SIZE );
+    sprintf( path, "%s/%s", directory, name );
+    return path;
+}
+
+/**
+ * This function is a helper function that makes the path a file in the cache is
+ * written under before it is renamed, which is only used by this process.
+ * @param directory The cache directory
+ * @return char* The path of the temporary file, which needs to be freed
+ */
+static char *temporaryPath ( char const *directory )
+{
+    char name[CACHE_NAME_LENGTH];
+    snprintf( name, sizeof( name ), TEMPORARY_PREFIX "%ld", ( long )getpid() );
+    return cachePath( directory, name );
+}
+
+/**
+ * This function is a helper function that copies all of one file into another. The
+ * blocks are cloned if the file system can share them between files, otherwise they
+ * are copied inside the kernel.
+ * @param in The file descriptor of the file being copied
+ * @param out The file descriptor of the empty file getting the copy
+ * @param size The number of bytes in the file being copied
+ * @return true If the whole file was copied
+ * @return false If it couldn't be
+ */
+static bool copyFile ( int in, int out, uint64_t size )
+{
+    if ( ioctl( out, FICLONE, in ) == 0 ) {
+        return true;
+    }
+    while ( size > 0 ) {
+        ssize_t count = copy_file_range( in, NULL, out, NULL, size, 0 );
+        if ( count <= 0 ) {
+            return false;
+        }
+        size -= count;
+    }
+    return true;
+}
+
+/**
+ * This function is a helper function that works out the hash of an input file.
+ * @param fd The file descriptor of the input file
+ * @param size The number of bytes in the input file
+ * @param hash Gets the hash
+ * @return true If the hash was worked out
+ * @return false If the input file couldn't be mapped
+ */
+static bool hashFile ( int fd, uint64_t size, uint64_t *hash )
+{
+    //An empty file can't be mapped, but its hash is the hash of no bytes
+    if ( size == 0 ) {
+        *hash = hashBytes( "", 0, 0 );
+        return true;
+    }
+    FileBuffer *input = mapFileBuffer( fd );
+    if ( !input ) {
+        return false;
+    }
+    *hash = hashBytes( input->data, input->count, 0 );
+    freeFileBuffer( input );
+    return true;
+}
+
+/**
+ * This function is a helper function that writes the record of an input file. It is
+ * written under a temporary name and renamed, so a record is never read half written.
+ * @param directory The cache directory
+ * @param path The path of the record
+ * @param record The record
+ */
+static void writeRecord ( char const *directory, char const *path, InputRecord const *record )
+{
+    char *temporary = temporaryPath( directory );
+    FILE *stream = fopen( temporary, "wb" );
+    bool written = stream && fwrite( record, sizeof( *record ), 1, stream ) == 1;
+    if ( stream && fclose( stream ) != 0 ) {
+        written = false;
+    }
+    if ( !written || rename( temporary, path ) != 0 ) {
+        remove( temporary );
+    }
+    free( temporary );
+}
+
+/**
+ * This function is a helper function used by qsort to put the files in the cache in
+ * the order they were last used, from the longest time ago.
+ * @param a The first CacheFile
+ * @param b The second CacheFile
+ * @return int Less than zero if the first was used first, more than zero if the second was
+ */
+static int compareUsed ( void const *a, void const *b )
+{
+    struct timespec const *first = &( ( CacheFile const * )a )->used;
+    struct timespec const *second = &( ( CacheFile const * )b )->used;
+    if ( first->tv_sec != second->tv_sec ) {
+        return first->tv_sec < second->tv_sec ? -1 : 1;
+    }
+    return ( first->tv_nsec > second->tv_nsec ) - ( first->tv_nsec < second->tv_nsec );
+}
+
+/**
+ * This function is a helper function that removes the files in the cache that were
+ * used the longest time ago until the cache holds no more than the limit. Only the
+ * outputs and records are counted, so other files in the directory are left alone.
+ * @param directory The cache directory
+ * @param limit The most bytes the cache can hold
+ */
+static void evictCache ( char const *directory, uint64_t limit )
+{
+    DIR *dir = opendir( directory );
+    if ( !dir ) {
+        return;
+    }
+    //Find every output and record along with its size and when it was last used
+    size_t capacity = INITIAL_CAPACITY / sizeof( CacheFile );
+    CacheFile *files = ( CacheFile * )malloc( capacity * sizeof( CacheFile ) );
+    size_t count = 0;
+    uint64_t total = 0;
+    struct dirent *entry;
+    while ( ( entry = readdir( dir ) ) ) {
+        struct stat info;
+        if ( ( strncmp( entry->d_name, ENTRY_PREFIX, strlen( ENTRY_PREFIX ) ) != 0 &&
+               strncmp( entry->d_name, RECORD_PREFIX, strlen( RECORD_PREFIX ) ) != 0 ) ||
+             strlen( entry->d_name ) >= CACHE_NAME_LENGTH ||
+             fstatat( dirfd( dir ), entry->d_name, &info, 0 ) != 0 ) {
+            continue;
+        }
+        if ( count == capacity ) {
+            capacity *= DOUBLE_SIZE;
+            files = ( CacheFile * )realloc( files, capacity * sizeof( CacheFile ) );
+        }
+        strcpy( files[count].name, entry->d_name );
+        files[count].size = info.st_size;
+        files[count].used = info.st_mtim;
+        total += info.st_size;
+        count++;
+    }
+    //Remove the files used the longest time ago first
+    qsort( files, count, sizeof( CacheFile ), compareUsed );
+    for ( size_t i = 0; i < count && total > limit; i++ ) {
+        if ( unlinkat( dirfd( dir ), files[i].name, 0 ) == 0 ) {
+            total -= files[i].size;
+        }
+    }
+    free( files );
+    closedir( dir );
+}
+
+uint64_t cacheLimit ()
+{
+    char const *text = getenv( CACHE_SIZE_VARIABLE );
+    if ( !text || *text < '0' || *text > '9' ) {
+        return DEFAULT_CACHE_SIZE;
+    }
+    char *end;
+    errno = 0;
+    uint64_t limit = strtoull( text, &end, 10 );
+    //Multiply the size by a kilobyte for each step of its suffix
+    char const *suffix = *end ? strchr( SIZE_SUFFIXES, *end ) : NULL;
+    if ( suffix ) {
+        for ( char const *step = SIZE_SUFFIXES; step <= suffix; step++ ) {
+            limit *= KILOBYTE;
+        }
+        end++;
+    }
+    return *end == '\0' && errno == 0 ? limit : DEFAULT_CACHE_SIZE;
+}
+
+bool cacheName ( char const *directory, char const *inputfile, Encoder const *encoder,
+                 char name[] )
+{
+    int fd = open( inputfile, O_RDONLY );
+    if ( fd < 0 ) {
+        return false;
+    }
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) ||
+         ( mkdir( directory, DIRECTORY_MODE ) != 0 && errno != EEXIST ) ) {
+        close( fd );
+        return false;
+    }
+    //Use the hash in the record of the inode if the file hasn't changed since it was made
+    char recordName[CACHE_NAME_LENGTH];
+    snprintf( recordName, sizeof( recordName ), RECORD_PREFIX "%llx-%llx",
+              ( unsigned long long )info.st_dev, ( unsigned long long )info.st_ino );
+    char *path = cachePath( directory, recordName );
+    InputRecord record;
+    FILE *stream = fopen( path, "rb" );
+    bool current = stream && fread( &record, sizeof( record ), 1, stream ) == 1 &&
+                   memcmp( record.magic, RECORD_MAGIC, RECORD_MAGIC_LENGTH ) == 0 &&
+                   record.size == info.st_size &&
+                   record.modified == info.st_mtim.tv_sec &&
+                   record.modifiedNanoseconds == info.st_mtim.tv_nsec &&
+                   record.changed == info.st_ctim.tv_sec &&
+                   record.changedNanoseconds == info.st_ctim.tv_nsec;
+    if ( stream ) {
+        fclose( stream );
+    }
+    //Mark the record as used, or hash the file and write a new record
+    if ( current ) {
+        utimensat( AT_FDCWD, path, NULL, 0 );
+    } else {
+        if ( !hashFile( fd, info.st_size, &record.hash ) ) {
+            free( path );
+            close( fd );
+            return false;
+        }
+        memcpy( record.magic, RECORD_MAGIC, RECORD_MAGIC_LENGTH );
+        record.size = info.st_size;
+        record.modified = info.st_mtim.tv_sec;
+        record.modifiedNanoseconds = info.st_mtim.tv_nsec;
+        record.changed = info.st_ctim.tv_sec;
+        record.changedNanoseconds = info.st_ctim.tv_nsec;
+        writeRecord( directory, path, &record );
+    }
+    free( path );
+    close( fd );
+    //Name the output after the hash and size of the input and every option
+    snprintf( name, CACHE_NAME_LENGTH, ENTRY_PREFIX "%016llx-%llu-w%zu-e%zu-p%d-a%d",
+              ( unsigned long long )record.hash, ( unsigned long long )record.size,
+              encoder->lineLength, encoder->endingLength, encoder->padding,
+              selectedAlphabet() );
+    return true;
+}
+
+bool fetchCache ( char const *directory, char const *name, char const *outputfile,
+                  size_t *size )
+{
+    char *path = cachePath( directory, name );
+    int in = open( path, O_RDONLY );
+    free( path );
+    if ( in < 0 ) {
+        return false;
+    }
+    struct stat info;
+    int out = -1;
+    bool copied = fstat( in, &info ) == 0 &&
+                  ( out = open( outputfile, O_WRONLY | O_CREAT | O_TRUNC, FILE_MODE ) ) >= 0 &&
+                  copyFile( in, out, info.st_size );
+    //Mark the output in the cache as used so it is the last to be removed
+    if ( copied ) {
+        futimens( in, NULL );
+        *size = info.st_size;
+    }
+    if ( out >= 0 && close( out ) != 0 ) {
+        copied = false;
+    }
+    close( in );
+    return copied;
+}
+
+void storeCache ( char const *directory, char const *name, char const *outputfile,
+                  uint64_t limit )
+{
+    int in = open( outputfile, O_RDONLY );
+    if ( in < 0 ) {
+        return;
+    }
+    //Copy the output under a temporary name, then rename it so it shows up all at once
+    char *temporary = temporaryPath( directory );
+    struct stat info;
+    int out = -1;
+    bool copied = fstat( in, &info ) == 0 &&
+                  ( out = open( temporary, O_WRONLY | O_CREAT | O_TRUNC, FILE_MODE ) ) >= 0 &&
+                  copyFile( in, out, info.st_size );
+    if ( out >= 0 && close( out ) != 0 ) {
+        copied = false;
+    }
+    close( in );
+    char *path = cachePath( directory, name );
+    if ( !copied || rename( temporary, path ) != 0 ) {
+        remove( temporary );
+    }
+    free( path );
+    free( temporary );
+    evictCache( directory, limit );
+}
@@ -0,0 +1,125 @@
+/**
+ * @file cache.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the cache.c component. In this file it contains all the
+ * constants, structs and protypes used in cache.c
+ */
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Include base64 to get the Encoder holding the options the output is encoded with.
+#include "base64.h"
+
+/** The environment variable holding the directory of the cache, it is only used if set */
+#define CACHE_VARIABLE "BASE64_CACHE"
+
+/** The environment variable holding the most bytes the cache can hold */
+#define CACHE_SIZE_VARIABLE "BASE64_CACHE_SIZE"
+
+/** The most bytes the cache holds if the size isn't set, this is 1 GB */
+#define DEFAULT_CACHE_SIZE ( 1024ULL * 1024 * 1024 )
+
+/** Added to the start of the name of each encoded output kept in the cache */
+#define ENTRY_PREFIX "b64-"
+
+/** Added to the start of the name of each record of the hash of an input file */
+#define RECORD_PREFIX "inode-"
+
+/** The chars at the start of every record */
+#define RECORD_MAGIC "B64STAT1"
+
+/** Number of chars at the start of every record */
+#define RECORD_MAGIC_LENGTH 8
+
+/** The most chars in the name of a file in the cache */
+#define CACHE_NAME_LENGTH 128
+
+/**
+ * This is the InputRecord struct. It keeps the hash of an input file along with the
+ * size and times of the file when it was hashed, so the file doesn't have to be read
+ * again to find its hash while it hasn't changed. There is one record for each inode,
+ * named after the device and inode number.
+ */
+typedef struct {
+  /** RECORD_MAGIC, without a null char at the end. */
+  char magic[RECORD_MAGIC_LENGTH];
+
+  /** The size of the input file when it was hashed. */
+  uint64_t size;
+
+  /** The seconds of the time the input file was last changed. */
+  int64_t modified;
+
+  /** The nanoseconds of the time the input file was last changed. */
+  int64_t modifiedNanoseconds;
+
+  /** The seconds of the time the inode of the input file was last changed. */
+  int64_t changed;
+
+  /** The nanoseconds of the time the inode of the input file was last changed. */
+  int64_t changedNanoseconds;
+
+  /** The hash of the contents of the input file. */
+  uint64_t hash;
+} InputRecord;
+
+/**
+ * This function reads the most bytes the cache can hold from CACHE_SIZE_VARIABLE. The
+ * size is a number of bytes that can end in K, M or G.
+ * @return uint64_t The most bytes the cache can hold, or DEFAULT_CACHE_SIZE if the
+ * variable isn't set or can't be read
+ */
+uint64_t cacheLimit ();
+
+/**
+ * This function works out the name an encoded output is kept under in the cache. The
+ * name has the hash and size of the input file and the options it is encoded with. The
+ * record of the input file is checked first, and if the size and times of the file
+ * still match it then its hash is used without reading the file. Otherwise the file is
+ * hashed and its record is written. The cache directory is made if it isn't there.
+ * @param directory The cache directory
+ * @param inputfile The path of the input file
+ * @param encoder A new Encoder with the options the input file is encoded with
+ * @param name Gets the name, this needs room for CACHE_NAME_LENGTH chars
+ * @return true If the name was worked out
+ * @return false If the input file isn't a regular file or the cache can't be used
+ */
+bool cacheName ( char const *directory, char const *inputfile, Encoder const *encoder,
+                 char name[] );
+
+/**
+ * This function copies an encoded output kept in the cache to the output file. The
+ * output file shares the blocks of the cached output when the file system can clone
+ * them, otherwise they are copied inside the kernel with copy_file_range. The cached
+ * output is marked as used so it is the last to be removed.
+ * @param directory The cache directory
+ * @param name The name of the encoded output in the cache
+ * @param outputfile The path of the output file
+ * @param size Gets the number of bytes in the output file when it is copied
+ * @return true If the output file was copied from the cache
+ * @return false If the encoded output isn't in the cache or couldn't be copied
+ */
+bool fetchCache ( char const *directory, char const *name, char const *outputfile,
+                  size_t *size );
+
+/**
+ * This function keeps a copy of an output file that was just encoded in the cache, then
+ * removes the files in the cache that were used the longest time ago until the cache
+ * holds no more than the limit. The copy is made under a temporary name and renamed, so
+ * other runs never see part of it. Nothing is reported if the copy can't be made.
+ * @param directory The cache directory
+ * @param name The name the encoded output is kept under
+ * @param outputfile The path of the output file
+ * @param limit The most bytes the cache can hold
+ */
+void storeCache ( char const *directory, char const *name, char const *outputfile,
+                  uint64_t limit );
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file check.c
+ * @author Daniel Avisse (djavisse)
+ * This is the check component. This component checks that an encoded input is valid
+ * without keeping what it decodes to, and finds the offset, line and column of the
+ * first error. Everything before the padding is decoded by the codec into a small
+ * buffer that is thrown away, which checks the chars at the speed of the engine. The
+ * padding at the end is checked one char at a time, which also checks that it is in
+ * the right place and that nothing but padding and newlines comes after it. Like the
+ * base64 component, nothing here allocates memory.
+ */
+
+#include "check.h"
+#include "codec.h"
+
+/** Number of bytes the chars of one block can decode to */
+#define CHECK_OUTPUT_SIZE ( CHECK_BLOCK_SIZE / MAX_NUMBER_OF_CHARS * MAX_NUMBER_OF_BYTES + \
+                            MAX_NUMBER_OF_BYTES )
+
+/** The fewest chars a group needs before it can be padded */
+#define MIN_PADDED_CHARS 2
+
+/**
+ * This function is a helper function that keeps the first error found and where it is.
+ * The line of the error is the line of the next char, so it must be found before the
+ * Checker moves past the error.
+ * @param checker The Checker that found the error
+ * @param error The error message
+ * @param offset The offset in the input of the char with the error
+ * @return bool False, so the caller can return it
+ */
+static bool setError ( Checker *checker, char const *error, size_t offset )
+{
+    checker->error = error;
+    checker->errorOffset = offset;
+    checker->errorLine = checker->line;
+    checker->errorColumn = offset - checker->lineStart + 1;
+    return false;
+}
+
+/**
+ * This function is a helper function that moves the Checker past chars that were
+ * checked by decoding them, counting the newlines in them.
+ * @param checker The Checker
+ * @param data The chars that were checked
+ * @param length The number of chars
+ */
+static void countLines ( Checker *checker, char const data[], size_t length )
+{
+    char const *next = data;
+    while ( ( next = ( char const * )memchr( next, '\n', data + length - next ) ) ) {
+        next++;
+        checker->line++;
+        checker->lineStart = checker->offset + ( next - data );
+    }
+    checker->offset += length;
+}
+
+/**
+ * This function is a helper function that checks chars one at a time. This is used for
+ * the padding at the end, and to find the exact char that made decoding a block fail.
+ * @param checker The Checker
+ * @param data The chars being checked
+ * @param length The number of chars
+ * @return true If the chars are valid
+ * @return false If an error was found
+ */
+static bool checkChars ( Checker *checker, char const data[], size_t length )
+{
+    for ( size_t i = 0; i < length; i++, checker->offset++ ) {
+        char ch = data[i];
+        if ( ch == '\n' ) {
+            checker->line++;
+            checker->lineStart = checker->offset + 1;
+        }
+        //Padding has to finish a group that has at least 2 chars
+        else if ( ch == '=' ) {
+            if ( checker->padding == 0 ? checker->groupChars < MIN_PADDED_CHARS :
+                                         checker->groupChars == 0 ) {
+                return setError( checker, MISPLACED_PADDING_ERROR, checker->offset );
+            }
+            checker->padding++;
+            checker->groupChars = ( checker->groupChars + 1 ) % MAX_NUMBER_OF_CHARS;
+        } else if ( validChar( ch ) ) {
+            if ( checker->padding > 0 ) {
+                return setError( checker, AFTER_PADDING_ERROR, checker->offset );
+            }
+            checker->groupChars = ( checker->groupChars + 1 ) % MAX_NUMBER_OF_CHARS;
+        } else if ( !checker->decoder.lenient || !IS_SPACE( ch ) ) {
+            return setError( checker, INVALID_CHAR_ERROR, checker->offset );
+        }
+    }
+    return true;
+}
+
+void initChecker ( Checker *checker, bool lenient )
+{
+    initDecoderLenient( &checker->decoder, lenient );
+    checker->padded = false;
+    checker->groupChars = 0;
+    checker->padding = 0;
+    checker->offset = 0;
+    checker->line = 1;
+    checker->lineStart = 0;
+    checker->error = NULL;
+    checker->errorOffset = 0;
+    checker->errorLine = 0;
+    checker->errorColumn = 0;
+}
+
+bool checkUpdate ( Checker *checker, char const data[], size_t length )
+{
+    if ( checker->error ) {
+        return false;
+    }
+    size_t i = 0;
+    //Check the chars before the first equal sign by decoding them one block at a time
+    while ( !checker->padded && i < length ) {
+        size_t block = length - i < CHECK_BLOCK_SIZE ? length - i : CHECK_BLOCK_SIZE;
+        char const *equal = ( char const * )memchr( data + i, '=', block );
+        if ( equal ) {
+            block = equal - ( data + i );
+        }
+        byte bytes[CHECK_OUTPUT_SIZE];
+        size_t count = 0;
+        int groupChars = checker->decoder.state.bitCount / NUMBER_OF_BITS_IN_CHAR;
+        //Go back over a block that isn't valid one char at a time to find the error
+        if ( !decodeUpdate( &checker->decoder, data + i, block, bytes, &count ) ) {
+            checker->groupChars = groupChars;
+            return checkChars( checker, data + i, block );
+        }
+        countLines( checker, data + i, block );
+        i += block;
+        //From the first equal sign on check one char at a time
+        if ( equal ) {
+            checker->padded = true;
+            checker->groupChars = checker->decoder.state.bitCount / NUMBER_OF_BITS_IN_CHAR;
+        }
+    }
+    return checkChars( checker, data + i, length - i );
+}
+
+bool checkFinish ( Checker *checker )
+{
+    if ( checker->error ) {
+        return false;
+    }
+    if ( !checker->padded ) {
+        checker->groupChars = checker->decoder.state.bitCount / NUMBER_OF_BITS_IN_CHAR;
+    }
+    if ( checker->padding > 0 && checker->groupChars != 0 ) {
+        return setError( checker, SHORT_PADDING_ERROR, checker->offset );
+    }
+    if ( checker->groupChars == 1 ) {
+        return setError( checker, SHORT_GROUP_ERROR, checker->offset );
+    }
+    return true;
+}
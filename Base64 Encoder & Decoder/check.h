@@ -0,0 +1,107 @@
+/**
+ * @file check.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the check.c component. In this file it contains all the
+ * constants, structs and protypes used in check.c
+ */
+
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include base64 to get the Decoder used to check the chars before the padding.
+#include "base64.h"
+
+/** Number of chars decoded at a time when checking, into a buffer that is thrown away */
+#define CHECK_BLOCK_SIZE 4096
+
+/** The error for a char that isn't in the alphabet, a newline or an equal sign */
+#define INVALID_CHAR_ERROR "invalid character"
+
+/** The error for a char from the alphabet that comes after an equal sign */
+#define AFTER_PADDING_ERROR "character after padding"
+
+/** The error for an equal sign that doesn't finish a group of 2 or 3 chars */
+#define MISPLACED_PADDING_ERROR "misplaced padding"
+
+/** The error for padding that stops before its group has 4 chars */
+#define SHORT_PADDING_ERROR "incomplete padding"
+
+/** The error for a last group with only one char, which can't make up a byte */
+#define SHORT_GROUP_ERROR "incomplete group"
+
+/**
+ * This is the Checker struct. It holds everything needed to keep checking an encoded
+ * input where the last block of chars left off, along with where the first error is.
+ */
+typedef struct {
+  /** Decodes the chars before the first equal sign, only to check them. */
+  Decoder decoder;
+
+  /** True once the first equal sign has been reached and chars are checked one at a time. */
+  bool padded;
+
+  /** The number of chars in the group being checked, once the chars are checked one at a time. */
+  int groupChars;
+
+  /** The number of equal signs that have been found. */
+  int padding;
+
+  /** The offset in the input of the next char to check. */
+  size_t offset;
+
+  /** The line of the next char to check, starting from one. */
+  size_t line;
+
+  /** The offset in the input where the line of the next char starts. */
+  size_t lineStart;
+
+  /** The first error found, or NULL if there hasn't been one. */
+  char const *error;
+
+  /** The offset in the input of the first error. */
+  size_t errorOffset;
+
+  /** The line of the first error, starting from one. */
+  size_t errorLine;
+
+  /** The column of the first error, starting from one. */
+  size_t errorColumn;
+} Checker;
+
+/**
+ * This function starts a new Checker.
+ * @param checker The Checker being started
+ * @param lenient True if all whitespace is skipped, false if only newlines are
+ */
+void initChecker ( Checker *checker, bool lenient );
+
+/**
+ * This function checks one block of chars without keeping the bytes they decode to.
+ * The chars before the first equal sign are decoded by the codec into a small buffer
+ * that is thrown away, so they are checked as fast as they can be decoded, and the
+ * lines are counted with memchr. Only a block that turns out to be invalid, and the
+ * chars from the first equal sign on, are gone over one char at a time to find exactly
+ * where the error is and to check the padding.
+ * @param checker The Checker holding where the last block left off
+ * @param data The chars being checked
+ * @param length The number of chars
+ * @return true If the chars are valid so far
+ * @return false If an error was found, it is kept in the Checker
+ */
+bool checkUpdate ( Checker *checker, char const data[], size_t length );
+
+/**
+ * This function finishes checking by making sure the last group is whole, either with
+ * its padding or with at least 2 chars if it isn't padded.
+ * @param checker The Checker being finished
+ * @return true If the whole input was valid
+ * @return false If an error was found, it is kept in the Checker
+ */
+bool checkFinish ( Checker *checker );
+
+#endif
@@ -0,0 +1,326 @@
+/**
+ * @file codec.c
+ * @author Daniel Avisse (djavisse)
+ * This is the Codec component. This component has the lookup tables used to convert
+ * between bytes and chars, and the functions that encode and decode whole groups of
+ * bytes or chars at a time using them. The tables are built when compiling, so they
+ * don't need to be set up when the program starts. Anything that isn't a whole group,
+ * like the end of the input or chars split by a newline, is handled by the State24.
+ * The groups are converted by an engine, which is picked when the program starts
+ * based on the instructions the CPU supports. Every alphabet has its own tables and
+ * its own copy of every engine, built for it when compiling, so picking an alphabet
+ * just picks which engines are used.
+ */
+
+#include "codec.h"
+#include "simd.h"
+#include <stdint.h>
+
+/** Builds the entries of the encode table of an alphabet, 4 at a time and then 64 at a time */
+#define CHARS_4( a, i ) BASE64_CHAR( a, i ), BASE64_CHAR( a, ( i ) + 1 ), \
+                        BASE64_CHAR( a, ( i ) + 2 ), BASE64_CHAR( a, ( i ) + 3 )
+#define CHARS_16( a, i ) CHARS_4( a, i ), CHARS_4( a, ( i ) + 4 ), CHARS_4( a, ( i ) + 8 ), \
+                         CHARS_4( a, ( i ) + 12 )
+#define CHARS_64( a, i ) CHARS_16( a, i ), CHARS_16( a, ( i ) + 16 ), \
+                         CHARS_16( a, ( i ) + 32 ), CHARS_16( a, ( i ) + 48 )
+
+/** Builds the entries of the pair table of an alphabet, one pair at a time and then 4096 at a time */
+#define PAIR( a, i ) { BASE64_CHAR( a, ( i ) >> NUMBER_OF_BITS_IN_CHAR ), \
+                       BASE64_CHAR( a, ( i ) & MASK_FOR_LAST_6_BITS ) }
+#define PAIRS_4( a, i ) PAIR( a, i ), PAIR( a, ( i ) + 1 ), PAIR( a, ( i ) + 2 ), \
+                        PAIR( a, ( i ) + 3 )
+#define PAIRS_16( a, i ) PAIRS_4( a, i ), PAIRS_4( a, ( i ) + 4 ), PAIRS_4( a, ( i ) + 8 ), \
+                         PAIRS_4( a, ( i ) + 12 )
+#define PAIRS_64( a, i ) PAIRS_16( a, i ), PAIRS_16( a, ( i ) + 16 ), \
+                         PAIRS_16( a, ( i ) + 32 ), PAIRS_16( a, ( i ) + 48 )
+#define PAIRS_256( a, i ) PAIRS_64( a, i ), PAIRS_64( a, ( i ) + 64 ), \
+                          PAIRS_64( a, ( i ) + 128 ), PAIRS_64( a, ( i ) + 192 )
+#define PAIRS_1024( a, i ) PAIRS_256( a, i ), PAIRS_256( a, ( i ) + 256 ), \
+                           PAIRS_256( a, ( i ) + 512 ), PAIRS_256( a, ( i ) + 768 )
+#define PAIRS_4096( a, i ) PAIRS_1024( a, i ), PAIRS_1024( a, ( i ) + 1024 ), \
+                           PAIRS_1024( a, ( i ) + 2048 ), PAIRS_1024( a, ( i ) + 3072 )
+
+/** Builds the entries of the decode table of an alphabet, 4 at a time and then 256 at a time */
+#define VALUES_4( a, c ) BASE64_VALUE( a, c ), BASE64_VALUE( a, ( c ) + 1 ), \
+                         BASE64_VALUE( a, ( c ) + 2 ), BASE64_VALUE( a, ( c ) + 3 )
+#define VALUES_16( a, c ) VALUES_4( a, c ), VALUES_4( a, ( c ) + 4 ), \
+                          VALUES_4( a, ( c ) + 8 ), VALUES_4( a, ( c ) + 12 )
+#define VALUES_64( a, c ) VALUES_16( a, c ), VALUES_16( a, ( c ) + 16 ), \
+                          VALUES_16( a, ( c ) + 32 ), VALUES_16( a, ( c ) + 48 )
+#define VALUES_256( a, c ) VALUES_64( a, c ), VALUES_64( a, ( c ) + 64 ), \
+                           VALUES_64( a, ( c ) + 128 ), VALUES_64( a, ( c ) + 192 )
+
+const char encodeTable[ALPHABETS][BASE64] = {
+    { CHARS_64( STANDARD_ALPHABET, 0 ) },
+    { CHARS_64( URL_ALPHABET, 0 ) },
+    { CHARS_64( IMAP_ALPHABET, 0 ) }
+};
+
+const char encodePairTable[ALPHABETS][PAIR_TABLE_SIZE][2] = {
+    { PAIRS_4096( STANDARD_ALPHABET, 0 ) },
+    { PAIRS_4096( URL_ALPHABET, 0 ) },
+    { PAIRS_4096( IMAP_ALPHABET, 0 ) }
+};
+
+const byte decodeTable[ALPHABETS][DECODE_TABLE_SIZE] = {
+    { VALUES_256( STANDARD_ALPHABET, 0 ) },
+    { VALUES_256( URL_ALPHABET, 0 ) },
+    { VALUES_256( IMAP_ALPHABET, 0 ) }
+};
+
+/** The names of the alphabets, in the order of their indexes */
+static char const *const alphabetNames[ALPHABETS] = { "standard", "url", "imap" };
+
+/**
+ * This function is a helper function that encodes whole groups using the pair table of
+ * an alphabet. It is always inlined with a constant alphabet, so each alphabet gets its
+ * own copy that reads its table directly.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+__attribute__(( always_inline ))
+static inline size_t encodeGroupsTables ( byte const data[], size_t groups, char buffer[],
+                                          int alphabet )
+{
+    char const ( *pairs )[2] = encodePairTable[alphabet];
+    for ( size_t i = 0; i < groups; i++ ) {
+        //Put the 3 bytes together into 24 bits
+        uint32_t bits = ( uint32_t )data[0] << ( SIZE_OF_BYTE * TWO_BYTES ) |
+                        ( uint32_t )data[1] << SIZE_OF_BYTE | data[TWO_BYTES];
+        //Look up the chars for the first 12 bits and the last 12 bits
+        memcpy( buffer, pairs[bits >> BITS_IN_PAIR], TWO_BYTES );
+        memcpy( buffer + TWO_BYTES, pairs[bits & MASK_FOR_LAST_12_BITS], TWO_BYTES );
+        data += MAX_NUMBER_OF_BYTES;
+        buffer += MAX_NUMBER_OF_CHARS;
+    }
+    return groups * MAX_NUMBER_OF_CHARS;
+}
+
+/**
+ * This function is a helper function that encodes full lines using the pair table of an
+ * alphabet, one line at a time followed by the line ending.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+__attribute__(( always_inline ))
+static inline size_t encodeLinesTables ( byte const data[], size_t lines, size_t lineGroups,
+                                         char const ending[], size_t endingLength,
+                                         char buffer[], int alphabet )
+{
+    size_t lineChars = lineGroups * MAX_NUMBER_OF_CHARS + endingLength;
+    for ( size_t i = 0; i < lines; i++ ) {
+        char *out = buffer + i * lineChars;
+        encodeGroupsTables( data + i * lineGroups * MAX_NUMBER_OF_BYTES, lineGroups, out,
+                            alphabet );
+        memcpy( out + lineGroups * MAX_NUMBER_OF_CHARS, ending, endingLength );
+    }
+    return lines * lineChars;
+}
+
+/**
+ * This function is a helper function that decodes whole groups using the decode table of
+ * an alphabet, stopping at the first group with a char that isn't in the alphabet.
+ * @param data The chars that will be decoded, this should have 4 chars for each group
+ * @param groups The number of groups of 4 chars to decode
+ * @param buffer The buffer that will get 3 bytes for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of groups that were decoded
+ */
+__attribute__(( always_inline ))
+static inline size_t decodeGroupsTables ( char const data[], size_t groups, byte buffer[],
+                                          int alphabet )
+{
+    byte const *values = decodeTable[alphabet];
+    for ( size_t i = 0; i < groups; i++ ) {
+        //Look up the 6-bit value of each char
+        uint32_t a = values[( byte )data[0]];
+        uint32_t b = values[( byte )data[1]];
+        uint32_t c = values[( byte )data[TWO_BYTES]];
+        uint32_t d = values[( byte )data[MAX_NUMBER_OF_BYTES]];
+        //Stop at the first group with a char that isn't in the alphabet
+        if ( ( a | b | c | d ) & ~MASK_FOR_LAST_6_BITS ) {
+            return i;
+        }
+        //Put the 4 values together into 24 bits and split them into 3 bytes
+        uint32_t bits = a << EIGHTEEN_BITES | b << TWELEVE_BITES | c << NUMBER_OF_BITS_IN_CHAR | d;
+        buffer[0] = bits >> ( SIZE_OF_BYTE * TWO_BYTES );
+        buffer[1] = bits >> SIZE_OF_BYTE;
+        buffer[TWO_BYTES] = bits;
+        data += MAX_NUMBER_OF_CHARS;
+        buffer += MAX_NUMBER_OF_BYTES;
+    }
+    return groups;
+}
+
+size_t compactSpaceScalar ( char const data[], size_t length, char buffer[] )
+{
+    size_t count = 0;
+    for ( size_t i = 0; i < length; i++ ) {
+        buffer[count] = data[i];
+        count += !IS_SPACE( data[i] );
+    }
+    return count;
+}
+
+/**
+ * Defines the scalar engine for one alphabet. The standard alphabet has no suffix, so
+ * its functions keep their names.
+ */
+#define SCALAR_ENGINE( suffix, alphabet ) \
+size_t encodeGroupsScalar##suffix ( byte const data[], size_t groups, char buffer[] ) \
+{ \
+    return encodeGroupsTables( data, groups, buffer, alphabet ); \
+} \
+size_t encodeLinesScalar##suffix ( byte const data[], size_t lines, size_t lineGroups, \
+                                   char const ending[], size_t endingLength, char buffer[] ) \
+{ \
+    return encodeLinesTables( data, lines, lineGroups, ending, endingLength, buffer, \
+                              alphabet ); \
+} \
+size_t decodeGroupsScalar##suffix ( char const data[], size_t groups, byte buffer[] ) \
+{ \
+    return decodeGroupsTables( data, groups, buffer, alphabet ); \
+}
+
+SCALAR_ENGINE( , STANDARD_ALPHABET )
+SCALAR_ENGINE( Url, URL_ALPHABET )
+SCALAR_ENGINE( Imap, IMAP_ALPHABET )
+
+/**
+ * This function is used by the scalar engine, which works on every CPU.
+ * @return true Always
+ */
+static bool scalarSupported ()
+{
+    return true;
+}
+
+/** Lists the engines for one alphabet from slowest to fastest, ending with an engine with no name */
+#define ENGINES( suffix ) { \
+    { "scalar", scalarSupported, encodeGroupsScalar##suffix, encodeLinesScalar##suffix, \
+      decodeGroupsScalar##suffix, compactSpaceScalar }, \
+    { "ssse3", ssse3Supported, encodeGroupsSSSE3##suffix, encodeLinesSSSE3##suffix, \
+      decodeGroupsSSSE3##suffix, compactSpaceSSSE3 }, \
+    { "avx2", avx2Supported, encodeGroupsAVX2##suffix, encodeLinesAVX2##suffix, \
+      decodeGroupsAVX2##suffix, compactSpaceAVX2 }, \
+    { "avx512vbmi", avx512Supported, encodeGroupsAVX512##suffix, encodeLinesAVX512##suffix, \
+      decodeGroupsAVX2##suffix, compactSpaceAVX2 }, \
+    { NULL, NULL, NULL, NULL, NULL, NULL } \
+}
+
+/** Number of engines for each alphabet, with the engine with no name at the end */
+#define ENGINES_PER_ALPHABET 5
+
+/** All the engines for each alphabet */
+static Engine const engines[ALPHABETS][ENGINES_PER_ALPHABET] = {
+    ENGINES(),
+    ENGINES( Url ),
+    ENGINES( Imap )
+};
+
+/** The alphabet that has been picked */
+static int currentAlphabet = STANDARD_ALPHABET;
+
+/** The engine that has been picked, or NULL if one hasn't been picked yet */
+static Engine const *currentEngine = NULL;
+
+Engine const *selectEngine ( char const *name )
+{
+    Engine const *list = engines[currentAlphabet];
+    currentEngine = list;
+    bool named = name && name[0] != '\0';
+    //Go through all the engines and keep the last one that is supported or has the name
+    for ( Engine const *engine = list; engine->name; engine++ ) {
+        if ( engine->supported() ) {
+            if ( named && strcmp( name, engine->name ) == 0 ) {
+                currentEngine = engine;
+                return currentEngine;
+            }
+            currentEngine = engine;
+        }
+    }
+    return named ? NULL : currentEngine;
+}
+
+void printEngines ( FILE *stream )
+{
+    for ( Engine const *engine = engines[currentAlphabet]; engine->name; engine++ ) {
+        if ( engine->supported() ) {
+            fprintf( stream, " %s", engine->name );
+        }
+    }
+    fprintf( stream, "\n" );
+}
+
+bool selectAlphabet ( char const *name )
+{
+    for ( int alphabet = 0; alphabet < ALPHABETS; alphabet++ ) {
+        if ( strcmp( name, alphabetNames[alphabet] ) == 0 ) {
+            //Swap the engine for the same engine of the new alphabet
+            if ( currentEngine ) {
+                currentEngine = engines[alphabet] +
+                                ( currentEngine - engines[currentAlphabet] );
+            }
+            currentAlphabet = alphabet;
+            return true;
+        }
+    }
+    return false;
+}
+
+int selectedAlphabet ()
+{
+    return currentAlphabet;
+}
+
+Engine const *listEngines ()
+{
+    return engines[currentAlphabet];
+}
+
+size_t encodeGroups ( byte const data[], size_t groups, char buffer[] )
+{
+    //Pick the fastest engine if one hasn't been picked yet
+    if ( !currentEngine ) {
+        selectEngine( NULL );
+    }
+    return currentEngine->encodeGroups( data, groups, buffer );
+}
+
+size_t encodeLines ( byte const data[], size_t lines, size_t lineGroups,
+                     char const ending[], size_t endingLength, char buffer[] )
+{
+    //Pick the fastest engine if one hasn't been picked yet
+    if ( !currentEngine ) {
+        selectEngine( NULL );
+    }
+    return currentEngine->encodeLines( data, lines, lineGroups, ending, endingLength,
+                                       buffer );
+}
+
+size_t decodeGroups ( char const data[], size_t groups, byte buffer[] )
+{
+    //Pick the fastest engine if one hasn't been picked yet
+    if ( !currentEngine ) {
+        selectEngine( NULL );
+    }
+    return currentEngine->decodeGroups( data, groups, buffer );
+}
+
+size_t compactSpace ( char const data[], size_t length, char buffer[] )
+{
+    //Pick the fastest engine if one hasn't been picked yet
+    if ( !currentEngine ) {
+        selectEngine( NULL );
+    }
+    return currentEngine->compactSpace( data, length, buffer );
+}
@@ -0,0 +1,281 @@
+/**
+ * @file codec.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the codec.c component. In this file it contains all the
+ * constants, lookup tables and protypes used in codec.c
+ */
+
+#ifndef _CODEC_H_
+#define _CODEC_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include state24 to get the byte type and the constants for groups of bits.
+#include "state24.h"
+
+/** Number of entries in the table for looking up a char from every possible byte */
+#define DECODE_TABLE_SIZE 256
+
+/** Number of entries in the table for looking up the pair of chars for 12 bits */
+#define PAIR_TABLE_SIZE 4096
+
+/** Value in the decode table for chars that aren't in the Base64 alphabet */
+#define INVALID_VALUE 0xFF
+
+/** Number of bits looked up at a time in the pair table */
+#define BITS_IN_PAIR 12
+
+/** Mask used to get the last 12 bits of a group */
+#define MASK_FOR_LAST_12_BITS 0xFFF
+
+/** Index of the standard Base64 alphabet, which ends with + and / */
+#define STANDARD_ALPHABET 0
+
+/** Index of the URL and file name safe alphabet from RFC 4648, which ends with - and _ */
+#define URL_ALPHABET 1
+
+/** Index of the alphabet used for IMAP mailbox names in RFC 3501, which ends with + and , */
+#define IMAP_ALPHABET 2
+
+/** Number of alphabets, each one has its own lookup tables and engines */
+#define ALPHABETS 3
+
+/**
+ * Gives the char for the value 62 in an alphabet. Every alphabet has the same first 62
+ * chars, A-Z, a-z and 0-9, and only the last two chars are different.
+ */
+#define ALPHABET_CHAR_62( a ) ( ( a ) == URL_ALPHABET ? '-' : '+' )
+
+/** Gives the char for the value 63 in an alphabet */
+#define ALPHABET_CHAR_63( a ) ( ( a ) == URL_ALPHABET ? '_' : \
+                                ( a ) == IMAP_ALPHABET ? ',' : '/' )
+
+/**
+ * Gives the char in an alphabet for a 6-bit value. This is a constant expression so it
+ * can be used to build the lookup tables when compiling.
+ */
+#define BASE64_CHAR( a, v ) ( ( v ) < 26 ? 'A' + ( v ) : ( v ) < 52 ? 'a' + ( v ) - 26 : \
+                              ( v ) < 62 ? '0' + ( v ) - 52 : \
+                              ( v ) == 62 ? ALPHABET_CHAR_62( a ) : ALPHABET_CHAR_63( a ) )
+
+/**
+ * Gives the 6-bit value of a char in an alphabet, or INVALID_VALUE if the char isn't in
+ * the alphabet. This is a constant expression so it can be used to build the lookup
+ * tables when compiling.
+ */
+#define BASE64_VALUE( a, c ) ( ( c ) >= 'A' && ( c ) <= 'Z' ? ( c ) - 'A' : \
+                               ( c ) >= 'a' && ( c ) <= 'z' ? ( c ) - 'a' + 26 : \
+                               ( c ) >= '0' && ( c ) <= '9' ? ( c ) - '0' + 52 : \
+                               ( c ) == ALPHABET_CHAR_62( a ) ? 62 : \
+                               ( c ) == ALPHABET_CHAR_63( a ) ? 63 : INVALID_VALUE )
+
+/**
+ * Checks if a char is whitespace that is skipped when decoding leniently, which is a
+ * space, tab, newline, vertical tab, form feed or carriage return.
+ */
+#define IS_SPACE( c ) ( ( c ) == ' ' || ( ( c ) >= '\t' && ( c ) <= '\r' ) )
+
+/** Name of the environment variable that can be used to pick an engine by name */
+#define ENGINE_VARIABLE "BASE64_ENGINE"
+
+/** The error for an engine that doesn't exist or that the CPU doesn't support */
+#define ENGINE_ERROR "Unknown engine, or this CPU doesn't support it. Use one of:"
+
+/**
+ * This is the Engine struct. An engine is a set of functions that encode whole
+ * groups, or decode them, using the instructions of one type of CPU. The fastest engine the CPU
+ * supports is picked when the program starts, and the scalar engine that only uses
+ * the lookup tables works on every CPU.
+ */
+typedef struct {
+  /** Name of the engine, used to pick it with the BASE64_ENGINE variable. */
+  char const *name;
+
+  /** Returns true if the CPU the program is running on supports this engine. */
+  bool ( *supported )( void );
+
+  /** Encodes whole groups of 3 bytes into groups of 4 chars. */
+  size_t ( *encodeGroups )( byte const data[], size_t groups, char buffer[] );
+
+  /** Encodes full lines of groups, adding the line ending after each line. */
+  size_t ( *encodeLines )( byte const data[], size_t lines, size_t lineGroups,
+                           char const ending[], size_t endingLength, char buffer[] );
+
+  /** Decodes whole groups of 4 chars into groups of 3 bytes. */
+  size_t ( *decodeGroups )( char const data[], size_t groups, byte buffer[] );
+
+  /** Copies the chars that aren't whitespace into a buffer, packed together. */
+  size_t ( *compactSpace )( char const data[], size_t length, char buffer[] );
+} Engine;
+
+/** Tables that give the char in each alphabet for each 6-bit value */
+extern const char encodeTable[ALPHABETS][BASE64];
+
+/** Tables that give the two chars in each alphabet for each 12-bit value */
+extern const char encodePairTable[ALPHABETS][PAIR_TABLE_SIZE][2];
+
+/** Tables that give the 6-bit value of every byte in each alphabet, or INVALID_VALUE */
+extern const byte decodeTable[ALPHABETS][DECODE_TABLE_SIZE];
+
+/**
+ * This function picks the alphabet used to encode and decode. Each alphabet has its own
+ * engines, built for it when compiling, so the engine that has been picked is swapped
+ * for the same engine of the new alphabet and converting doesn't look up the alphabet.
+ * @param name The name of the alphabet, standard, url or imap
+ * @return true If the alphabet was picked
+ * @return false If there is no alphabet with that name
+ */
+bool selectAlphabet ( char const *name );
+
+/**
+ * This function returns the alphabet that has been picked.
+ * @return int The index of the alphabet, STANDARD_ALPHABET until another one is picked
+ */
+int selectedAlphabet ();
+
+/**
+ * This function picks the engine used to encode and decode whole groups. If a name is
+ * given and the CPU supports the engine with that name then it is used, otherwise the
+ * fastest engine the CPU supports is used.
+ * @param name The name of the engine to use, or NULL or empty to use the fastest engine
+ * @return Engine const* The engine that will be used, or NULL if there is no engine with
+ * the name or the CPU doesn't support it, the fastest engine is used then
+ */
+Engine const *selectEngine ( char const *name );
+
+/**
+ * This function prints the names of the engines the CPU supports on one line.
+ * @param stream The stream the names are printed to
+ */
+void printEngines ( FILE *stream );
+
+/**
+ * This function returns the list of all the engines for the alphabet that has been
+ * picked, from slowest to fastest. The list ends with an engine that has a NULL name.
+ * @return Engine const* The list of engines
+ */
+Engine const *listEngines ();
+
+/**
+ * This function encodes whole groups of 3 bytes into groups of 4 chars using the
+ * lookup tables. Each group is looked up 12 bits at a time in the pair table, so there
+ * is no branching. This works on every CPU and is used by the other engines for the
+ * groups that don't fill a whole register.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeGroupsScalar ( byte const data[], size_t groups, char buffer[] );
+
+/**
+ * This function encodes whole groups of 3 bytes into groups of 4 chars using the
+ * engine that has been picked. If no engine has been picked yet then the fastest
+ * engine is picked first.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeGroups ( byte const data[], size_t groups, char buffer[] );
+
+/**
+ * This function encodes full lines of groups straight into the buffer using the engine
+ * that has been picked, adding the line ending after each line, so the encoded chars
+ * don't need to be gone over a second time to break them into lines. If no engine has
+ * been picked yet then the fastest engine is picked first.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeLines ( byte const data[], size_t lines, size_t lineGroups,
+                     char const ending[], size_t endingLength, char buffer[] );
+
+/**
+ * This function encodes full lines of groups using the lookup tables, one line at a
+ * time with encodeGroupsScalar followed by the line ending.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeLinesScalar ( byte const data[], size_t lines, size_t lineGroups,
+                           char const ending[], size_t endingLength, char buffer[] );
+
+/**
+ * This function decodes whole groups of 4 chars into groups of 3 bytes using the lookup
+ * table. This works on every CPU and is used by the other engines for the groups that
+ * don't fill a whole register, and to find the exact group with an invalid char.
+ * Decoding stops at the first group that has a char that isn't in the alphabet.
+ * @param data The chars that will be decoded, this should have 4 chars for each group
+ * @param groups The number of groups of 4 chars to decode
+ * @param buffer The buffer that will get 3 bytes for each group
+ * @return size_t The number of groups that were decoded
+ */
+size_t decodeGroupsScalar ( char const data[], size_t groups, byte buffer[] );
+
+/**
+ * This function copies the chars that aren't whitespace into the buffer one at a time,
+ * packed together in the same order. Each char is always written and the position in
+ * the buffer only moves past it if it is kept, so there is no branching. This works on
+ * every CPU and is used by the other engines for the chars that don't fill a whole
+ * register. Whitespace is the same in every alphabet, so there is only one copy of it.
+ * @param data The chars that will be copied
+ * @param length The number of chars
+ * @param buffer The buffer that will get the chars that aren't whitespace, this needs
+ * room for length chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t compactSpaceScalar ( char const data[], size_t length, char buffer[] );
+
+/**
+ * Declares the scalar engine for an alphabet other than the standard one. The functions
+ * have the alphabet name at the end, like encodeGroupsScalarUrl, and work the same way as
+ * the functions for the standard alphabet.
+ */
+#define SCALAR_ENGINE_PROTOTYPES( suffix ) \
+    size_t encodeGroupsScalar##suffix ( byte const data[], size_t groups, char buffer[] ); \
+    size_t encodeLinesScalar##suffix ( byte const data[], size_t lines, size_t lineGroups, \
+                                       char const ending[], size_t endingLength, \
+                                       char buffer[] ); \
+    size_t decodeGroupsScalar##suffix ( char const data[], size_t groups, byte buffer[] );
+
+SCALAR_ENGINE_PROTOTYPES( Url )
+SCALAR_ENGINE_PROTOTYPES( Imap )
+
+/**
+ * This function decodes whole groups of 4 chars into groups of 3 bytes using the engine
+ * that has been picked. Decoding stops
+ * at the first group that has a char that isn't in the alphabet, like a newline
+ * or an equal sign, so the caller can handle that group using a State24.
+ * @param data The chars that will be decoded, this should have 4 chars for each group
+ * @param groups The number of groups of 4 chars to decode
+ * @param buffer The buffer that will get 3 bytes for each group
+ * @return size_t The number of groups that were decoded
+ */
+size_t decodeGroups ( char const data[], size_t groups, byte buffer[] );
+
+/**
+ * This function copies the chars that aren't whitespace into the buffer using the
+ * engine that has been picked, so an input with line breaks or indenting can be decoded
+ * as one run of chars. If no engine has been picked yet then the fastest engine is
+ * picked first.
+ * @param data The chars that will be copied
+ * @param length The number of chars
+ * @param buffer The buffer that will get the chars that aren't whitespace, this needs
+ * room for length chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t compactSpace ( char const data[], size_t length, char buffer[] );
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * @file compress.c
+ * @author Daniel Avisse (djavisse)
+ * This is the compress component. This component holds the pipeline stages that
+ * compress bytes into a gzip stream before they are encoded, and decompress the gzip
+ * stream after it is decoded, using zlib. Each stage takes buffers from one channel and
+ * fills the buffers of the next, so the compression runs on its own core while the
+ * other stages read, encode, decode or write.
+ */
+
+#include <zlib.h>
+#include "compress.h"
+
+/**
+ * This function is a helper function that fails both channels of a stage, so the stages
+ * on either side stop.
+ * @param stage The CompressStage that failed
+ * @param error The error, or NULL if another stage failed first
+ * @return void* NULL, so the stage can return it
+ */
+static void *failStage ( CompressStage *stage, char const *error )
+{
+    stage->error = error;
+    failChannel( stage->input );
+    failChannel( stage->output );
+    return NULL;
+}
+
+/**
+ * This function is a helper function that passes the full output buffer of a stage on
+ * and points zlib at the next one.
+ * @param stage The CompressStage
+ * @param stream The zlib stream writing into the output buffer
+ * @return true If there is a next buffer
+ * @return false If the output channel has failed
+ */
+static bool nextBuffer ( CompressStage *stage, z_stream *stream )
+{
+    if ( stream->next_out ) {
+        publishChannel( stage->output, stage->output->size - stream->avail_out );
+    }
+    byte *buffer = reserveChannel( stage->output );
+    stream->next_out = buffer;
+    stream->avail_out = buffer ? stage->output->size : 0;
+    return buffer != NULL;
+}
+
+void *compressStage ( void *arg )
+{
+    CompressStage *stage = ( CompressStage * )arg;
+    z_stream stream;
+    memset( &stream, 0, sizeof( stream ) );
+    if ( deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS,
+                       GZIP_MEMORY_LEVEL, Z_DEFAULT_STRATEGY ) != Z_OK ) {
+        return failStage( stage, GZIP_MEMORY_ERROR );
+    }
+    bool running = nextBuffer( stage, &stream );
+    int status = Z_OK;
+    //Compress each buffer, finishing the stream once there are no more
+    while ( running ) {
+        size_t count;
+        byte *data = takeChannel( stage->input, &count );
+        int flush = data ? Z_NO_FLUSH : Z_FINISH;
+        if ( !data && channelFailed( stage->input ) ) {
+            running = false;
+            break;
+        }
+        stream.next_in = data;
+        stream.avail_in = count;
+        do {
+            //Pass the output buffer on once it is full
+            if ( stream.avail_out == 0 && !nextBuffer( stage, &stream ) ) {
+                running = false;
+                break;
+            }
+            status = deflate( &stream, flush );
+        } while ( stream.avail_in > 0 || ( flush == Z_FINISH && status != Z_STREAM_END ) );
+        if ( !data ) {
+            break;
+        }
+        releaseChannel( stage->input );
+    }
+    deflateEnd( &stream );
+    if ( !running ) {
+        return failStage( stage, NULL );
+    }
+    //Pass on the last output buffer
+    publishChannel( stage->output, stage->output->size - stream.avail_out );
+    endChannel( stage->output );
+    return NULL;
+}
+
+void *decompressStage ( void *arg )
+{
+    CompressStage *stage = ( CompressStage * )arg;
+    z_stream stream;
+    memset( &stream, 0, sizeof( stream ) );
+    if ( inflateInit2( &stream, GZIP_WINDOW_BITS ) != Z_OK ) {
+        return failStage( stage, GZIP_MEMORY_ERROR );
+    }
+    if ( !nextBuffer( stage, &stream ) ) {
+        inflateEnd( &stream );
+        return failStage( stage, NULL );
+    }
+    int status = Z_OK;
+    size_t count;
+    byte *data;
+    while ( ( data = takeChannel( stage->input, &count ) ) ) {
+        stream.next_in = data;
+        stream.avail_in = count;
+        //Decompress until the buffer is used up and the output buffer isn't full
+        while ( stream.avail_in > 0 || stream.avail_out == 0 ) {
+            if ( stream.avail_out == 0 && !nextBuffer( stage, &stream ) ) {
+                inflateEnd( &stream );
+                return failStage( stage, NULL );
+            }
+            //Start the next member once one has finished and there are more bytes
+            if ( status == Z_STREAM_END ) {
+                if ( stream.avail_in == 0 ) {
+                    break;
+                }
+                inflateReset( &stream );
+            }
+            status = inflate( &stream, Z_NO_FLUSH );
+            if ( status == Z_NEED_DICT || status == Z_DATA_ERROR || status == Z_MEM_ERROR ) {
+                inflateEnd( &stream );
+                return failStage( stage, status == Z_MEM_ERROR ? GZIP_MEMORY_ERROR :
+                                                                 GZIP_DATA_ERROR );
+            }
+        }
+        releaseChannel( stage->input );
+    }
+    inflateEnd( &stream );
+    if ( channelFailed( stage->input ) ) {
+        return failStage( stage, NULL );
+    }
+    //The stream has to finish at the end of a member
+    if ( status != Z_STREAM_END ) {
+        return failStage( stage, GZIP_TRUNCATED_ERROR );
+    }
+    publishChannel( stage->output, stage->output->size - stream.avail_out );
+    endChannel( stage->output );
+    return NULL;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file compress.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the compress.c component. In this file it contains all the
+ * constants, structs and protypes used in compress.c
+ */
+
+#ifndef _COMPRESS_H_
+#define _COMPRESS_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include pipeline to get the Channel the stages read from and write to.
+#include "pipeline.h"
+
+/** The command used to compress with gzip before encoding, or decompress after decoding */
+#define GZIP_COMMAND "--gzip"
+
+/** The window bits given to zlib, the largest window along with a gzip header */
+#define GZIP_WINDOW_BITS ( 15 + 16 )
+
+/** The amount of memory zlib uses while compressing, this is the zlib default */
+#define GZIP_MEMORY_LEVEL 8
+
+/** The error for compressed bytes that aren't gzip or are damaged */
+#define GZIP_DATA_ERROR "The decoded bytes aren't valid gzip"
+
+/** The error for compressed bytes that stop before the end of the gzip stream */
+#define GZIP_TRUNCATED_ERROR "The gzip stream ends early"
+
+/** The error for zlib running out of memory */
+#define GZIP_MEMORY_ERROR "Out of memory"
+
+/**
+ * This is the CompressStage struct. It holds what a compressing or decompressing stage
+ * of a pipeline needs.
+ */
+typedef struct {
+  /** The channel the bytes are taken from. */
+  Channel *input;
+
+  /** The channel the compressed or decompressed bytes are put in. */
+  Channel *output;
+
+  /** The error if the stage failed, or NULL if it didn't. */
+  char const *error;
+} CompressStage;
+
+/**
+ * This function is the stage that compresses the bytes in one channel into a gzip stream
+ * in the next channel. Each buffer of the next channel is filled before it is passed on.
+ * @param arg The CompressStage
+ * @return void* NULL once all the bytes have been compressed
+ */
+void *compressStage ( void *arg );
+
+/**
+ * This function is the stage that decompresses a gzip stream in one channel into the
+ * next channel. A stream made of more than one gzip member, like files joined with cat,
+ * is decompressed into all of their bytes. If the stream isn't valid then the error is
+ * kept and both channels are failed.
+ * @param arg The CompressStage
+ * @return void* NULL once the whole stream has been decompressed
+ */
+void *decompressStage ( void *arg );
+
+#endif
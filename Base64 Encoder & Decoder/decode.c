@@ -2,118 +2,1064 @@
  * @file decode.c
  * @author Daniel Avisse (djavisse)
  * This is the deconde component and is the main component of the decode program.
- * This component creates a filebuffer that will contain all the bytes that will
- * be outputted to a new binary file. This component will first read an encoded file
- * and get all the chars and add them into a state24 to get the bytes from those chars.
- * Once all the chars have been added to the filebuffer then the new file will be created.
+ * This component reads an encoded file one chunk at a time and adds the chars into
+ * a state24 to get the bytes from those chars, which are written to the new binary
+ * file. The decoding itself is done by libbase64, and this component only moves the
+ * chars and bytes between the files.
  */
 
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "filebuffer.h"
 #include "state24.h"
+#include "codec.h"
+#include "base64.h"
+#include "check.h"
+#include "range.h"
+#include "digest.h"
+#include "pipeline.h"
+#include "compress.h"
+#include "batch.h"
+#include "stats.h"
+#include "stream.h"
+#include "uring.h"
 
-/** Value used when working with command line arguments */
-#define ARG_VALUE_THREE 3
+/** Number of chars read from the input file at a time */
+#define CHUNK_SIZE 65536
+
+/** Size of the buffer holding the bytes decoded from one chunk */
+#define OUTPUT_CHUNK_SIZE ( CHUNK_SIZE / MAX_NUMBER_OF_CHARS * MAX_NUMBER_OF_BYTES + \
+                            MAX_NUMBER_OF_BYTES )
+
+/** Number of chars scanned and decoded at a time by each thread, this is a whole number of pages */
+#define PARALLEL_CHUNK_SIZE 1048576
+
+/** The most threads that can be used to decode */
+#define MAX_THREADS 1024
+
+/** The command used to use the URL and file name safe alphabet */
+#define URL_COMMAND "--url"
+
+/** The command used to pick the alphabet by name */
+#define ALPHABET_COMMAND "--alphabet"
+
+/** The command used to check the input file without writing an output file */
+#define CHECK_COMMAND "--check"
+
+/** The command used to skip all whitespace in the input file, not just newlines */
+#define LENIENT_COMMAND "--lenient"
+
+/** The alphabet picked by the URL command */
+#define URL_ALPHABET_NAME "url"
+
+/** The command used to pick the number of threads used to decode */
+#define THREADS_COMMAND "-j"
 
 /** Value used when working with command line arguments */
 #define ARG_VALUE_TWO 2
 
+/** The usage message printed when the arguments are incorrect */
+#define USAGE "usage: decode [--url | --alphabet name] [--lenient] [-j threads | --gzip] " \
+              "[--digest | --digest-file file] [--verify digest] [--stats] " \
+              "<input-file> <output-file>\n" \
+              "       decode [--url | --alphabet name] [--lenient] [-j threads] " \
+              "[--stats] --batch <manifest>\n" \
+              "       decode [--url | --alphabet name] [--lenient] [-j threads] " \
+              "[--stats] --tree <input-dir> <output-dir>\n" \
+              "       decode [--url | --alphabet name] [--lenient] [--stats] " \
+              "--check <input-file>\n" \
+              "       decode [--url | --alphabet name] [--lenient] " \
+              "[--digest | --digest-file file] [--verify digest] [--stats] " \
+              "--range START:LEN <input-file> <output-file>\n" \
+              "       decode --index <input-file>\n"
+
+/** Value used when working with the arguments of the tree command */
+#define ARG_VALUE_THREE 3
+
 /**
- * This is the main function of decode. This function will decode the encoded inputfile
- * by getting all the chars in the file and adding them into a state24. Once the state24
- * is full, the bytes will be retrieved from the state24 and then added to a filebuffer.
- * The filebuffer will then be used to output all the bytes to a new binary file.
- * @return int EXIT_SUCCESS
+ * This is the DecodeChunk struct. It holds what the scan of one chunk of the input file
+ * found, which is used to work out where the bytes decoded from the chunk go.
  */
-int main ( int argc, char *argv[] ) 
+typedef struct {
+  /** Number of chars in the chunk that are not newlines or equal signs. */
+  size_t chars;
+
+  /** Number of chars that are not newlines or equal signs in all the chunks before this one. */
+  size_t charsBefore;
+
+  /** Offset of the first equal sign in the chunk, or the end of the file if there isn't one. */
+  size_t firstEqual;
+
+  /** Offset in the input file where this chunk starts decoding its first whole group. */
+  size_t start;
+} DecodeChunk;
+
+/**
+ * This is the DecodeJobs struct. It holds the chunks of a mapped input file that are
+ * being scanned or decoded by a pool of threads. Each thread takes the next chunk that
+ * hasn't been done yet until there are none left.
+ */
+typedef struct {
+  /** The mapped input file being decoded. */
+  FileBuffer *input;
+
+  /** The mapped output file the chunks are decoded into. */
+  FileBuffer *output;
+
+  /** What the scan found in each chunk. */
+  DecodeChunk *chunks;
+
+  /** The number of chunks the input file is split into. */
+  size_t count;
+
+  /** The next chunk that hasn't been taken by a thread yet. */
+  size_t nextChunk;
+
+  /** Lock used when taking the next chunk or marking the input invalid. */
+  pthread_mutex_t lock;
+
+  /** Offset of the first equal sign in the input file. */
+  size_t firstEqual;
+
+  /** Set to true if any thread finds an invalid char, while holding the lock. */
+  bool invalid;
+} DecodeJobs;
+
+/**
+ * This is the ChunkState struct. It holds what is kept between the chunks read by
+ * io_uring, the Decoder and the Digest of the bytes.
+ */
+typedef struct {
+  /** The Decoder holding where the last chunk left off. */
+  Decoder *decoder;
+
+  /** The Digest the bytes decoded from each chunk are added to. */
+  Digest *digest;
+} ChunkState;
+
+/**
+ * This is the DecodeStage struct. It holds what the stage that decodes the chars in one
+ * channel of a pipeline into the bytes in the next channel needs.
+ */
+typedef struct {
+  /** The channel the chars are taken from. */
+  Channel *input;
+
+  /** The channel the decoded bytes are put in. */
+  Channel *output;
+
+  /** True if all whitespace is skipped, not just newlines. */
+  bool lenient;
+
+  /** Set to true if an invalid char is found. */
+  bool invalid;
+} DecodeStage;
+
+/**
+ * This function is a helper function that works out the most bytes that can be decoded
+ * from an input file. Every 4 chars in the input file decode to at most 3 bytes.
+ * @param stream The input file that will be decoded
+ * @return size_t The most bytes the input file can decode to, or zero if the size of
+ * the input file isn't known
+ */
+static size_t maxDecodedLength ( FILE *stream )
+{
+    //Only regular files have a size that is known ahead of time
+    struct stat info;
+    if ( fstat( fileno( stream ), &info ) != 0 || !S_ISREG( info.st_mode ) ) {
+        return 0;
+    }
+    return info.st_size / MAX_NUMBER_OF_CHARS * MAX_NUMBER_OF_BYTES + MAX_NUMBER_OF_BYTES;
+}
+
+/**
+ * This function is a helper function that starts a pool of threads running the same
+ * function and waits for all of them to finish.
+ * @param threads The number of threads to start
+ * @param worker The function each thread runs
+ * @param jobs The DecodeJobs passed to each thread
+ */
+static void runThreads ( int threads, void *( *worker )( void * ), DecodeJobs *jobs )
+{
+    pthread_t workers[MAX_THREADS];
+    jobs->nextChunk = 0;
+    for ( int i = 0; i < threads; i++ ) {
+        if ( pthread_create( &workers[i], NULL, worker, jobs ) != 0 ) {
+            perror( "pthread_create" );
+            exit( EXIT_FAILURE );
+        }
+    }
+    for ( int i = 0; i < threads; i++ ) {
+        pthread_join( workers[i], NULL );
+    }
+}
+
+/**
+ * This function is a helper function used by the threads to take the next chunk.
+ * @param jobs The DecodeJobs being done
+ * @return size_t The chunk that was taken, or the number of chunks if there are none left
+ */
+static size_t takeChunk ( DecodeJobs *jobs )
+{
+    pthread_mutex_lock( &jobs->lock );
+    size_t chunk = jobs->nextChunk;
+    if ( chunk < jobs->count ) {
+        jobs->nextChunk++;
+    }
+    pthread_mutex_unlock( &jobs->lock );
+    return chunk;
+}
+
+/**
+ * This function is run by each thread in the pool while scanning. It counts the newlines
+ * and equal signs in each chunk it takes, which gives the number of chars that will be
+ * decoded, and finds the first equal sign in the chunk.
+ * @param arg The DecodeJobs being scanned
+ * @return void* NULL once there are no chunks left
+ */
+static void *scanWorker ( void *arg )
+{
+    DecodeJobs *jobs = ( DecodeJobs * )arg;
+    size_t chunk;
+    while ( ( chunk = takeChunk( jobs ) ) < jobs->count ) {
+        size_t start = chunk * PARALLEL_CHUNK_SIZE;
+        size_t end = start + PARALLEL_CHUNK_SIZE;
+        if ( end > jobs->input->count ) {
+            end = jobs->input->count;
+        }
+        char const *data = ( char const * )jobs->input->data;
+        //Count the newlines, these are far apart so memchr can skip over the lines
+        size_t skipped = 0;
+        char const *next = data + start;
+        while ( ( next = ( char const * )memchr( next, '\n', data + end - next ) ) ) {
+            skipped++;
+            next++;
+        }
+        //Count the equal signs and find the first one
+        jobs->chunks[chunk].firstEqual = jobs->input->count;
+        next = data + start;
+        while ( ( next = ( char const * )memchr( next, '=', data + end - next ) ) ) {
+            if ( jobs->chunks[chunk].firstEqual == jobs->input->count ) {
+                jobs->chunks[chunk].firstEqual = next - data;
+            }
+            skipped++;
+            next++;
+        }
+        jobs->chunks[chunk].chars = end - start - skipped;
+    }
+    return NULL;
+}
+
+/**
+ * This function is a helper function that finds where a chunk starts decoding. A chunk
+ * starts at its first char that begins a whole group, which can be a few chars into
+ * the chunk if the group before it was split between two chunks.
+ * @param jobs The DecodeJobs being decoded
+ * @param chunk The chunk to find the start of
+ * @return size_t The offset of the first char of the first group that starts in the chunk
+ */
+static size_t groupStart ( DecodeJobs *jobs, size_t chunk )
+{
+    //Skip the chars that finish the group started in the chunk before
+    size_t skip = ( MAX_NUMBER_OF_CHARS - jobs->chunks[chunk].charsBefore %
+                    MAX_NUMBER_OF_CHARS ) % MAX_NUMBER_OF_CHARS;
+    size_t offset = chunk * PARALLEL_CHUNK_SIZE;
+    while ( offset < jobs->input->count ) {
+        char ch = jobs->input->data[offset];
+        if ( ch != '\n' && ch != '=' ) {
+            if ( skip == 0 ) {
+                break;
+            }
+            skip--;
+        }
+        offset++;
+    }
+    return offset;
+}
+
+/**
+ * This function is run by each thread in the pool while decoding. Each chunk it takes
+ * is decoded from the first group that starts in it up to the first group that starts
+ * in the next chunk, straight into its place in the output file.
+ * @param arg The DecodeJobs being decoded
+ * @return void* NULL once there are no chunks left
+ */
+static void *decodeWorker ( void *arg )
+{
+    DecodeJobs *jobs = ( DecodeJobs * )arg;
+    size_t chunk;
+    while ( ( chunk = takeChunk( jobs ) ) < jobs->count ) {
+        size_t start = jobs->chunks[chunk].start;
+        size_t end = jobs->input->count;
+        if ( chunk + 1 < jobs->count ) {
+            end = jobs->chunks[chunk + 1].start;
+        }
+        //Work out where the first group that starts in this chunk goes in the output
+        size_t groups = ( jobs->chunks[chunk].charsBefore + MAX_NUMBER_OF_CHARS - 1 ) /
+                        MAX_NUMBER_OF_CHARS;
+        size_t outCount = 0;
+        Decoder decoder;
+        initDecoder( &decoder );
+        //Any char that isn't a newline or equal sign after an equal sign is invalid
+        decoder.equalFlag = jobs->firstEqual < start;
+        byte *output = jobs->output->data + groups * MAX_NUMBER_OF_BYTES;
+        if ( !decodeUpdate( &decoder, ( char const * )jobs->input->data + start, end - start,
+                            output, &outCount ) ) {
+            pthread_mutex_lock( &jobs->lock );
+            jobs->invalid = true;
+            pthread_mutex_unlock( &jobs->lock );
+        }
+        decodeFinish( &decoder, output + outCount );
+        //Release the pages of the chunk so memory use stays flat
+        releaseFileBuffer( jobs->input, start, end );
+        releaseFileBuffer( jobs->output, groups * MAX_NUMBER_OF_BYTES,
+                           groups * MAX_NUMBER_OF_BYTES + outCount );
+    }
+    return NULL;
+}
+
+/**
+ * This function is a helper function that decodes a mapped input file into a mapped
+ * output file using a pool of threads. First the threads scan the chunks of the input
+ * file to count the chars that will be decoded in each one. Adding up the counts gives
+ * where the bytes of each chunk go and the exact size of the output file, so the threads
+ * can decode all the chunks straight into their places in it.
+ * @param input The mapped input file
+ * @param output The mapped output file, which has room for the most bytes the input can
+ * decode to
+ * @param threads The number of threads to use
+ * @param stats The stats kept for --stats
+ * @return true If the input file was decoded
+ * @return false If the input file has an invalid char
+ */
+static bool decodeParallel ( FileBuffer *input, FileBuffer *output, int threads,
+                             Stats *stats )
+{
+    DecodeJobs jobs;
+    jobs.input = input;
+    jobs.count = ( input->count + PARALLEL_CHUNK_SIZE - 1 ) / PARALLEL_CHUNK_SIZE;
+    jobs.chunks = ( DecodeChunk * )malloc( jobs.count * sizeof( DecodeChunk ) );
+    jobs.invalid = false;
+    pthread_mutex_init( &jobs.lock, NULL );
+    //Scan the chunks to count their chars
+    runThreads( threads, scanWorker, &jobs );
+    //Add up the counts to get the chars before each chunk
+    size_t chars = 0;
+    jobs.firstEqual = input->count;
+    for ( size_t i = 0; i < jobs.count; i++ ) {
+        jobs.chunks[i].charsBefore = chars;
+        chars += jobs.chunks[i].chars;
+        if ( jobs.chunks[i].firstEqual < jobs.firstEqual ) {
+            jobs.firstEqual = jobs.chunks[i].firstEqual;
+        }
+    }
+    for ( size_t i = 0; i < jobs.count; i++ ) {
+        jobs.chunks[i].start = groupStart( &jobs, i );
+    }
+    //Decode the chunks into the outputfile, which is cut down to its exact size after
+    jobs.output = output;
+    runThreads( threads, decodeWorker, &jobs );
+    output->count = decodedCharsLength( chars );
+    stats->bytesOut = output->count;
+    pthread_mutex_destroy( &jobs.lock );
+    free( jobs.chunks );
+    return !jobs.invalid;
+}
+
+/**
+ * This function decodes one chunk read by io_uring. It is the ChunkFunction passed to
+ * runUring.
+ * @param state The ChunkState holding where the last chunk left off
+ * @param data The chars of the chunk
+ * @param length The number of chars in the chunk
+ * @param output The buffer that gets the decoded bytes
+ * @param outCount Gets the number of bytes decoded
+ * @return true If all the chars were valid
+ * @return false If an invalid char was found
+ */
+static bool decodeChunk ( void *state, byte const data[], size_t length, byte output[],
+                          size_t *outCount )
+{
+    ChunkState *chunkState = ( ChunkState * )state;
+    *outCount = 0;
+    if ( !decodeUpdate( chunkState->decoder, ( char const * )data, length, output,
+                        outCount ) ) {
+        return false;
+    }
+    digestUpdate( chunkState->digest, output, *outCount );
+    return true;
+}
+
+/**
+ * This function is the stage of a pipeline that decodes the chars in one channel into
+ * the bytes in the next channel. Each buffer of chars is decoded into its own buffer of
+ * bytes, and the bytes left in the Decoder at the end are passed on in a last buffer.
+ * If an invalid char is found then both channels are failed.
+ * @param arg The DecodeStage
+ * @return void* NULL once all the chars have been decoded
+ */
+static void *decodeStage ( void *arg )
+{
+    DecodeStage *stage = ( DecodeStage * )arg;
+    Decoder decoder;
+    initDecoderLenient( &decoder, stage->lenient );
+    size_t length;
+    char const *data;
+    while ( ( data = ( char const * )takeChannel( stage->input, &length ) ) ) {
+        byte *output = reserveChannel( stage->output );
+        size_t count = 0;
+        if ( !output || !decodeUpdate( &decoder, data, length, output, &count ) ) {
+            stage->invalid = output != NULL;
+            failChannel( stage->input );
+            failChannel( stage->output );
+            return NULL;
+        }
+        releaseChannel( stage->input );
+        publishChannel( stage->output, count );
+    }
+    if ( channelFailed( stage->input ) ) {
+        failChannel( stage->output );
+        return NULL;
+    }
+    //Pass on the bytes left in the State24 at the end
+    byte *output = reserveChannel( stage->output );
+    if ( output ) {
+        publishChannel( stage->output, decodeFinish( &decoder, output ) );
+        endChannel( stage->output );
+    }
+    return NULL;
+}
+
+/**
+ * This function is a helper function used to decode the encoded input file and
+ * decompress the decoded bytes with gzip. This is done by a pipeline of four stages,
+ * each on its own thread: one reads the input file, one decodes the chars, one
+ * decompresses the bytes, and this thread writes them to the output file. The stages
+ * pass the bytes through channels with a few buffers each, so they all run at the same
+ * time using the same amount of memory for any size of file, and the compressed bytes
+ * are never written to disk. The digest is of the bytes after they are decompressed.
+ * If the input file isn't valid, or the decoded bytes aren't valid gzip, then the
+ * output file is removed.
+ * @param inputfile The encoded input file
+ * @param outputfile The output binary file
+ * @param lenient True if all whitespace is skipped, not just newlines
+ * @param digest The Digest the decompressed bytes are added to
+ * @param stats The stats kept for --stats
+ */
+static void decodeCompressed ( char inputfile[], char outputfile[], bool lenient,
+                               Digest *digest, Stats *stats )
+{
+    //Open the inputfile, "-" is the standard input
+    FILE *inStream = openStream( inputfile, "r" );
+    if ( !inStream ) {
+        perror( inputfile );
+        exit( EXIT_FAILURE );
+    }
+    //Open the outputfile in binary write mode, "-" is the standard output
+    FILE *outStream = openStream( outputfile, "wb" );
+    if ( !outStream ) {
+        perror( outputfile );
+        fclose( inStream );
+        exit( EXIT_FAILURE );
+    }
+    StreamWriter writer;
+    initWriter( &writer, outStream, OUTPUT_CHUNK_SIZE * sizeof( byte ) );
+    //Start the stages that read the inputfile, decode it and decompress it
+    Channel chars;
+    Channel compressed;
+    Channel decompressed;
+    initChannel( &chars, CHUNK_SIZE );
+    initChannel( &compressed, OUTPUT_CHUNK_SIZE );
+    initChannel( &decompressed, OUTPUT_CHUNK_SIZE );
+    Digest none;
+    initDigest( &none );
+    ReadStage reader = { fileno( inStream ), &chars, &none, 0, 0 };
+    DecodeStage decoder = { &chars, &compressed, lenient, false };
+    CompressStage decompressor = { &compressed, &decompressed, NULL };
+    pthread_t readThread;
+    pthread_t decodeThread;
+    pthread_t decompressThread;
+    startStage( &readThread, readStage, &reader );
+    startStage( &decodeThread, decodeStage, &decoder );
+    startStage( &decompressThread, decompressStage, &decompressor );
+    //Write the decompressed bytes as they come, adding them to the digest on the way
+    switchPhase( stats, PHASE_CONVERT );
+    size_t count;
+    byte *data;
+    while ( ( data = takeChannel( &decompressed, &count ) ) ) {
+        digestUpdate( digest, data, count );
+        writeStream( &writer, data, count );
+        releaseChannel( &decompressed );
+        stats->bytesOut += count;
+    }
+    pthread_join( readThread, NULL );
+    pthread_join( decodeThread, NULL );
+    pthread_join( decompressThread, NULL );
+    stats->bytesIn = reader.count;
+    //A read failed, the chars weren't valid or the bytes weren't valid gzip. Remove the
+    //outputfile, exit and print error message
+    if ( reader.error || decoder.invalid || decompressor.error ) {
+        if ( reader.error ) {
+            errno = reader.error;
+            perror( inputfile );
+        } else {
+            fprintf( stderr, "%s\n", decoder.invalid ? "Invalid input file" :
+                                                        decompressor.error );
+        }
+        fclose( outStream );
+        removeStream( outputfile );
+        exit( EXIT_FAILURE );
+    }
+    switchPhase( stats, PHASE_FINISH );
+    //Free everything
+    freeWriter( &writer );
+    freeChannel( &chars );
+    freeChannel( &compressed );
+    freeChannel( &decompressed );
+    fclose( inStream );
+    fclose( outStream );
+}
+
+/**
+ * This function is a helper function used to help decode the encoded input file into
+ * a binary file. The chars in the file are read one chunk at a time and added into a
+ * state24. Once the state24 is full, the bytes will be retrieved from the state24 and
+ * added to the output file. When it can be, the output file is created at the largest
+ * size the input can decode to and mapped, so the bytes are written straight into it,
+ * and it is cut down to the right size at the end. Otherwise the bytes go into an output
+ * buffer that is written to the new binary file after each chunk. Any bits
+ * left in the state24 at the end of a chunk are carried over to the next chunk, so
+ * files of any size can be decoded using the same amount of memory. When more than one
+ * thread is used and the input file can be mapped, the chunks are decoded by a pool of
+ * threads instead. The pool finds where each chunk goes by counting newlines, so when
+ * all whitespace is skipped the file is decoded by one thread. The digest is worked out
+ * in order, so the file is also decoded by one thread when there is a digest. When the
+ * output file can't be mapped the input file is read with io_uring, unless BASE64_IO is
+ * stdio. Either file can be "-" to use the standard input or the standard output. If the
+ * input file turns out to be invalid then the partly written output file is removed.
+ * @param inputfile The encoded input file
+ * @param outputfile The output binary file
+ * @param threads The number of threads used to decode
+ * @param lenient True if all whitespace is skipped, not just newlines
+ * @param digest The Digest the bytes decoded from each chunk are added to
+ * @param stats The stats kept for --stats
+ */
+static void decode ( char inputfile[], char outputfile[], int threads, bool lenient,
+                     Digest *digest, Stats *stats )
 {
-    //If the incorrect amount of arguments is used then exit the program with usage message
-    if ( argc != ARG_VALUE_THREE ) {
-        fprintf( stderr, "usage: decode <input-file> <output-file>\n" );
-        exit( EXIT_FAILURE );
-    }
-    //Make a new fileBuffer
-    FileBuffer *decodeFileBuffer = makeFileBuffer();
-    //Create a new State24 and initialize it
-    State24 *newState24 = ( State24 * )malloc( sizeof( State24 ) );
-    initState( newState24 );
-    //Open the inputfile
-    FILE *inStream = fopen( argv[1], "r" );
+    //Open the inputfile, "-" is the standard input
+    FILE *inStream = openStream( inputfile, "r" );
     //If the inputfile can't be open then exit with error message
     if ( !inStream ) {
-        perror( argv[1] );
-        exit( EXIT_FAILURE );
-    }
-    //Go to the end of the file
-    fseek( inStream, 0, SEEK_END );
-    //Get the length of the file
-    int fileLength = ftell( inStream );
-    //Go back to the beginning of the file
-    rewind( inStream );
-    //Create a charBuffer to hold all the chars
-    char charBuffer[fileLength];
-    //Create a miniByteBuffer to hold the bytes that will then be added to the filebuffer
-    byte miniByteBuffer[MAX_NUMBER_OF_BYTES];
-    int miniByteBufferCount = 0;
-    char ch;
-    //Flag that checks when an equal sign is found
-    bool equalFlag = false;
-    //Start adding all the chars into the charBuffer
-    for( int i = 0; i < fileLength; i++ ) {
-        ch = fgetc( inStream );
-        //If the char is valid and doesn't come after a equal sign then add it to the buffer
-        if ( validChar( ch ) && !equalFlag ) {
-            charBuffer[i] = ch;
-        }
-        //Add the char to the buffer and set the equal fag to true
-        else if ( ch == '=' ) {
-            charBuffer[i] = ch;
-            equalFlag = true;
-        }
-        //If the char is a newline then add that as well
-        else if ( ch == '\n' ) {
-            charBuffer[i] = ch;
-        }
-        //The char wasn't valid. Exit the program and print error message
+        perror( inputfile );
+        exit( EXIT_FAILURE );
+    }
+    //Open the outputfile in binary write mode, and for reading too so that it can be mapped,
+    //"-" is the standard output
+    FILE *outStream = openStream( outputfile, "wb+" );
+    //If the outputfile can't be opened or made then exit with error message
+    if ( !outStream ) {
+        perror( outputfile );
+        fclose( inStream );
+        exit( EXIT_FAILURE );
+    }
+    //Decode the inputfile using a pool of threads if there is more than one and both files
+    //can be mapped, otherwise it is decoded one chunk at a time so memory use stays flat
+    if ( threads > 1 && !lenient && !digest->enabled ) {
+        FileBuffer *input = mapFileBuffer( fileno( inStream ) );
+        FileBuffer *output = input ? mapOutputFileBuffer( fileno( outStream ),
+                                                          maxDecodedLength( inStream ) ) : NULL;
+        if ( output ) {
+            stats->bytesIn = input->count;
+            switchPhase( stats, PHASE_CONVERT );
+            bool valid = decodeParallel( input, output, threads, stats );
+            switchPhase( stats, PHASE_FINISH );
+            if ( valid ) {
+                finishFileBuffer( output, fileno( outStream ) );
+            } else {
+                freeFileBuffer( output );
+            }
+            freeFileBuffer( input );
+            fclose( inStream );
+            fclose( outStream );
+            //The input wasn't valid. Remove the outputfile, exit and print error message
+            if ( !valid ) {
+                fprintf( stderr, "Invalid input file\n" );
+                removeStream( outputfile );
+                exit( EXIT_FAILURE );
+            }
+            return;
+        }
+        if ( input ) {
+            freeFileBuffer( input );
+        }
+    }
+    //Create a new Decoder to convert the chars to bytes, this keeps any partial group
+    Decoder decoder;
+    initDecoderLenient( &decoder, lenient );
+    //Create the buffers used to hold one chunk of chars and the bytes decoded from it
+    char *charBuffer = ( char * )malloc( CHUNK_SIZE * sizeof( char ) );
+    StreamWriter writer;
+    initWriter( &writer, outStream, OUTPUT_CHUNK_SIZE * sizeof( byte ) );
+    byte *byteBuffer;
+    size_t byteBufferCount = 0;
+    //Map the outputfile so the bytes are decoded straight into it
+    FileBuffer *decodeFileBuffer = mapOutputFileBuffer( fileno( outStream ),
+                                                        maxDecodedLength( inStream ) );
+    size_t released = 0;
+
+    //When the outputfile isn't mapped use io_uring, so the next chunk is read and the last
+    //one written while this one is decoded, unless stdio was asked for
+    int status = URING_UNAVAILABLE;
+    char const *backend = getenv( IO_VARIABLE );
+    if ( !decodeFileBuffer && ( !backend || strcmp( backend, STDIO_BACKEND ) != 0 ) ) {
+        switchPhase( stats, PHASE_CONVERT );
+        ChunkState state = { &decoder, digest };
+        status = runUring( fileno( inStream ), &writer, CHUNK_SIZE, decodeChunk, &state,
+                           stats );
+    }
+    //The chars weren't valid, or a read or write failed and the message has been reported.
+    //Remove the partly written outputfile and exit the program
+    if ( status == URING_INVALID || status == URING_FAILED ) {
+        if ( status == URING_INVALID ) {
+            fprintf( stderr, "Invalid input file\n" );
+        }
+        free( charBuffer );
+        freeWriter( &writer );
+        fclose( inStream );
+        fclose( outStream );
+        removeStream( outputfile );
+        exit( EXIT_FAILURE );
+    }
+
+    //Otherwise read the inputfile one chunk at a time
+    size_t length;
+    switchPhase( stats, PHASE_READ );
+    while ( status == URING_UNAVAILABLE &&
+            ( length = fread( charBuffer, sizeof( char ), CHUNK_SIZE, inStream ) ) > 0 ) {
+        stats->bytesIn += length;
+        switchPhase( stats, PHASE_CONVERT );
+        byteBufferCount = 0;
+        //Decode into the mapped outputfile if there is one
+        byteBuffer = decodeFileBuffer ? decodeFileBuffer->data + decodeFileBuffer->count :
+                                        ( byte * )writerBuffer( &writer );
+        //The chars weren't valid. Exit the program and print error message
+        if ( !decodeUpdate( &decoder, charBuffer, length, byteBuffer, &byteBufferCount ) ) {
+            fprintf( stderr, "Invalid input file\n" );
+            free( charBuffer );
+            freeWriter( &writer );
+            fclose( inStream );
+            //Remove the partly written outputfile
+            if ( decodeFileBuffer ) {
+                freeFileBuffer( decodeFileBuffer );
+            }
+            fclose( outStream );
+            removeStream( outputfile );
+            exit( EXIT_FAILURE );
+        }
+        //Add the bytes to the digest while they are still in the cache
+        digestUpdate( digest, byteBuffer, byteBufferCount );
+        //Keep the bytes decoded from this chunk in the mapped outputfile
+        if ( decodeFileBuffer ) {
+            decodeFileBuffer->count += byteBufferCount;
+            released = releaseFileBuffer( decodeFileBuffer, released, decodeFileBuffer->count );
+        }
+        //Otherwise write the bytes decoded from this chunk to the outputfile
         else {
+            switchPhase( stats, PHASE_WRITE );
+            writeStream( &writer, byteBuffer, byteBufferCount );
+            stats->bytesOut += byteBufferCount;
+        }
+        switchPhase( stats, PHASE_READ );
+    }
+    //Report error message and exit if the inputfile couldn't be read
+    if ( ferror( inStream ) ) {
+        perror( inputfile );
+        fclose( outStream );
+        removeStream( outputfile );
+        exit( EXIT_FAILURE );
+    }
+    //Get the bytes left in the State24 once we have reached the end
+    switchPhase( stats, PHASE_FINISH );
+    if ( decodeFileBuffer ) {
+        byteBufferCount = decodeFinish( &decoder, decodeFileBuffer->data +
+                                                  decodeFileBuffer->count );
+        digestUpdate( digest, decodeFileBuffer->data + decodeFileBuffer->count,
+                      byteBufferCount );
+        decodeFileBuffer->count += byteBufferCount;
+        stats->bytesOut = decodeFileBuffer->count;
+        finishFileBuffer( decodeFileBuffer, fileno( outStream ) );
+    } else {
+        byteBuffer = ( byte * )writerBuffer( &writer );
+        byteBufferCount = decodeFinish( &decoder, byteBuffer );
+        digestUpdate( digest, byteBuffer, byteBufferCount );
+        writeStream( &writer, byteBuffer, byteBufferCount );
+        stats->bytesOut += byteBufferCount;
+    }
+    //Free everything
+    free( charBuffer );
+    freeWriter( &writer );
+    //Close the streams
+    fclose( inStream );
+    fclose( outStream );
+}
+
+/**
+ * This function is a helper function used to check an encoded input file without
+ * decoding it into an output file. The file is read one chunk at a time, so any size of
+ * file can be checked using the same amount of memory. If the file isn't valid then the
+ * first error is printed along with its line, column and byte offset, and the program
+ * exits.
+ * @param inputfile The encoded input file
+ * @param lenient True if all whitespace is skipped, not just newlines
+ * @param stats The stats kept for --stats
+ */
+static void check ( char inputfile[], bool lenient, Stats *stats )
+{
+    //Open the inputfile, "-" is the standard input
+    FILE *inStream = openStream( inputfile, "r" );
+    //If the inputfile can't be open then exit with error message
+    if ( !inStream ) {
+        perror( inputfile );
+        exit( EXIT_FAILURE );
+    }
+    char *charBuffer = ( char * )malloc( CHUNK_SIZE * sizeof( char ) );
+    Checker checker;
+    initChecker( &checker, lenient );
+    //Check the inputfile one chunk at a time until an error is found
+    size_t length;
+    bool valid = true;
+    switchPhase( stats, PHASE_READ );
+    while ( valid &&
+            ( length = fread( charBuffer, sizeof( char ), CHUNK_SIZE, inStream ) ) > 0 ) {
+        stats->bytesIn += length;
+        switchPhase( stats, PHASE_CONVERT );
+        valid = checkUpdate( &checker, charBuffer, length );
+        switchPhase( stats, PHASE_READ );
+    }
+    //Report error message and exit if the inputfile couldn't be read
+    if ( ferror( inStream ) ) {
+        perror( inputfile );
+        exit( EXIT_FAILURE );
+    }
+    switchPhase( stats, PHASE_FINISH );
+    free( charBuffer );
+    fclose( inStream );
+    //The chars weren't valid. Print where the first error is and exit
+    if ( !checkFinish( &checker ) ) {
+        fprintf( stderr, "%s:%zu:%zu: %s at byte %zu\n", inputfile, checker.errorLine,
+                 checker.errorColumn, checker.error, checker.errorOffset );
+        exit( EXIT_FAILURE );
+    }
+}
+
+/**
+ * This function is a helper function used to decode only a range of the bytes an
+ * encoded input file decodes to. The input file is mapped, and the range component
+ * works out where the group with the first byte of the range is, using the line length
+ * of the file or its index file. The chars are decoded from there one chunk at a time
+ * until the range has been decoded, and only the bytes in the range are written to the
+ * output file. If the range goes past the end then the bytes up to the end are written.
+ * @param inputfile The encoded input file
+ * @param outputfile The output binary file
+ * @param start The offset of the first byte in the range
+ * @param length The number of bytes in the range
+ * @param lenient True if all whitespace is skipped, not just newlines
+ * @param digest The Digest the bytes in the range are added to
+ * @param stats The stats kept for --stats
+ */
+static void decodeRange ( char inputfile[], char outputfile[], size_t start, size_t length,
+                          bool lenient, Digest *digest, Stats *stats )
+{
+    //Open the inputfile, "-" is the standard input
+    FILE *inStream = openStream( inputfile, "r" );
+    //If the inputfile can't be open then exit with error message
+    if ( !inStream ) {
+        perror( inputfile );
+        exit( EXIT_FAILURE );
+    }
+    //The inputfile has to be mapped to go straight to the range, an empty file has no bytes
+    struct stat info;
+    FileBuffer *input = mapFileBuffer( fileno( inStream ) );
+    if ( !input && ( fstat( fileno( inStream ), &info ) != 0 || !S_ISREG( info.st_mode ) ||
+                     info.st_size != 0 ) ) {
+        fprintf( stderr, "%s: Can't map the file to decode a range\n", inputfile );
+        fclose( inStream );
+        exit( EXIT_FAILURE );
+    }
+    //Open the outputfile in binary write mode, "-" is the standard output
+    FILE *outStream = openStream( outputfile, "wb" );
+    //If the outputfile can't be opened or made then exit with error message
+    if ( !outStream ) {
+        perror( outputfile );
+        fclose( inStream );
+        exit( EXIT_FAILURE );
+    }
+    //Find the group with the first byte of the range
+    switchPhase( stats, PHASE_READ );
+    size_t offset = 0;
+    size_t count = input ? input->count : 0;
+    if ( input ) {
+        offset = charOffset( inputfile, input,
+                             start / MAX_NUMBER_OF_BYTES * MAX_NUMBER_OF_CHARS );
+    }
+    //The bytes before the range in its first group are decoded but not written
+    size_t skip = start % MAX_NUMBER_OF_BYTES;
+    size_t end = length < SIZE_MAX - skip ? skip + length : SIZE_MAX;
+    size_t decoded = 0;
+    Decoder decoder;
+    initDecoderLenient( &decoder, lenient );
+    byte *byteBuffer = ( byte * )malloc( OUTPUT_CHUNK_SIZE * sizeof( byte ) );
+    while ( decoded < end && offset < count ) {
+        switchPhase( stats, PHASE_CONVERT );
+        size_t chunk = count - offset < CHUNK_SIZE ? count - offset : CHUNK_SIZE;
+        size_t byteBufferCount = 0;
+        //The chars weren't valid. Remove the outputfile, exit and print error message
+        if ( !decodeUpdate( &decoder, ( char const * )input->data + offset, chunk, byteBuffer,
+                            &byteBufferCount ) ) {
             fprintf( stderr, "Invalid input file\n" );
-            freeFileBuffer( decodeFileBuffer );
-            free( newState24 );
-            fclose(inStream);
+            free( byteBuffer );
+            freeFileBuffer( input );
+            fclose( inStream );
+            fclose( outStream );
+            removeStream( outputfile );
             exit( EXIT_FAILURE );
         }
+        offset += chunk;
+        stats->bytesIn += chunk;
+        //Get the bytes left in the State24 at the end of the inputfile
+        if ( offset == count ) {
+            byteBufferCount += decodeFinish( &decoder, byteBuffer + byteBufferCount );
+        }
+        //Write the bytes of this chunk that are in the range
+        switchPhase( stats, PHASE_WRITE );
+        size_t first = decoded < skip ? skip - decoded : 0;
+        size_t last = end - decoded < byteBufferCount ? end - decoded : byteBufferCount;
+        if ( first < last ) {
+            digestUpdate( digest, byteBuffer + first, last - first );
+            fwrite( byteBuffer + first, sizeof( byte ), last - first, outStream );
+            stats->bytesOut += last - first;
+        }
+        decoded += byteBufferCount;
+    }
+    switchPhase( stats, PHASE_FINISH );
+    //Free everything
+    free( byteBuffer );
+    if ( input ) {
+        freeFileBuffer( input );
     }
-    //Iterate through all the chars
-    for ( int i = 0; i < fileLength; i++ ) {
-        //Add the chars into the State24
-        addChar( newState24, charBuffer[i] );
+    //Close the streams
+    fclose( inStream );
+    if ( fclose( outStream ) != 0 ) {
+        perror( outputfile );
+        exit( EXIT_FAILURE );
+    }
+}
 
-        //If the State24 has reached max bit count, then get bytes from it
-        if ( newState24->bitCount == MAX_NUMBER_OF_BITS ) {
-            miniByteBufferCount = getBytes( newState24, miniByteBuffer );
-            for ( int j = 0; j < miniByteBufferCount; j++ ) {
-                appendFileBuffer( decodeFileBuffer, miniByteBuffer[j] );
+/**
+ * This function decodes one file of a batch. With --batch or --tree many files are
+ * decoded in one run, one file per thread at a time, so this is called by the threads
+ * in the batch pool with buffers that are reused between files. The files that aren't
+ * valid are all reported at the end.
+ * @param input The chars of the input file
+ * @param output The buffer that gets the decoded bytes
+ * @param options Points to a bool that is true if all whitespace is skipped
+ * @return int Zero if the file was decoded, otherwise INVALID_INPUT
+ */
+static int decodeBatchFile ( FileBuffer *input, FileBuffer *output, void *options )
+{
+    byte *bytes = reserveFileBuffer( output, input->count / MAX_NUMBER_OF_CHARS *
+                                             MAX_NUMBER_OF_BYTES + MAX_NUMBER_OF_BYTES );
+    Decoder decoder;
+    initDecoderLenient( &decoder, *( bool * )options );
+    size_t count = 0;
+    if ( !decodeUpdate( &decoder, ( char const * )input->data, input->count, bytes,
+                        &count ) ) {
+        return INVALID_INPUT;
+    }
+    count += decodeFinish( &decoder, bytes + count );
+    commitFileBuffer( output, count );
+    return 0;
+}
+
+/**
+ * This is the main function of decode. This function will check to see if the user
+ * has inputted the correct arguments and will call the decode helper function with
+ * the appropriate parameters. If the user inputs incorrect arguments then the program
+ * will exit and print out the usage for the user. With --lenient all whitespace in the
+ * encoded file is skipped, not just newlines, and with --verify the digest of the
+ * decoded bytes has to match the digest given.
+ * @param argc Number of command-line arguments
+ * @param argv Array containing the different command-line arguments
+ * @return int EXIT_SUCCESS
+ */
+int main ( int argc, char *argv[] ) 
+{
+    //Pick the engine used to decode, this can be set with the BASE64_ENGINE variable. Exit
+    //the program and print the engines that can be used if it can't be used
+    if ( !selectEngine( getenv( ENGINE_VARIABLE ) ) ) {
+        fprintf( stderr, "%s=%s: %s", ENGINE_VARIABLE, getenv( ENGINE_VARIABLE ),
+                 ENGINE_ERROR );
+        printEngines( stderr );
+        exit( EXIT_FAILURE );
+    }
+    bool statsFlag = false;
+    bool lenient = false;
+    bool gzip = false;
+    int threads = 0;
+    Digest digest;
+    initDigest( &digest );
+    //Find the batch or tree command at the end, otherwise the input and output files
+    int last = argc - ARG_VALUE_TWO;
+    bool batch = last > 0 && strcmp( BATCH_COMMAND, argv[last] ) == 0;
+    bool tree = !batch && argc > ARG_VALUE_THREE &&
+                strcmp( TREE_COMMAND, argv[argc - ARG_VALUE_THREE] ) == 0;
+    bool checkFlag = !batch && !tree && last > 0 && strcmp( CHECK_COMMAND, argv[last] ) == 0;
+    bool indexFlag = !batch && !tree && last > 0 && strcmp( INDEX_COMMAND, argv[last] ) == 0;
+    bool rangeFlag = false;
+    size_t rangeStart;
+    size_t rangeLength;
+    if ( tree ) {
+        last = argc - ARG_VALUE_THREE;
+    }
+    //Go through the commands that come before the input and output files
+    int arg = 1;
+    for ( ; arg < last; arg++ ) {
+        //If the command is equal to the url command then use the URL safe alphabet
+        if ( strcmp( URL_COMMAND, argv[arg] ) == 0 ) {
+            selectAlphabet( URL_ALPHABET_NAME );
+        }
+        //If the command is equal to the alphabet command then pick the alphabet by name
+        else if ( strcmp( ALPHABET_COMMAND, argv[arg] ) == 0 && arg + 1 < last ) {
+            if ( !selectAlphabet( argv[++arg] ) ) {
+                fprintf( stderr, USAGE );
+                exit( EXIT_FAILURE );
             }
         }
-
-        //Get bytes from State24 if the bit count is less than max and we have reached the end
-        else if ( newState24->bitCount < MAX_NUMBER_OF_BITS && i + 1 == fileLength ) {
-            miniByteBufferCount = getBytes( newState24, miniByteBuffer );
-            for ( int j = 0; j < miniByteBufferCount; j++ ) {
-                appendFileBuffer( decodeFileBuffer, miniByteBuffer[j] );
+        //If the command is equal to the lenient command then skip all whitespace
+        else if ( strcmp( LENIENT_COMMAND, argv[arg] ) == 0 ) {
+            lenient = true;
+        }
+        //If the command is equal to the range command then read the range to decode
+        else if ( strcmp( RANGE_COMMAND, argv[arg] ) == 0 && arg + 1 < last && !batch &&
+                  !tree && !checkFlag && !indexFlag ) {
+            if ( !parseRange( argv[++arg], &rangeStart, &rangeLength ) ) {
+                fprintf( stderr, USAGE );
+                exit( EXIT_FAILURE );
+            }
+            rangeFlag = true;
+        }
+        //If the command is equal to the threads command then read the number of threads
+        else if ( strcmp( THREADS_COMMAND, argv[arg] ) == 0 && arg + 1 < last ) {
+            char *end;
+            long value = strtol( argv[++arg], &end, 10 );
+            if ( *end != '\0' || value < 1 || value > MAX_THREADS ) {
+                fprintf( stderr, USAGE );
+                exit( EXIT_FAILURE );
             }
+            threads = value;
+        }
+        //If the command is equal to the gzip command then decompress the decoded bytes
+        else if ( strcmp( GZIP_COMMAND, argv[arg] ) == 0 ) {
+            gzip = true;
+        }
+        //If the command is equal to the digest command then print the digest of the output
+        else if ( strcmp( DIGEST_COMMAND, argv[arg] ) == 0 ) {
+            printDigest( &digest );
+        }
+        //If the command is equal to the digest file command then write the digest to a file
+        else if ( strcmp( DIGEST_FILE_COMMAND, argv[arg] ) == 0 && arg + 1 < last ) {
+            writeDigest( &digest, argv[++arg] );
+        }
+        //If the command is equal to the verify command then read the digest to check
+        else if ( strcmp( VERIFY_COMMAND, argv[arg] ) == 0 && arg + 1 < last ) {
+            if ( !verifyDigest( &digest, argv[++arg] ) ) {
+                fprintf( stderr, "%s: Can't read the digest\n", argv[arg] );
+                exit( EXIT_FAILURE );
+            }
+        }
+        //If the command is equal to the stats command then print the stats at the end
+        else if ( strcmp( STATS_COMMAND, argv[arg] ) == 0 ) {
+            statsFlag = true;
+        }
+        //Exit the program and print usage message since the command is invalid
+        else {
+            fprintf( stderr, USAGE );
+            exit( EXIT_FAILURE );
         }
     }
-    //Save the filebuffer to a new file
-    saveFileBuffer( decodeFileBuffer, argv[ARG_VALUE_TWO] );
-    //Free everything
-    freeFileBuffer(decodeFileBuffer);
-    free(newState24);
-    //Close the inputstream
-    fclose(inStream);
+    //If the incorrect amount of arguments is used then exit the program with usage message,
+    //the digest is only worked out when one output file is written, and the gzip stream
+    //has to be decoded from the start by a pipeline that picks its own threads
+    if ( arg != last || ( digest.enabled && ( batch || tree || checkFlag || indexFlag ) ) ||
+         ( gzip && ( batch || tree || checkFlag || indexFlag || rangeFlag || threads > 0 ) ) ) {
+        fprintf( stderr, USAGE );
+        exit( EXIT_FAILURE );
+    }
+    //Stop before the outputfile is opened if it is the inputfile, since opening it would
+    //empty the inputfile before it is decoded
+    if ( !batch && !tree && !checkFlag && !indexFlag &&
+         sameStream( argv[arg], argv[arg + 1] ) ) {
+        fprintf( stderr, "%s: %s\n", argv[arg + 1], SAME_FILE_ERROR );
+        exit( EXIT_FAILURE );
+    }
+    Stats stats;
+    startStats( &stats, statsFlag );
+    //Build the index file of the inputfile
+    if ( indexFlag ) {
+        buildIndex( argv[arg + 1] );
+        return EXIT_SUCCESS;
+    }
+    //Only decode the range of the inputfile
+    if ( rangeFlag ) {
+        decodeRange( argv[arg], argv[arg + 1], rangeStart, rangeLength, lenient, &digest,
+                     &stats );
+        printStats( &stats, "decode" );
+        if ( !finishDigest( &digest, argv[arg + 1] ) ) {
+            removeStream( argv[arg + 1] );
+            exit( EXIT_FAILURE );
+        }
+        return EXIT_SUCCESS;
+    }
+    //Only check the inputfile, nothing is written
+    if ( checkFlag ) {
+        check( argv[arg + 1], lenient, &stats );
+        printStats( &stats, "decode" );
+        return EXIT_SUCCESS;
+    }
+    //Decode every file in the manifest or the directory tree, using all the CPUs by default
+    if ( batch || tree ) {
+        size_t count;
+        BatchJob *jobs = batch ? readManifest( argv[arg + 1], &count ) :
+                                 readTree( argv[arg + 1], argv[arg + 2], &count );
+        if ( threads == 0 ) {
+            long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+            threads = cpus > 1 ? cpus : 1;
+        }
+        bool success = runBatch( jobs, count, threads, decodeBatchFile, &lenient, &stats );
+        freeBatch( jobs, count );
+        printStats( &stats, "decode" );
+        return success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    //Decode and decompress the inputfile in a pipeline, which has its own threads
+    if ( gzip ) {
+        decodeCompressed( argv[arg], argv[arg + 1], lenient, &digest, &stats );
+    } else {
+        decode( argv[arg], argv[arg + 1], threads == 0 ? 1 : threads, lenient, &digest,
+                &stats );
+    }
+    printStats( &stats, "decode" );
+    //The decoded bytes don't match the digest. Remove the outputfile and exit
+    if ( !finishDigest( &digest, argv[arg + 1] ) ) {
+        removeStream( argv[arg + 1] );
+        exit( EXIT_FAILURE );
+    }
     //Exit successfully
-    EXIT_SUCCESS;
+    return EXIT_SUCCESS;
 }
@@ -0,0 +1,128 @@
+/**
+ * @file digest.c
+ * @author Daniel Avisse (djavisse)
+ * This is the digest component. This component works out the XXH64 digest of the raw
+ * bytes of a run, the bytes read by encode or written by decode, using the hash
+ * component. Each chunk is added right after it is converted, while its bytes are
+ * still in the cache, so no second pass over the bytes is needed. The digest is printed
+ * on stderr or written to a file in the same form as xxhsum --tag, and decode can check
+ * it against an expected digest.
+ */
+
+#include <inttypes.h>
+#include "digest.h"
+
+/** The chars between the file name and the digest in each digest line */
+#define DIGEST_SEPARATOR ") = "
+
+/**
+ * This function is a helper function that reads a digest written as hex digits.
+ * @param text The hex digits, which can be followed by whitespace
+ * @param value Gets the digest
+ * @return true If there were HASH_HEX_LENGTH hex digits
+ * @return false If there weren't
+ */
+static bool parseHex ( char const *text, uint64_t *value )
+{
+    uint64_t result = 0;
+    int i = 0;
+    for ( ; i < HASH_HEX_LENGTH; i++ ) {
+        char ch = text[i];
+        int digit = ch >= '0' && ch <= '9' ? ch - '0' :
+                    ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 :
+                    ch >= 'A' && ch <= 'F' ? ch - 'A' + 10 : -1;
+        if ( digit < 0 ) {
+            return false;
+        }
+        result = result << 4 | digit;
+    }
+    if ( text[i] != '\0' && text[i] != ' ' && text[i] != '\t' && text[i] != '\n' &&
+         text[i] != '\r' ) {
+        return false;
+    }
+    *value = result;
+    return true;
+}
+
+void initDigest ( Digest *digest )
+{
+    digest->enabled = false;
+    digest->file = NULL;
+    digest->report = false;
+    digest->verify = false;
+    digest->expected = 0;
+    initHasher( &digest->hasher, 0 );
+}
+
+void printDigest ( Digest *digest )
+{
+    digest->enabled = true;
+    digest->report = true;
+    digest->file = NULL;
+}
+
+void writeDigest ( Digest *digest, char const *file )
+{
+    digest->enabled = true;
+    digest->report = true;
+    digest->file = file;
+}
+
+bool verifyDigest ( Digest *digest, char const *text )
+{
+    digest->enabled = true;
+    digest->verify = true;
+    if ( parseHex( text, &digest->expected ) ) {
+        return true;
+    }
+    //Otherwise read the first line of the digest file, the digest is after the name if
+    //it was written with a tag and at the start if it wasn't
+    FILE *stream = fopen( text, "r" );
+    if ( !stream ) {
+        return false;
+    }
+    char line[DIGEST_LINE_LENGTH];
+    bool read = fgets( line, sizeof( line ), stream ) != NULL;
+    fclose( stream );
+    if ( !read ) {
+        return false;
+    }
+    char const *separator = strstr( line, DIGEST_SEPARATOR );
+    return parseHex( separator ? separator + strlen( DIGEST_SEPARATOR ) : line,
+                     &digest->expected );
+}
+
+void digestUpdate ( Digest *digest, void const *data, size_t length )
+{
+    if ( digest->enabled ) {
+        hashUpdate( &digest->hasher, data, length );
+    }
+}
+
+bool finishDigest ( Digest *digest, char const *name )
+{
+    if ( !digest->enabled ) {
+        return true;
+    }
+    uint64_t value = hashFinish( &digest->hasher );
+    //Print the digest on stderr or write it to the digest file
+    if ( digest->report ) {
+        FILE *stream = digest->file ? fopen( digest->file, "w" ) : stderr;
+        if ( !stream ) {
+            perror( digest->file );
+            exit( EXIT_FAILURE );
+        }
+        fprintf( stream, DIGEST_NAME " (%s" DIGEST_SEPARATOR "%016" PRIx64 "\n", name, value );
+        if ( digest->file && fclose( stream ) != 0 ) {
+            perror( digest->file );
+            exit( EXIT_FAILURE );
+        }
+    }
+    //Check the digest against the one it has to match
+    if ( digest->verify && value != digest->expected ) {
+        fprintf( stderr, "%s: " DIGEST_NAME " digest %016" PRIx64 " doesn't match %016" PRIx64
+                 "\n", name, value, digest->expected );
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file digest.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the digest.c component. In this file it contains all the
+ * constants, structs and protypes used in digest.c
+ */
+
+#ifndef _DIGEST_H_
+#define _DIGEST_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Include hash to get the Hasher the digest is worked out with.
+#include "hash.h"
+
+/** The command used to print the digest of the bytes on stderr */
+#define DIGEST_COMMAND "--digest"
+
+/** The command used to write the digest of the bytes to a file */
+#define DIGEST_FILE_COMMAND "--digest-file"
+
+/** The command used to check the digest of the decoded bytes */
+#define VERIFY_COMMAND "--verify"
+
+/** The name of the hash printed along with each digest */
+#define DIGEST_NAME "XXH64"
+
+/** The most chars read from a digest file */
+#define DIGEST_LINE_LENGTH 4096
+
+/**
+ * This is the Digest struct. It holds the hash of the bytes on the binary side of a
+ * run, the input of encode or the output of decode, along with where the digest goes
+ * and the digest it has to match.
+ */
+typedef struct {
+  /** True if the digest is being worked out, when this is false nothing else is used. */
+  bool enabled;
+
+  /** Hashes the bytes one chunk at a time as they go past. */
+  Hasher hasher;
+
+  /** The file the digest is written to, or NULL to print it on stderr. */
+  char const *file;
+
+  /** True if the digest is printed or written once it is done. */
+  bool report;
+
+  /** True if the digest has to match the expected digest. */
+  bool verify;
+
+  /** The digest the bytes have to have. */
+  uint64_t expected;
+} Digest;
+
+/**
+ * This function starts a new Digest that isn't being worked out.
+ * @param digest The Digest being started
+ */
+void initDigest ( Digest *digest );
+
+/**
+ * This function makes a Digest print its digest on stderr once it is done.
+ * @param digest The Digest
+ */
+void printDigest ( Digest *digest );
+
+/**
+ * This function makes a Digest write its digest to a file once it is done.
+ * @param digest The Digest
+ * @param file The path of the file
+ */
+void writeDigest ( Digest *digest, char const *file );
+
+/**
+ * This function makes a Digest check its digest against an expected digest. The expected
+ * digest is either 16 hex digits, or a file with the digest in it like the ones written
+ * by writeDigest or xxhsum.
+ * @param digest The Digest
+ * @param text The expected digest or the path of a file holding it
+ * @return true If the expected digest was read
+ * @return false If it couldn't be read
+ */
+bool verifyDigest ( Digest *digest, char const *text );
+
+/**
+ * This function adds the bytes of one chunk to the digest, if it is being worked out.
+ * It is called right after the chunk is converted, while its bytes are still in the
+ * cache, so the bytes aren't read from memory a second time.
+ * @param digest The Digest
+ * @param data The bytes of the chunk
+ * @param length The number of bytes in the chunk
+ */
+void digestUpdate ( Digest *digest, void const *data, size_t length );
+
+/**
+ * This function finishes a Digest by printing it or writing it, and checking it against
+ * the expected digest. A digest that doesn't match is reported on stderr.
+ * @param digest The Digest
+ * @param name The name of the file the bytes came from or went to
+ * @return true If the digest matched or wasn't checked
+ * @return false If it didn't match
+ */
+bool finishDigest ( Digest *digest, char const *name );
+
+#endif
@@ -6,18 +6,42 @@
  * contents of the binary file to output it to a text file with characters.
  * The user also has the option to change the output of the encoded files by
  * adding optional commands, -b and -p. -b allows for no line breaks and -p
- * allows for no padding. 
+ * allows for no padding. The encoding itself is done by libbase64, and this
+ * component only moves the bytes between the files.
  */
 
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "filebuffer.h"
 #include "state24.h"
+#include "codec.h"
+#include "base64.h"
+#include "batch.h"
+#include "stats.h"
+#include "stream.h"
+#include "uring.h"
+#include "cache.h"
+#include "digest.h"
+#include "pipeline.h"
+#include "compress.h"
 
-/** Value used to limit the amount of chars that can appear in one line */
-#define CHAR_LIMIT 77
+/** Number of bytes read from the input file at a time, this is kept a multiple of 3 */
+#define CHUNK_SIZE ( MAX_NUMBER_OF_BYTES * 16384 )
+
+/** Size of the buffer holding the chars encoded from one chunk, with room for line breaks */
+#define OUTPUT_CHUNK_SIZE ( CHUNK_SIZE / MAX_NUMBER_OF_BYTES * MAX_NUMBER_OF_CHARS * DOUBLE_SIZE )
+
+/** Number of bytes encoded at a time by each thread, this is rounded down to whole lines */
+#define PARALLEL_CHUNK_SIZE ( MAX_NUMBER_OF_BYTES * 327680 )
+
+/** The most threads that can be used to encode */
+#define MAX_THREADS 1024
 
 /** The command used to not have line breaks in the encoded file */
 #define BREAK_COMMAND "-b"
@@ -25,231 +49,686 @@
 /** The command used to not have padding in the encoded file */
 #define PADDING_COMMAND "-p"
 
-/** Value used when working with command line arguments */
-#define ARG_VALUE_FIVE 5
+/** The command used to pick the number of chars in each line of the encoded file */
+#define WIDTH_COMMAND "-w"
 
-/** Value used when working with command line arguments */
-#define ARG_VALUE_FOUR 4
+/** The command used to end the lines of the encoded file with a carriage return */
+#define CRLF_COMMAND "--crlf"
 
-/** Value used when working with command line arguments */
-#define ARG_VALUE_THREE 3
+/** The command used to use the URL and file name safe alphabet */
+#define URL_COMMAND "--url"
+
+/** The command used to pick the alphabet by name */
+#define ALPHABET_COMMAND "--alphabet"
+
+/** The alphabet picked by the URL command */
+#define URL_ALPHABET_NAME "url"
+
+/** The command used to pick the number of threads used to encode */
+#define THREADS_COMMAND "-j"
+
+/** The command used to add the input file onto the end of an encoded output file */
+#define APPEND_COMMAND "--append"
 
 /** Value used when working with command line arguments */
 #define ARG_VALUE_TWO 2
 
+/** The usage message printed when the arguments are incorrect */
+#define USAGE "usage: encode [-b] [-p] [-w width] [--crlf] [--url | --alphabet name]" \
+              " [-j threads | --gzip] [--digest | --digest-file file] [--stats]" \
+              " <input-file> <output-file>\n" \
+              "       encode [-b] [-p] [-w width] [--crlf] [--url | --alphabet name]" \
+              " [--digest | --digest-file file] [--stats]" \
+              " --append <input-file> <output-file>\n" \
+              "       encode [-b] [-p] [-w width] [--crlf] [--url | --alphabet name]" \
+              " [-j threads] [--stats] --batch <manifest>\n" \
+              "       encode [-b] [-p] [-w width] [--crlf] [--url | --alphabet name]" \
+              " [-j threads] [--stats] --tree <input-dir> <output-dir>\n"
+
+/** Value used when working with the arguments of the tree command */
+#define ARG_VALUE_THREE 3
+
+/**
+ * This is the EncodeJobs struct. It holds the chunks of a mapped input file that are
+ * being encoded by a pool of threads. Each thread takes the next chunk that hasn't been
+ * encoded yet until there are none left.
+ */
+typedef struct {
+  /** The mapped input file being encoded. */
+  FileBuffer *input;
+
+  /** The mapped output file the chunks are encoded into. */
+  FileBuffer *output;
+
+  /** The number of bytes being encoded, this is a whole number of groups. */
+  size_t length;
+
+  /** The number of chunks the bytes are split into. */
+  size_t chunks;
+
+  /** The next chunk that hasn't been taken by a thread yet. */
+  size_t nextChunk;
+
+  /** Lock used when taking the next chunk. */
+  pthread_mutex_t lock;
+
+  /** The number of bytes in each chunk, this is a whole number of lines. */
+  size_t chunkSize;
+
+  /** A new Encoder with the line length, line ending and padding being used. */
+  Encoder format;
+} EncodeJobs;
+
+/**
+ * This is the ChunkState struct. It holds what is kept between the chunks read by
+ * io_uring, the Encoder and the Digest of the bytes.
+ */
+typedef struct {
+  /** The Encoder holding where the last chunk left off. */
+  Encoder *encoder;
+
+  /** The Digest the bytes of each chunk are added to. */
+  Digest *digest;
+} ChunkState;
+
+/**
+ * This function is run by each thread in the pool. It keeps taking the next chunk of
+ * the input file and encodes it straight into its place in the output file. Every
+ * chunk is a whole number of lines, so each one after the first starts with the line
+ * ending that comes before it.
+ * @param arg The EncodeJobs that are being encoded
+ * @return void* NULL once there are no chunks left
+ */
+static void *encodeWorker ( void *arg )
+{
+    EncodeJobs *jobs = ( EncodeJobs * )arg;
+    while ( true ) {
+        //Take the next chunk
+        pthread_mutex_lock( &jobs->lock );
+        size_t chunk = jobs->nextChunk++;
+        pthread_mutex_unlock( &jobs->lock );
+        if ( chunk >= jobs->chunks ) {
+            return NULL;
+        }
+        size_t start = chunk * jobs->chunkSize;
+        size_t length = jobs->length - start;
+        if ( length > jobs->chunkSize ) {
+            length = jobs->chunkSize;
+        }
+        //Start after a full line so the line ending before the chunk gets added
+        Encoder encoder = jobs->format;
+        size_t outputStart = encoderOffset( &encoder, start );
+        if ( chunk > 0 ) {
+            encoder.charCount = encoder.lineLength;
+        }
+        size_t outputLength = encodeUpdate( &encoder, jobs->input->data + start, length,
+                                            ( char * )jobs->output->data + outputStart );
+        //Release the pages of the chunk so memory use stays flat
+        releaseFileBuffer( jobs->input, start, start + length );
+        releaseFileBuffer( jobs->output, outputStart, outputStart + outputLength );
+    }
+}
+
+/**
+ * This function is a helper function that encodes all the whole groups of a mapped input
+ * file into a mapped output file using a pool of threads. The bytes left at the end that
+ * don't make up a whole group are added into the Encoder, and the line position is set,
+ * so the end of the output can be finished the same way as when using one thread.
+ * @param input The mapped input file
+ * @param output The mapped output file
+ * @param threads The number of threads to use
+ * @param encoder The Encoder that will get the bytes left at the end
+ */
+static void encodeParallel ( FileBuffer *input, FileBuffer *output, int threads,
+                             Encoder *encoder )
+{
+    EncodeJobs jobs;
+    jobs.input = input;
+    jobs.output = output;
+    jobs.length = input->count - input->count % MAX_NUMBER_OF_BYTES;
+    jobs.format = *encoder;
+    //Make each chunk a whole number of lines, so every chunk starts a new line
+    jobs.chunkSize = PARALLEL_CHUNK_SIZE;
+    if ( encoder->lineLength > 0 ) {
+        size_t lineBytes = encoder->lineLength / MAX_NUMBER_OF_CHARS * MAX_NUMBER_OF_BYTES;
+        jobs.chunkSize = lineBytes > PARALLEL_CHUNK_SIZE ? lineBytes :
+                         PARALLEL_CHUNK_SIZE - PARALLEL_CHUNK_SIZE % lineBytes;
+    }
+    jobs.chunks = ( jobs.length + jobs.chunkSize - 1 ) / jobs.chunkSize;
+    jobs.nextChunk = 0;
+    pthread_mutex_init( &jobs.lock, NULL );
+    //Start the threads and wait for them to encode all the chunks
+    pthread_t workers[MAX_THREADS];
+    for ( int i = 0; i < threads; i++ ) {
+        if ( pthread_create( &workers[i], NULL, encodeWorker, &jobs ) != 0 ) {
+            perror( "pthread_create" );
+            exit( EXIT_FAILURE );
+        }
+    }
+    for ( int i = 0; i < threads; i++ ) {
+        pthread_join( workers[i], NULL );
+    }
+    pthread_mutex_destroy( &jobs.lock );
+    //Set where the output is up to after all the whole groups
+    output->count = encoderOffset( encoder, jobs.length );
+    size_t chars = jobs.length / MAX_NUMBER_OF_BYTES * MAX_NUMBER_OF_CHARS;
+    if ( encoder->lineLength > 0 && chars > 0 ) {
+        encoder->charCount = ( chars - 1 ) % encoder->lineLength + 1;
+    }
+    //Add the bytes left at the end into the Encoder
+    encodeUpdate( encoder, input->data + jobs.length, input->count - jobs.length,
+                  ( char * )output->data + output->count );
+}
+
+/**
+ * This function encodes one chunk read by io_uring. It is the ChunkFunction passed to
+ * runUring.
+ * @param state The ChunkState holding where the last chunk left off
+ * @param data The bytes of the chunk
+ * @param length The number of bytes in the chunk
+ * @param output The buffer that gets the encoded chars
+ * @param outCount Gets the number of chars encoded
+ * @return bool True, since every chunk can be encoded
+ */
+static bool encodeChunk ( void *state, byte const data[], size_t length, byte output[],
+                          size_t *outCount )
+{
+    ChunkState *chunkState = ( ChunkState * )state;
+    digestUpdate( chunkState->digest, data, length );
+    *outCount = encodeUpdate( chunkState->encoder, data, length, ( char * )output );
+    return true;
+}
+
+/**
+ * This function is a helper function that sets up the Encoder to carry on from the end
+ * of an output file encoded before, which is how --append adds onto it. Only the last line of the output file is read, the
+ * last group is taken off if it isn't whole and the output file is cut down to where
+ * that group started, so the new chars are written from there.
+ * @param outstream The output file opened for reading and writing
+ * @param outputfile The path of the output file
+ * @param encoder The Encoder with the options the output file was encoded with
+ */
+static void resumeOutput ( FILE *outstream, char outputfile[], Encoder *encoder )
+{
+    //Only a regular file can be read back and cut down
+    int fd = fileno( outstream );
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) ) {
+        fprintf( stderr, "%s: Can't append to a file that isn't a regular file\n", outputfile );
+        exit( EXIT_FAILURE );
+    }
+    //Read the last line along with the line ending before it
+    size_t total = info.st_size;
+    size_t length = encoder->lineLength > 0 ? encoder->lineLength + MAX_ENDING_LENGTH +
+                    MAX_ENDING_LENGTH : MAX_NUMBER_OF_CHARS + MAX_ENDING_LENGTH;
+    if ( length > total ) {
+        length = total;
+    }
+    char *tail = ( char * )malloc( length + 1 );
+    if ( pread( fd, tail, length, total - length ) != ( ssize_t )length ) {
+        perror( outputfile );
+        exit( EXIT_FAILURE );
+    }
+    size_t keep;
+    if ( !resumeEncoder( encoder, tail, length, total, &keep ) ) {
+        fprintf( stderr, "%s: The output file wasn't encoded with the same options\n",
+                 outputfile );
+        exit( EXIT_FAILURE );
+    }
+    free( tail );
+    //Cut off the chars that are encoded again and write the new chars from there
+    if ( ftruncate( fd, total - length + keep ) != 0 || fseek( outstream, 0, SEEK_END ) != 0 ) {
+        perror( outputfile );
+        exit( EXIT_FAILURE );
+    }
+}
+
 /**
  * This function is a helper function used to help encode the input bin file into
- * a txt file with encoded letters. This function also has optional commands that allow
- * for the user to change the output of the output file if they desire.
+ * a txt file with encoded letters. The input file is mapped into memory when possible,
+ * otherwise it is read a chunk at a time. When the input file is mapped the output file
+ * is created at its exact final size and mapped as well, so the chars are encoded
+ * straight into the output file. Otherwise each chunk is encoded and written to the
+ * output file right away, so the amount of memory used stays the same no matter how
+ * big the input file is. When more than one thread is used and both files are mapped,
+ * the chunks are encoded by a pool of threads. When the input file can't be mapped it is
+ * read with io_uring, unless BASE64_IO is stdio. Either file can be "-" to use the
+ * standard input or the standard output. This function also has
+ * optional commands that allow for the user to change the output of the output file
+ * if they desire.
  * @param inputfile The input bin file containing the bytes that will be encoded
  * @param outputfile The output txt file that will have output encoded letters
- * @param bFlag Flag that tells if the user wants to use the break command
- * @param pFlag Flag that tells if the user want to use the padding command
+ * @param format A new Encoder with the options picked by the user
+ * @param threads The number of threads used to encode
+ * @param append True if the chars are added onto the end of the output file
+ * @param digest The Digest the bytes of each chunk are added to
+ * @param stats The stats kept for --stats
  */
-static void encode ( char inputfile[], char outputfile[], bool bFlag, bool pFlag ) 
+static void encode ( char inputfile[], char outputfile[], Encoder const *format,
+                     int threads, bool append, Digest *digest, Stats *stats )
 {
-    //Create and load a new filebuffer with all the bytes
-    FileBuffer *encodeFileBuffer = loadFileBuffer( inputfile );
-    //Create a new State24 to use the bytes to convert to chars
-    State24 *newState24 = ( State24 * )malloc(sizeof( State24 ) );
-    initState( newState24 );
-    int charBufferCapcity = INITIAL_CAPACITY;
-    //Create a charBuffer that will contain all the chars 
-    char *fullCharbuffer = ( char * )malloc( charBufferCapcity * sizeof( char ) );
-    int charBufferCount = 0;
-    //Create a miniBuffer that will temporarily hold the chars that will be added in the fullBuffer
-    char miniCharbuffer[MAX_NUMBER_OF_CHARS];
-    int miniCharBufferCount = 0;
-
-    //Iterate through all the bytes in the filebuffer
-    for( int i = 0; i < encodeFileBuffer->count; i++ ) {
-        //Add the byte into the State24
-        addByte( newState24, encodeFileBuffer->data[i] );
-
-        //Check if State24 has the max amount of bytes it can contain
-        if ( newState24->byteCount == MAX_NUMBER_OF_BYTES ) {
-            //Fill the minicharBuffer with the chars from State24
-            miniCharBufferCount = getChars( newState24, miniCharbuffer );
-            //Put each char into the fullcharBuffer
-            for ( int j = 0; j < miniCharBufferCount; j++ ) {
-                //Resize the fullCharBuffer if necessary
-                if ( charBufferCount >= charBufferCapcity ) {
-                    charBufferCapcity *= DOUBLE_SIZE;
-                    void *temp = ( char *) realloc( fullCharbuffer, 
-                    charBufferCapcity * sizeof( char ) );
-                    if (temp == NULL) {
-                        free(fullCharbuffer);
-                        free(encodeFileBuffer);
-                        free(newState24);
-                        exit(EXIT_FAILURE);
-                    }
-                    fullCharbuffer = temp;
+    //Open the inputfile in binary read mode, "-" is the standard input
+    FILE *instream = openStream( inputfile, "rb" );
+    //Report failure message and exit program if the inputfile can't be opened
+    if ( !instream ) {
+        perror( inputfile );
+        exit( EXIT_FAILURE );
+    }
+    //Open the outputfile, it is opened for reading too so that it can be mapped, "-" is
+    //the standard output. When appending it is kept and read back instead
+    FILE *outstream = openStream( outputfile, append ? "r+" : "w+" );
+    //Report failure message and exit program if the outputfile can't be opened
+    if ( !outstream ) {
+        perror( outputfile );
+        fclose( instream );
+        exit( EXIT_FAILURE );
+    }
+    //Create the buffer used to hold the chars encoded from one chunk
+    StreamWriter writer;
+    initWriter( &writer, outstream, OUTPUT_CHUNK_SIZE * sizeof( char ) );
+    char *outBuffer;
+    size_t outCount = 0;
+    //Create a new Encoder to convert the bytes to chars, this keeps the line position
+    Encoder encoder = *format;
+    if ( append ) {
+        resumeOutput( outstream, outputfile, &encoder );
+    }
+    //The mapped outputfile, this stays NULL if the outputfile isn't mapped
+    FileBuffer *outputFileBuffer = NULL;
+
+    //Map the inputfile so the bytes are read straight from the page cache
+    FileBuffer *encodeFileBuffer = mapFileBuffer( fileno( instream ) );
+    if ( encodeFileBuffer ) {
+        //Create the outputfile at its final size and map it so chars are encoded into it,
+        //unless the chars are being added onto the end of it
+        if ( !append ) {
+            outputFileBuffer = mapOutputFileBuffer( fileno( outstream ),
+                                                    encoderLength( &encoder,
+                                                                   encodeFileBuffer->count ) );
+        }
+        stats->bytesIn = encodeFileBuffer->count;
+        switchPhase( stats, PHASE_CONVERT );
+        //Encode the chunks using a pool of threads if there is more than one
+        if ( outputFileBuffer && threads > 1 ) {
+            encodeParallel( encodeFileBuffer, outputFileBuffer, threads, &encoder );
+        }
+        //Otherwise encode the mapped bytes one chunk at a time
+        else {
+            size_t released = 0;
+            size_t outputReleased = 0;
+            for ( size_t offset = 0; offset < encodeFileBuffer->count; offset += CHUNK_SIZE ) {
+                size_t length = encodeFileBuffer->count - offset;
+                if ( length > CHUNK_SIZE ) {
+                    length = CHUNK_SIZE;
+                }
+                //Encode the chunk into the mapped outputfile if there is one
+                if ( outputFileBuffer ) {
+                    outputFileBuffer->count += encodeUpdate( &encoder, encodeFileBuffer->data +
+                                               offset, length, ( char * )outputFileBuffer->data +
+                                               outputFileBuffer->count );
+                    outputReleased = releaseFileBuffer( outputFileBuffer, outputReleased,
+                                                        outputFileBuffer->count );
                 }
-            fullCharbuffer[charBufferCount++] = miniCharbuffer[j];
+                //Otherwise write the encoded chunk to the outputfile
+                else {
+                    outBuffer = ( char * )writerBuffer( &writer );
+                    outCount = encodeUpdate( &encoder, encodeFileBuffer->data + offset, length,
+                                             outBuffer );
+                    switchPhase( stats, PHASE_WRITE );
+                    writeStream( &writer, outBuffer, outCount );
+                    stats->bytesOut += outCount;
+                    switchPhase( stats, PHASE_CONVERT );
+                }
+                //Add the chunk to the digest while it is still in the cache, then release
+                //the pages that have been encoded so memory use stays flat
+                digestUpdate( digest, encodeFileBuffer->data + offset, length );
+                released = releaseFileBuffer( encodeFileBuffer, released, offset + length );
             }
         }
-
-        //Check if the bytes are less than 3 and we reached the end of the file
-        else if ( newState24->byteCount < MAX_NUMBER_OF_BYTES && i + 1 == encodeFileBuffer->count ) {
-            //Check if the bytes in State24 are equal to two
-            if( newState24->byteCount == TWO_BYTES ) {
-                //Fill the minicharBuffer with the chars from State24
-                miniCharBufferCount = getChars( newState24, miniCharbuffer );
-                //Put each char into the fullcharBuffer
-                for( int j = 0; j < miniCharBufferCount + 1; j++ ) {
-                    //Resize the fullCharBuffer if necessary
-                    if ( charBufferCount >= charBufferCapcity ) {
-                        charBufferCapcity *= DOUBLE_SIZE;
-                        void *temp = ( char *) realloc( fullCharbuffer, 
-                        charBufferCapcity * sizeof( char ) );
-                        if (temp == NULL) {
-                            free(fullCharbuffer);
-                            free(encodeFileBuffer);
-                            free(newState24);
-                        }
-                        fullCharbuffer = temp;
-                    }
-                    //Add one equal sign at the end of the input if the pFlag is false
-                    if ( j == miniCharBufferCount && !pFlag ) {
-                        fullCharbuffer[charBufferCount++] = '=';
-                    }
-                    //Add the chars into the fullCharBuffer
-                    else if ( j < miniCharBufferCount ) {
-                        fullCharbuffer[charBufferCount++] = miniCharbuffer[j];
-                    }
-                }
+        freeFileBuffer( encodeFileBuffer );
+    }
+    //Read the inputfile one chunk at a time if it can't be mapped, with io_uring so the
+    //next chunk is read and the last one written while this one is encoded
+    else {
+        int status = URING_UNAVAILABLE;
+        char const *backend = getenv( IO_VARIABLE );
+        if ( !backend || strcmp( backend, STDIO_BACKEND ) != 0 ) {
+            switchPhase( stats, PHASE_CONVERT );
+            ChunkState state = { &encoder, digest };
+            status = runUring( fileno( instream ), &writer, CHUNK_SIZE, encodeChunk, &state,
+                               stats );
+        }
+        //Exit program if a read or write failed, the message has already been reported
+        if ( status == URING_FAILED ) {
+            exit( EXIT_FAILURE );
+        }
+        //Otherwise read with stdio if io_uring can't be used
+        if ( status == URING_UNAVAILABLE ) {
+            byte *inBuffer = ( byte * )malloc( CHUNK_SIZE * sizeof( byte ) );
+            size_t length;
+            switchPhase( stats, PHASE_READ );
+            while ( ( length = fread( inBuffer, sizeof( byte ), CHUNK_SIZE, instream ) ) > 0 ) {
+                stats->bytesIn += length;
+                switchPhase( stats, PHASE_CONVERT );
+                outBuffer = ( char * )writerBuffer( &writer );
+                outCount = encodeUpdate( &encoder, inBuffer, length, outBuffer );
+                digestUpdate( digest, inBuffer, length );
+                //Write the encoded chunk to the outputfile
+                switchPhase( stats, PHASE_WRITE );
+                writeStream( &writer, outBuffer, outCount );
+                stats->bytesOut += outCount;
+                switchPhase( stats, PHASE_READ );
             }
-
-            //Check if the bytes in State24 are equal to one
-            if( newState24->byteCount == 1 ) {
-                //Fill the minicharBuffer with the chars from State24
-                miniCharBufferCount = getChars( newState24, miniCharbuffer );
-                //Put each char into the fullcharBuffer
-                for( int j = 0; j < miniCharBufferCount + TWO_BYTES; j++ ) {
-                    //Resize the fullCharBuffer if necessary
-                    if ( charBufferCount >= charBufferCapcity ) {
-                        charBufferCapcity *= DOUBLE_SIZE;
-                        void *temp = ( char *) realloc( fullCharbuffer, 
-                        charBufferCapcity * sizeof( char ) );
-                        if (temp == NULL) {
-                            free(fullCharbuffer);
-                            free(encodeFileBuffer);
-                            free(newState24);
-                        }
-                        fullCharbuffer = temp;
-                    }
-                    //Add two equal signs at the end of the input if the pFlag is false
-                    if ( j >= miniCharBufferCount && !pFlag ) {
-                        fullCharbuffer[charBufferCount++] = '=';
-                    }
-                    //Add the chars into the fullCharBuffer
-                    else if ( j < miniCharBufferCount ) {
-                        fullCharbuffer[charBufferCount++] = miniCharbuffer[j];
-                    }
-                }
+            free( inBuffer );
+            //Report failure message and exit program if the inputfile couldn't be read
+            if ( ferror( instream ) ) {
+                perror( inputfile );
+                exit( EXIT_FAILURE );
             }
         }
     }
-    //Use this to count how many chars have be printed in a line
-    int charCount = 0;
-    //Open the outputfile
-    FILE *outstream = fopen( outputfile, "w" );
-    //Report failure message and exit program if the outputfile can't be opened
+    //Finish the outputfile with the padding and the line ending at the end
+    switchPhase( stats, PHASE_FINISH );
+    if ( outputFileBuffer ) {
+        outputFileBuffer->count += encodeFinish( &encoder, ( char * )outputFileBuffer->data +
+                                                 outputFileBuffer->count );
+        stats->bytesOut = outputFileBuffer->count;
+        finishFileBuffer( outputFileBuffer, fileno( outstream ) );
+    } else {
+        outBuffer = ( char * )writerBuffer( &writer );
+        outCount = encodeFinish( &encoder, outBuffer );
+        writeStream( &writer, outBuffer, outCount );
+        stats->bytesOut += outCount;
+    }
+    //Free everything
+    freeWriter( &writer );
+    fclose( instream );
+    fclose( outstream );
+}
+
+/**
+ * This function is a helper function used to compress the input file with gzip and
+ * encode the compressed bytes. This is done by a pipeline of three stages, each on its
+ * own thread: one reads the input file, one compresses the bytes, and this thread
+ * encodes the compressed bytes and writes them to the output file. The stages pass the
+ * bytes through channels with a few buffers each, so they all run at the same time
+ * using the same amount of memory for any size of file, and the compressed bytes are
+ * never written to disk. The digest is of the bytes before they are compressed.
+ * @param inputfile The input bin file containing the bytes that will be compressed
+ * @param outputfile The output txt file that will have output encoded letters
+ * @param format A new Encoder with the options picked by the user
+ * @param digest The Digest the bytes read are added to
+ * @param stats The stats kept for --stats
+ */
+static void encodeCompressed ( char inputfile[], char outputfile[], Encoder const *format,
+                               Digest *digest, Stats *stats )
+{
+    //Open the inputfile in binary read mode, "-" is the standard input
+    FILE *instream = openStream( inputfile, "rb" );
+    if ( !instream ) {
+        perror( inputfile );
+        exit( EXIT_FAILURE );
+    }
+    //Open the outputfile, "-" is the standard output
+    FILE *outstream = openStream( outputfile, "w" );
     if ( !outstream ) {
         perror( outputfile );
+        fclose( instream );
         exit( EXIT_FAILURE );
     }
-    //If the bFlag is set to true then print the chars with line breaks
-    if ( bFlag ) {
-        for( int i = 0; i < charBufferCount; i++ ) {
-        fprintf( outstream, "%c", fullCharbuffer[i] );
-        }
+    StreamWriter writer;
+    initWriter( &writer, outstream, OUTPUT_CHUNK_SIZE * sizeof( char ) );
+    Encoder encoder = *format;
+    //Start the stages that read the inputfile and compress it
+    Channel raw;
+    Channel compressed;
+    initChannel( &raw, CHUNK_SIZE );
+    initChannel( &compressed, CHUNK_SIZE );
+    ReadStage reader = { fileno( instream ), &raw, digest, 0, 0 };
+    CompressStage compressor = { &raw, &compressed, NULL };
+    pthread_t readThread;
+    pthread_t compressThread;
+    startStage( &readThread, readStage, &reader );
+    startStage( &compressThread, compressStage, &compressor );
+    //Encode the compressed bytes and write them as they come
+    switchPhase( stats, PHASE_CONVERT );
+    size_t count;
+    byte *data;
+    while ( ( data = takeChannel( &compressed, &count ) ) ) {
+        char *outBuffer = ( char * )writerBuffer( &writer );
+        size_t outCount = encodeUpdate( &encoder, data, count, outBuffer );
+        releaseChannel( &compressed );
+        writeStream( &writer, outBuffer, outCount );
+        stats->bytesOut += outCount;
     }
-    //Print the chars with line breaks
-    else {
-        for( int i = 0; i < charBufferCount; i++ ) {
-            charCount++;
-            if ( charCount == CHAR_LIMIT ) {
-                fprintf( outstream, "\n" );
-                charCount = 1;
-            }
-            fprintf( outstream, "%c", fullCharbuffer[i] );
+    pthread_join( readThread, NULL );
+    pthread_join( compressThread, NULL );
+    stats->bytesIn = reader.count;
+    //A read failed or the bytes couldn't be compressed. Remove the outputfile, exit and
+    //print error message
+    if ( reader.error || compressor.error ) {
+        if ( reader.error ) {
+            errno = reader.error;
+            perror( inputfile );
+        } else {
+            fprintf( stderr, "%s\n", compressor.error );
         }
+        fclose( outstream );
+        removeStream( outputfile );
+        exit( EXIT_FAILURE );
     }
-    //Print a newline at the end
-    fprintf( outstream, "\n" );
+    //Finish the outputfile with the padding and the line ending at the end
+    switchPhase( stats, PHASE_FINISH );
+    char *outBuffer = ( char * )writerBuffer( &writer );
+    size_t outCount = encodeFinish( &encoder, outBuffer );
+    writeStream( &writer, outBuffer, outCount );
+    stats->bytesOut += outCount;
     //Free everything
-    freeFileBuffer( encodeFileBuffer );
-    free( fullCharbuffer );
-    free( newState24 );
-    fclose(outstream);
+    freeWriter( &writer );
+    freeChannel( &raw );
+    freeChannel( &compressed );
+    fclose( instream );
+    fclose( outstream );
+}
+
+/**
+ * This function encodes one file of a batch. With --batch or --tree many files are
+ * encoded in one run, one file per thread at a time, so this is called by the threads
+ * in the batch pool with buffers that are reused between files.
+ * @param input The bytes of the input file
+ * @param output The buffer that gets the encoded chars
+ * @param options A new Encoder with the options picked by the user
+ * @return int Zero, since every input can be encoded
+ */
+static int encodeBatchFile ( FileBuffer *input, FileBuffer *output, void *options )
+{
+    Encoder encoder = *( Encoder const * )options;
+    char *chars = ( char * )reserveFileBuffer( output, encoderLength( &encoder,
+                                                                       input->count ) );
+    size_t count = encodeUpdate( &encoder, input->data, input->count, chars );
+    commitFileBuffer( output, count + encodeFinish( &encoder, chars + count ) );
+    return 0;
 }
 
 /**
  * This is the main function of encode. This function will check to see if the 
  * user has inputted the correct arguments and will call the encode helper function
  * with the appropriate paramters. If the user inputs incorrect arguments then the 
- * program will exit and print out the usasge for the user.
+ * program will exit and print out the usasge for the user. -w picks the number of chars
+ * in each line, like 64 for PEM, and --crlf ends each line with a carriage return and
+ * newline. When BASE64_CACHE is set the encoded outputs are kept in a cache, so an input
+ * that was already encoded with the same options is copied from there instead.
  * @param argc Number of command-line arguments
  * @param argv Array containing the different command-line arguments
  * @return int EXIT_SUCCESS
  */
 int main ( int argc, char *argv[] )
 {
-    //If the user inputted an incorrect amount of arguments then print usage message
-    if ( argc == 1 || argc > ARG_VALUE_FIVE ) {
-        fprintf( stderr, "usage: encode [-b] [-p] <input-file> <output-file>\n" );
+    //Pick the engine used to encode, this can be set with the BASE64_ENGINE variable. Exit
+    //the program and print the engines that can be used if it can't be used
+    if ( !selectEngine( getenv( ENGINE_VARIABLE ) ) ) {
+        fprintf( stderr, "%s=%s: %s", ENGINE_VARIABLE, getenv( ENGINE_VARIABLE ),
+                 ENGINE_ERROR );
+        printEngines( stderr );
         exit( EXIT_FAILURE );
     }
-    /*If number of arguments is equal to 3 then call the encode function 
-    using the input and output files that the user has inputted */
-    if ( argc == ARG_VALUE_THREE ) {
-        encode( argv[1], argv[ARG_VALUE_TWO], false, false );
+    bool statsFlag = false;
+    bool bFlag = false;
+    bool pFlag = false;
+    bool crlf = false;
+    bool append = false;
+    bool gzip = false;
+    Digest digest;
+    initDigest( &digest );
+    size_t width = DEFAULT_LINE_LENGTH;
+    int threads = 0;
+    //Find the batch or tree command at the end, otherwise the input and output files
+    int last = argc - ARG_VALUE_TWO;
+    bool batch = last > 0 && strcmp( BATCH_COMMAND, argv[last] ) == 0;
+    bool tree = !batch && argc > ARG_VALUE_THREE &&
+                strcmp( TREE_COMMAND, argv[argc - ARG_VALUE_THREE] ) == 0;
+    if ( tree ) {
+        last = argc - ARG_VALUE_THREE;
     }
-    //If the number of arguments is 4 then check if the user inptted a valid command
-    else if ( argc == ARG_VALUE_FOUR ) {
+    //Go through the commands that come before the input and output files
+    int arg = 1;
+    for ( ; arg < last; arg++ ) {
         //If the command is equal to the break command then set bFlag to true
-        if ( strcmp( BREAK_COMMAND, argv[1] ) == 0 ) {
-            encode(argv[ARG_VALUE_TWO], argv[ARG_VALUE_THREE], true, false);
+        if ( strcmp( BREAK_COMMAND, argv[arg] ) == 0 ) {
+            bFlag = true;
         }
         //If the command is equal to the padding command then set pFlag to true
-        else if ( strcmp( PADDING_COMMAND, argv[1] ) == 0 ) {
-            encode(argv[ARG_VALUE_TWO], argv[ARG_VALUE_THREE], false, true);
+        else if ( strcmp( PADDING_COMMAND, argv[arg] ) == 0 ) {
+            pFlag = true;
         }
-        //Exit the program and print usage message since the command is invalid
-        else {
-            fprintf( stderr, "usage: encode [-b] [-p] <input-file> <output-file>\n" );
-            exit( EXIT_FAILURE );
+        //If the command is equal to the width command then read the chars in each line
+        else if ( strcmp( WIDTH_COMMAND, argv[arg] ) == 0 && arg + 1 < last ) {
+            char *end;
+            long value = strtol( argv[++arg], &end, 10 );
+            if ( *end != '\0' || value < MAX_NUMBER_OF_CHARS || value > MAX_LINE_LENGTH ||
+                 value % MAX_NUMBER_OF_CHARS != 0 ) {
+                fprintf( stderr, USAGE );
+                exit( EXIT_FAILURE );
+            }
+            width = value;
         }
-    }
-    //If the number of arguments is 5 then check that both commands are valid
-    else if ( argc == ARG_VALUE_FIVE ) {
-        //If both commands are valid then set both flags to true
-        if ( ( strcmp( BREAK_COMMAND, argv[1] ) == 0 ) && 
-        ( strcmp( PADDING_COMMAND, argv[ARG_VALUE_TWO] ) == 0 ) ) {
-            encode( argv[ARG_VALUE_THREE], argv[ARG_VALUE_FOUR], true, true );
+        //If the command is equal to the crlf command then end lines with "\r\n"
+        else if ( strcmp( CRLF_COMMAND, argv[arg] ) == 0 ) {
+            crlf = true;
         }
-        //If both commands are valid then set both flags to true
-        else if ( ( strcmp( PADDING_COMMAND, argv[1] ) == 0 ) && 
-        ( strcmp( BREAK_COMMAND, argv[ARG_VALUE_TWO] ) == 0 ) ) {
-            encode( argv[ARG_VALUE_THREE], argv[ARG_VALUE_FOUR], true, true );
+        //If the command is equal to the url command then use the URL safe alphabet
+        else if ( strcmp( URL_COMMAND, argv[arg] ) == 0 ) {
+            selectAlphabet( URL_ALPHABET_NAME );
         }
-        //If the user puts the same command twice then just run encode with the correct command
-        else if ( ( strcmp( BREAK_COMMAND, argv[1] ) == 0 ) && 
-        ( strcmp( BREAK_COMMAND, argv[ARG_VALUE_TWO] ) == 0 ) ) {
-            encode( argv[ARG_VALUE_THREE], argv[ARG_VALUE_FOUR], true, false );
+        //If the command is equal to the alphabet command then pick the alphabet by name
+        else if ( strcmp( ALPHABET_COMMAND, argv[arg] ) == 0 && arg + 1 < last ) {
+            if ( !selectAlphabet( argv[++arg] ) ) {
+                fprintf( stderr, USAGE );
+                exit( EXIT_FAILURE );
+            }
         }
-        //If the user puts the same command twice then just run encode with the correct command
-        else if ( ( strcmp( PADDING_COMMAND, argv[1] ) == 0 ) && 
-        ( strcmp( PADDING_COMMAND, argv[ARG_VALUE_TWO] ) == 0 ) ) {
-            encode( argv[ARG_VALUE_THREE], argv[ARG_VALUE_FOUR], false, true );
+        //If the command is equal to the threads command then read the number of threads
+        else if ( strcmp( THREADS_COMMAND, argv[arg] ) == 0 && arg + 1 < last ) {
+            char *end;
+            long value = strtol( argv[++arg], &end, 10 );
+            if ( *end != '\0' || value < 1 || value > MAX_THREADS ) {
+                fprintf( stderr, USAGE );
+                exit( EXIT_FAILURE );
+            }
+            threads = value;
+        }
+        //If the command is equal to the append command then add onto the outputfile
+        else if ( strcmp( APPEND_COMMAND, argv[arg] ) == 0 ) {
+            append = true;
+        }
+        //If the command is equal to the gzip command then compress the input before encoding
+        else if ( strcmp( GZIP_COMMAND, argv[arg] ) == 0 ) {
+            gzip = true;
+        }
+        //If the command is equal to the digest command then print the digest of the input
+        else if ( strcmp( DIGEST_COMMAND, argv[arg] ) == 0 ) {
+            printDigest( &digest );
         }
-        //Exit the program and print usage message since the commands are invalid
+        //If the command is equal to the digest file command then write the digest to a file
+        else if ( strcmp( DIGEST_FILE_COMMAND, argv[arg] ) == 0 && arg + 1 < last ) {
+            writeDigest( &digest, argv[++arg] );
+        }
+        //If the command is equal to the stats command then print the stats at the end
+        else if ( strcmp( STATS_COMMAND, argv[arg] ) == 0 ) {
+            statsFlag = true;
+        }
+        //Exit the program and print usage message since the command is invalid
         else {
-            fprintf( stderr, "usage: encode [-b] [-p] <input-file> <output-file>\n" );
+            fprintf( stderr, USAGE );
             exit( EXIT_FAILURE );
         }
     }
+    //If the user inputted an incorrect amount of arguments then print usage message, the
+    //outputfile has to be read back when appending so it can't be the standard output,
+    //and the gzip pipeline picks its own threads
+    if ( arg != last || ( append && ( batch || tree || threads > 0 ||
+                                      isStandardStream( argv[arg + 1] ) ) ) ||
+         ( ( digest.enabled || gzip ) && ( batch || tree ) ) ||
+         ( gzip && ( append || threads > 0 ) ) ) {
+        fprintf( stderr, USAGE );
+        exit( EXIT_FAILURE );
+    }
+    //Stop before the outputfile is opened if it is the inputfile, since opening it would
+    //empty the inputfile before it is read
+    if ( !batch && !tree && sameStream( argv[arg], argv[arg + 1] ) ) {
+        fprintf( stderr, "%s: %s\n", argv[arg + 1], SAME_FILE_ERROR );
+        exit( EXIT_FAILURE );
+    }
+    Stats stats;
+    startStats( &stats, statsFlag );
+    Encoder encoder;
+    initEncoderLines( &encoder, bFlag ? 0 : width, crlf, !pFlag );
+    //Compress and encode the inputfile in a pipeline, which has its own threads
+    if ( gzip ) {
+        encodeCompressed( argv[arg], argv[arg + 1], &encoder, &digest, &stats );
+        printStats( &stats, "encode" );
+        finishDigest( &digest, argv[arg] );
+        return EXIT_SUCCESS;
+    }
+    //Encode every file in the manifest or the directory tree, using all the CPUs by default
+    if ( batch || tree ) {
+        size_t count;
+        BatchJob *jobs = batch ? readManifest( argv[arg + 1], &count ) :
+                                 readTree( argv[arg + 1], argv[arg + 2], &count );
+        if ( threads == 0 ) {
+            long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+            threads = cpus > 1 ? cpus : 1;
+        }
+        bool success = runBatch( jobs, count, threads, encodeBatchFile, &encoder, &stats );
+        freeBatch( jobs, count );
+        printStats( &stats, "encode" );
+        return success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    //Copy the outputfile from the cache if the inputfile was encoded with the same options
+    //before, otherwise encode it and keep a copy in the cache
+    char const *cache = getenv( CACHE_VARIABLE );
+    char name[CACHE_NAME_LENGTH];
+    if ( cache && !append && !digest.enabled && !isStandardStream( argv[arg] ) &&
+         !isStandardStream( argv[arg + 1] ) && cacheName( cache, argv[arg], &encoder, name ) ) {
+        size_t size;
+        struct stat info;
+        if ( fetchCache( cache, name, argv[arg + 1], &size ) ) {
+            //Count the bytes of the inputfile and the copied outputfile as if it was encoded
+            stats.bytesIn = stat( argv[arg], &info ) == 0 ? info.st_size : 0;
+            stats.bytesOut = size;
+        } else {
+            encode( argv[arg], argv[arg + 1], &encoder, threads == 0 ? 1 : threads, false,
+                    &digest, &stats );
+            storeCache( cache, name, argv[arg + 1], cacheLimit() );
+        }
+        printStats( &stats, "encode" );
+        return EXIT_SUCCESS;
+    }
+    //The digest is worked out in order, so the input is encoded by one thread when it is used
+    encode( argv[arg], argv[arg + 1], &encoder, threads == 0 || digest.enabled ? 1 : threads,
+            append, &digest, &stats );
+    finishDigest( &digest, argv[arg] );
+    printStats( &stats, "encode" );
     //Exit program successfully
     return EXIT_SUCCESS;
 }
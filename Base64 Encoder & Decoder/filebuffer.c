@@ -1,9 +1,22 @@
 /**
  * @file filebuffer.c
  * @author Daniel Avisse (djavisse)
- * 
+ * This is the FileBuffer component. A filebuffer is a resizable array of bytes that
+ * can be loaded from a file or saved to a file. Filebuffers loaded from regular files
+ * are mapped into memory and are read-only until a byte is appended to them.
  */
 #include "filebuffer.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** Number of bytes read at a time when a file can't be mapped */
+#define READ_SIZE 65536
+
+size_t fileBufferGrowths = 0;
+
+size_t fileBufferBytesCopied = 0;
 
 FileBuffer *makeFileBuffer () 
 {
@@ -12,6 +25,7 @@ FileBuffer *makeFileBuffer ()
     //Set the inital capacity and set count to zero
     buffer->capacity = INITIAL_CAPACITY;
     buffer->count = 0;
+    buffer->mapped = false;
     //Allocate space for the data array using the capacity
     buffer->data = ( byte * )malloc( buffer->capacity * sizeof(byte ) );
     //Return the new buffer
@@ -20,50 +34,234 @@ FileBuffer *makeFileBuffer ()
 
 void freeFileBuffer ( FileBuffer * buffer )
 {
-    //Free the data array in fileBuffer
-    free( buffer->data );
+    //Unmap or free the data array in fileBuffer
+    if ( buffer->mapped ) {
+        munmap( buffer->data, buffer->capacity );
+    } else {
+        free( buffer->data );
+    }
     //Free the fileBuffer itself
     free( buffer );
 }
 
 void appendFileBuffer ( FileBuffer * buffer, byte val )
 {
-    //Add the byte to the data array in fileBuffer
-    buffer->data[buffer->count++] = val;
-    //Resize the buffer if necessary
-    if ( buffer->count >= buffer->capacity ) {
-        buffer->capacity *= DOUBLE_SIZE;
-        buffer->data = ( byte * ) realloc( buffer->data, buffer->capacity * sizeof( byte ) );
+    //Add the byte to the data array in fileBuffer, resizing it if necessary
+    *reserveFileBuffer( buffer, 1 ) = val;
+    buffer->count++;
+}
+
+void appendBytesFileBuffer ( FileBuffer * buffer, byte const data[], size_t length )
+{
+    memcpy( reserveFileBuffer( buffer, length ), data, length );
+    buffer->count += length;
+}
+
+byte *reserveFileBuffer ( FileBuffer * buffer, size_t size )
+{
+    //Copy a mapped buffer into allocated memory before changing it
+    if ( buffer->mapped ) {
+        size_t mappedSize = buffer->capacity;
+        buffer->capacity = buffer->count * DOUBLE_SIZE + INITIAL_CAPACITY;
+        if ( buffer->capacity < buffer->count + size ) {
+            buffer->capacity = buffer->count + size;
+        }
+        byte *data = ( byte * )malloc( buffer->capacity * sizeof( byte ) );
+        memcpy( data, buffer->data, buffer->count );
+        __atomic_add_fetch( &fileBufferGrowths, 1, __ATOMIC_RELAXED );
+        __atomic_add_fetch( &fileBufferBytesCopied, buffer->count, __ATOMIC_RELAXED );
+        munmap( buffer->data, mappedSize );
+        buffer->data = data;
+        buffer->mapped = false;
+    }
+    //Grow the data array to at least double its size if the bytes don't fit
+    if ( buffer->capacity - buffer->count < size ) {
+        size_t capacity = buffer->capacity * DOUBLE_SIZE;
+        if ( capacity < buffer->count + size ) {
+            capacity = buffer->count + size;
+        }
+        resizeFileBuffer( buffer, capacity );
+    }
+    return buffer->data + buffer->count;
+}
+
+void commitFileBuffer ( FileBuffer * buffer, size_t size )
+{
+    buffer->count += size;
+}
+
+void initFileBufferPool ( FileBufferPool *pool )
+{
+    pool->buffers = NULL;
+    pool->count = 0;
+    pool->capacity = 0;
+    pthread_mutex_init( &pool->lock, NULL );
+}
+
+FileBuffer *takeFileBuffer ( FileBufferPool *pool )
+{
+    FileBuffer *buffer = NULL;
+    pthread_mutex_lock( &pool->lock );
+    if ( pool->count > 0 ) {
+        buffer = pool->buffers[--pool->count];
+    }
+    pthread_mutex_unlock( &pool->lock );
+    //Make a new filebuffer if there weren't any to reuse
+    if ( !buffer ) {
+        buffer = makeFileBuffer();
     }
+    buffer->count = 0;
+    return buffer;
+}
+
+void giveFileBuffer ( FileBufferPool *pool, FileBuffer * buffer )
+{
+    if ( buffer->mapped ) {
+        freeFileBuffer( buffer );
+        return;
+    }
+    pthread_mutex_lock( &pool->lock );
+    if ( pool->count == pool->capacity ) {
+        pool->capacity = pool->capacity * DOUBLE_SIZE + 1;
+        pool->buffers = ( FileBuffer ** )realloc( pool->buffers,
+                                                  pool->capacity * sizeof( FileBuffer * ) );
+    }
+    pool->buffers[pool->count++] = buffer;
+    pthread_mutex_unlock( &pool->lock );
+}
+
+void freeFileBufferPool ( FileBufferPool *pool )
+{
+    for ( size_t i = 0; i < pool->count; i++ ) {
+        freeFileBuffer( pool->buffers[i] );
+    }
+    free( pool->buffers );
+    pthread_mutex_destroy( &pool->lock );
+}
+
+void resizeFileBuffer ( FileBuffer * buffer, size_t capacity )
+{
+    //Count the growth, the buffers can be resized by more than one thread at a time
+    __atomic_add_fetch( &fileBufferGrowths, 1, __ATOMIC_RELAXED );
+    __atomic_add_fetch( &fileBufferBytesCopied, buffer->count, __ATOMIC_RELAXED );
+    buffer->capacity = capacity;
+    buffer->data = ( byte * ) realloc( buffer->data, buffer->capacity * sizeof( byte ) );
+}
+
+FileBuffer *mapFileBuffer ( int fd )
+{
+    //Only regular files with bytes in them can be mapped, and only if they are being read
+    //from the start, which might not be the case for the standard input
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) || info.st_size <= 0 ||
+         lseek( fd, 0, SEEK_CUR ) != 0 ) {
+        return NULL;
+    }
+    size_t fileSize = info.st_size;
+    //Map the whole file read-only
+    void *data = mmap( NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( data == MAP_FAILED ) {
+        return NULL;
+    }
+    //Tell the kernel the file will be read from start to end so it reads ahead
+    madvise( data, fileSize, MADV_SEQUENTIAL );
+    //Create a filebuffer around the mapping
+    FileBuffer *buffer = ( FileBuffer * )malloc( sizeof( FileBuffer ) );
+    buffer->data = ( byte * )data;
+    buffer->capacity = fileSize;
+    buffer->count = fileSize;
+    buffer->mapped = true;
+    return buffer;
+}
+
+FileBuffer *mapOutputFileBuffer ( int fd, size_t size )
+{
+    //Only regular files opened for reading and writing from the start can be mapped, so
+    //a standard output that is appended to or already has bytes in it is left alone
+    struct stat info;
+    int flags = fcntl( fd, F_GETFL );
+    if ( size == 0 || fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) || flags < 0 ||
+         ( flags & O_ACCMODE ) != O_RDWR || ( flags & O_APPEND ) ||
+         lseek( fd, 0, SEEK_CUR ) != 0 ) {
+        return NULL;
+    }
+    //Set the size of the file and make sure the disk space for it is there
+    if ( ftruncate( fd, size ) != 0 || posix_fallocate( fd, 0, size ) != 0 ) {
+        ftruncate( fd, 0 );
+        return NULL;
+    }
+    //Map the whole file so it can be written to
+    void *data = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if ( data == MAP_FAILED ) {
+        ftruncate( fd, 0 );
+        return NULL;
+    }
+    //Create a filebuffer around the mapping
+    FileBuffer *buffer = ( FileBuffer * )malloc( sizeof( FileBuffer ) );
+    buffer->data = ( byte * )data;
+    buffer->capacity = size;
+    buffer->count = 0;
+    buffer->mapped = true;
+    return buffer;
+}
+
+void finishFileBuffer ( FileBuffer * buffer, int fd )
+{
+    //Cut the file down to the bytes that were written
+    size_t count = buffer->count;
+    freeFileBuffer( buffer );
+    if ( ftruncate( fd, count ) != 0 ) {
+        perror( "ftruncate" );
+        exit( EXIT_FAILURE );
+    }
+}
+
+size_t releaseFileBuffer ( FileBuffer * buffer, size_t start, size_t end )
+{
+    //Round the start up and the end down to the start of their pages
+    size_t pageSize = sysconf( _SC_PAGESIZE );
+    start = ( start + pageSize - 1 ) / pageSize * pageSize;
+    end -= end % pageSize;
+    //Drop the pages from the mapping, they can be read again from the page cache
+    if ( buffer->mapped && end > start ) {
+        madvise( buffer->data + start, end - start, MADV_DONTNEED );
+        return end;
+    }
+    return start;
 }
 
 FileBuffer *loadFileBuffer ( char const * filename) 
 {
-    //Open the file in binary read mode
-    FILE *stream = fopen( filename, "rb" );
+    //Open the file in read mode
+    int fd = open( filename, O_RDONLY );
     //If the file doesn't exist then exit the program and report error message
-    if ( !stream ) {
+    if ( fd < 0 ) {
+        perror( filename );
+        exit( EXIT_FAILURE );
+    }
+    //Map the file if possible
+    FileBuffer *buffer = mapFileBuffer( fd );
+    if ( buffer ) {
+        close( fd );
+        return buffer;
+    }
+    //Otherwise read all the bytes into a new fileBuffer
+    buffer = makeFileBuffer();
+    ssize_t length;
+    do {
+        //Make sure there is room for a full read at the end of the buffer
+        length = read( fd, reserveFileBuffer( buffer, READ_SIZE ), READ_SIZE );
+        if ( length > 0 ) {
+            commitFileBuffer( buffer, length );
+        }
+    } while ( length > 0 );
+    //Report error message and exit if the file couldn't be read
+    if ( length < 0 ) {
         perror( filename );
         exit( EXIT_FAILURE );
     }
-    //Create a new fileBuffer
-    FileBuffer *buffer = makeFileBuffer();
-    //Go to the end of the file
-    fseek( stream, 0, SEEK_END );
-    //Get the length of the file
-    int fileSize = ftell( stream );
-    //Go back to the beginning of the file
-    rewind( stream );
-    //Create a byte array of the size of the length of the file
-    byte data[fileSize];
-    //Read all the bytes into the data array
-    fread( data, sizeof( byte ), fileSize, stream ); 
-    //Add all the bytes from the data array into the filebuffer  
-    for ( int i = 0; i < fileSize; i++ ) {
-        appendFileBuffer( buffer, data[i] );
-    } 
     //Return the buffer
-    fclose( stream );
+    close( fd );
     return buffer;
 }
 
@@ -12,12 +12,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 
 /** A shorthand for talking about a byte. */
 typedef unsigned char byte;
 
-/** The inital capacity when creating filebuffers */
-#define INITIAL_CAPACITY 5
+/** The inital capacity when creating filebuffers, this is one page */
+#define INITIAL_CAPACITY 4096
 
 /** Value used to double the capacity of the filebuffer */
 #define DOUBLE_SIZE 2
@@ -34,10 +35,38 @@ typedef struct {
 
   // More fields added by you.
   // ..
-  int capacity;
-  int count; 
+  size_t capacity;
+  size_t count; 
+
+  /** True if data is a read-only mapping of a file instead of allocated memory. */
+  bool mapped;
 } FileBuffer;
 
+/**
+ * This is the FileBufferPool struct. It holds filebuffers that have been given back so
+ * they can be taken again without allocating their data arrays again. A pool can be
+ * shared by many threads.
+ */
+typedef struct {
+  /** Resizable array of the filebuffers waiting to be taken. */
+  FileBuffer **buffers;
+
+  /** The number of filebuffers waiting to be taken. */
+  size_t count;
+
+  /** The number of filebuffers there is room for in the array. */
+  size_t capacity;
+
+  /** Lock used when taking or giving back a filebuffer. */
+  pthread_mutex_t lock;
+} FileBufferPool;
+
+/** Number of times the data array of a filebuffer has been made bigger */
+extern size_t fileBufferGrowths;
+
+/** Number of bytes copied when the data array of a filebuffer was made bigger */
+extern size_t fileBufferBytesCopied;
+
 /**
  * This function creates a new fileBuffer. In this function it will allocate space for the
  * filebuffer and also initialize all the fields.
@@ -59,10 +88,125 @@ void freeFileBuffer( FileBuffer * buffer );
  */
 void appendFileBuffer( FileBuffer * buffer, byte val );
 
+/**
+ * This function adds many bytes to the end of the filebuffer at once, making room for
+ * all of them first so the data array is resized at most once.
+ * @param buffer The buffer that will get bytes added to
+ * @param data The bytes that will be added to the filebuffer
+ * @param length The number of bytes
+ */
+void appendBytesFileBuffer ( FileBuffer * buffer, byte const data[], size_t length );
+
+/**
+ * This function makes sure there is room for the given number of bytes after the bytes
+ * already in the filebuffer and returns where they go, so they can be written straight
+ * into the data array. The capacity is at least doubled when it grows, so reserving a
+ * little at a time doesn't copy the bytes over and over. A mapped filebuffer is copied
+ * into allocated memory first. Once the bytes are written, commitFileBuffer adds them.
+ * @param buffer The filebuffer
+ * @param size The number of bytes that need to fit after the bytes already in it
+ * @return byte* Where the next byte goes in the data array
+ */
+byte *reserveFileBuffer ( FileBuffer * buffer, size_t size );
+
+/**
+ * This function adds bytes that were written straight into the data array, at the
+ * pointer given by reserveFileBuffer, to the count of the filebuffer.
+ * @param buffer The filebuffer
+ * @param size The number of bytes that were written
+ */
+void commitFileBuffer ( FileBuffer * buffer, size_t size );
+
+/**
+ * This function starts an empty pool of filebuffers.
+ * @param pool The pool being started
+ */
+void initFileBufferPool ( FileBufferPool *pool );
+
+/**
+ * This function takes an empty filebuffer from the pool, or makes a new one if the pool
+ * is empty. A filebuffer that was given back keeps the room it had, so it can be filled
+ * again without being resized.
+ * @param pool The pool
+ * @return FileBuffer* The empty filebuffer
+ */
+FileBuffer *takeFileBuffer ( FileBufferPool *pool );
+
+/**
+ * This function gives a filebuffer back to the pool so it can be taken again. Mapped
+ * filebuffers are freed instead, since their memory can't be reused.
+ * @param pool The pool
+ * @param buffer The filebuffer being given back
+ */
+void giveFileBuffer ( FileBufferPool *pool, FileBuffer * buffer );
+
+/**
+ * This function frees the pool and all the filebuffers in it.
+ * @param pool The pool being freed
+ */
+void freeFileBufferPool ( FileBufferPool *pool );
+
+/**
+ * This function changes the capacity of an allocated filebuffer, keeping the bytes already
+ * in it. Each time this is done it is counted in fileBufferGrowths and fileBufferBytesCopied,
+ * which can be used to see how much work growing the filebuffers took.
+ * @param buffer The filebuffer being resized
+ * @param capacity The new capacity of the filebuffer
+ */
+void resizeFileBuffer ( FileBuffer * buffer, size_t capacity );
+
+/**
+ * This function maps the contents of an open file into a new read-only filebuffer.
+ * The bytes are read straight from the page cache when they are used, so nothing
+ * gets copied. Only regular files can be mapped, so NULL is returned for pipes,
+ * empty files, files that aren't being read from the start and other files that can't
+ * be mapped.
+ * @param fd The file descriptor of the open file that will be mapped
+ * @return FileBuffer* The mapped filebuffer or NULL if the file can't be mapped
+ */
+FileBuffer *mapFileBuffer ( int fd );
+
+/**
+ * This function sets the size of an open output file and maps it into a new writable
+ * filebuffer, so bytes can be written straight into the file. The space for the file
+ * is allocated up front so running out of disk space is reported here instead of when
+ * the mapping is written to. The filebuffer starts with a count of zero and a capacity
+ * of the given size. NULL is returned if the file can't be mapped, for example if it
+ * is a pipe, it isn't open for reading and writing, it is being appended to or the
+ * size is zero.
+ * @param fd The file descriptor of the open output file
+ * @param size The size the output file will be mapped with
+ * @return FileBuffer* The mapped filebuffer or NULL if the file can't be mapped
+ */
+FileBuffer *mapOutputFileBuffer ( int fd, size_t size );
+
+/**
+ * This function finishes writing to a mapped output filebuffer. The output file is
+ * cut down to the number of bytes that were written into the filebuffer, and then the
+ * filebuffer is freed.
+ * @param buffer The mapped output filebuffer that will be finished
+ * @param fd The file descriptor of the output file the filebuffer was mapped from
+ */
+void finishFileBuffer ( FileBuffer * buffer, int fd );
+
+/**
+ * This function tells the kernel that the bytes of a mapped filebuffer from the start
+ * offset up to the end offset won't be used again. Only whole pages can be released,
+ * so the start is rounded up and the end is rounded down to the start of its page. The pages stay in the page cache
+ * but no longer count against the memory used by the program.
+ * @param buffer The mapped filebuffer that will have pages released
+ * @param start The offset of the first byte to release, this should be the end returned
+ * by the last call or zero
+ * @param end The offset after the last byte that has been used
+ * @return size_t The offset where the next release should start from
+ */
+size_t releaseFileBuffer ( FileBuffer * buffer, size_t start, size_t end );
+
 /**
  * This function reads a bin and is able to load all the contents of the file into a new 
  * filebuffer. The filebuffer is then returned once all the contents of the file have
- * been read. 
+ * been read. Regular files are mapped using mapFileBuffer, any other files like pipes
+ * are read into the filebuffer using read().
  * @param filename The file that will be read
  * @return FileBuffer* The filebuffer returned after reading all the contents of the file
  */
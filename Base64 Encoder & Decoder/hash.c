@@ -0,0 +1,189 @@
+/**
+ * @file hash.c
+ * @author Daniel Avisse (djavisse)
+ * This is the hash component. This component works out a fast 64 bit hash of some
+ * bytes, either all at once or one block at a time, so it can be worked out while the
+ * bytes go past for something else. The hash is XXH64, which hashes 32 bytes at a time
+ * with four accumulators that don't depend on each other, so it runs at about the speed
+ * the bytes can be read. Like the base64 component, nothing here allocates memory.
+ */
+
+#include "hash.h"
+
+/** The first prime used by the hash */
+#define PRIME_1 0x9E3779B185EBCA87ULL
+
+/** The second prime used by the hash */
+#define PRIME_2 0xC2B2AE3D27D4EB4FULL
+
+/** The third prime used by the hash */
+#define PRIME_3 0x165667B19E3779F9ULL
+
+/** The fourth prime used by the hash */
+#define PRIME_4 0x85EBCA77C2B2AE63ULL
+
+/** The fifth prime used by the hash */
+#define PRIME_5 0x27D4EB2F165667C5ULL
+
+/** Number of bytes in each lane of a stripe */
+#define LANE_SIZE 8
+
+/** Number of bytes in the half lane hashed near the end */
+#define HALF_LANE_SIZE 4
+
+/** Rotates a 64 bit value left by a number of bits */
+#define ROTATE( value, bits ) ( ( ( value ) << ( bits ) ) | ( ( value ) >> ( 64 - ( bits ) ) ) )
+
+/**
+ * This function is a helper function that reads 8 bytes as a little endian number.
+ * @param data The bytes
+ * @return uint64_t The number
+ */
+static uint64_t readLane ( byte const *data )
+{
+    uint64_t value;
+    memcpy( &value, data, sizeof( value ) );
+    return value;
+}
+
+/**
+ * This function is a helper function that mixes one lane of a stripe into an
+ * accumulator.
+ * @param lane The accumulator
+ * @param value The 8 bytes of the lane
+ * @return uint64_t The new accumulator
+ */
+static uint64_t mixLane ( uint64_t lane, uint64_t value )
+{
+    lane += value * PRIME_2;
+    lane = ROTATE( lane, 31 );
+    return lane * PRIME_1;
+}
+
+/**
+ * This function is a helper function that mixes one accumulator into the hash once the
+ * stripes are done.
+ * @param hash The hash
+ * @param lane The accumulator
+ * @return uint64_t The new hash
+ */
+static uint64_t mergeLane ( uint64_t hash, uint64_t lane )
+{
+    hash ^= mixLane( 0, lane );
+    return hash * PRIME_1 + PRIME_4;
+}
+
+/**
+ * This function is a helper function that hashes whole stripes into the accumulators.
+ * @param lanes The accumulators
+ * @param data The bytes being hashed
+ * @param stripes The number of stripes
+ */
+static void hashStripes ( uint64_t lanes[], byte const *data, size_t stripes )
+{
+    uint64_t v1 = lanes[0];
+    uint64_t v2 = lanes[1];
+    uint64_t v3 = lanes[2];
+    uint64_t v4 = lanes[3];
+    for ( size_t i = 0; i < stripes; i++, data += HASH_STRIPE_SIZE ) {
+        v1 = mixLane( v1, readLane( data ) );
+        v2 = mixLane( v2, readLane( data + LANE_SIZE ) );
+        v3 = mixLane( v3, readLane( data + LANE_SIZE * 2 ) );
+        v4 = mixLane( v4, readLane( data + LANE_SIZE * 3 ) );
+    }
+    lanes[0] = v1;
+    lanes[1] = v2;
+    lanes[2] = v3;
+    lanes[3] = v4;
+}
+
+void initHasher ( Hasher *hasher, uint64_t seed )
+{
+    hasher->lanes[0] = seed + PRIME_1 + PRIME_2;
+    hasher->lanes[1] = seed + PRIME_2;
+    hasher->lanes[2] = seed;
+    hasher->lanes[3] = seed - PRIME_1;
+    hasher->seed = seed;
+    hasher->total = 0;
+    hasher->buffered = 0;
+}
+
+void hashUpdate ( Hasher *hasher, void const *data, size_t length )
+{
+    byte const *bytes = ( byte const * )data;
+    hasher->total += length;
+    //Finish the stripe left in the buffer from the last block
+    if ( hasher->buffered > 0 ) {
+        size_t count = HASH_STRIPE_SIZE - hasher->buffered;
+        if ( count > length ) {
+            count = length;
+        }
+        memcpy( hasher->buffer + hasher->buffered, bytes, count );
+        hasher->buffered += count;
+        bytes += count;
+        length -= count;
+        if ( hasher->buffered < HASH_STRIPE_SIZE ) {
+            return;
+        }
+        hashStripes( hasher->lanes, hasher->buffer, 1 );
+        hasher->buffered = 0;
+    }
+    //Hash the whole stripes straight from the block and keep the rest for the next one
+    size_t stripes = length / HASH_STRIPE_SIZE;
+    hashStripes( hasher->lanes, bytes, stripes );
+    bytes += stripes * HASH_STRIPE_SIZE;
+    length -= stripes * HASH_STRIPE_SIZE;
+    memcpy( hasher->buffer, bytes, length );
+    hasher->buffered = length;
+}
+
+uint64_t hashFinish ( Hasher const *hasher )
+{
+    //Put the accumulators together, or start from the seed if there wasn't a whole stripe
+    uint64_t hash;
+    uint64_t const *lanes = hasher->lanes;
+    if ( hasher->total >= HASH_STRIPE_SIZE ) {
+        hash = ROTATE( lanes[0], 1 ) + ROTATE( lanes[1], 7 ) + ROTATE( lanes[2], 12 ) +
+               ROTATE( lanes[3], 18 );
+        for ( int i = 0; i < HASH_LANES; i++ ) {
+            hash = mergeLane( hash, lanes[i] );
+        }
+    } else {
+        hash = hasher->seed + PRIME_5;
+    }
+    hash += hasher->total;
+    //Mix in the bytes left in the buffer, a lane, then half a lane, then a byte at a time
+    byte const *data = hasher->buffer;
+    size_t length = hasher->buffered;
+    for ( ; length >= LANE_SIZE; length -= LANE_SIZE, data += LANE_SIZE ) {
+        hash ^= mixLane( 0, readLane( data ) );
+        hash = ROTATE( hash, 27 ) * PRIME_1 + PRIME_4;
+    }
+    if ( length >= HALF_LANE_SIZE ) {
+        uint32_t half;
+        memcpy( &half, data, sizeof( half ) );
+        hash ^= ( uint64_t )half * PRIME_1;
+        hash = ROTATE( hash, 23 ) * PRIME_2 + PRIME_3;
+        length -= HALF_LANE_SIZE;
+        data += HALF_LANE_SIZE;
+    }
+    for ( ; length > 0; length--, data++ ) {
+        hash ^= *data * PRIME_5;
+        hash = ROTATE( hash, 11 ) * PRIME_1;
+    }
+    //Spread every bit of the hash across all of it
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t hashBytes ( void const *data, size_t length, uint64_t seed )
+{
+    Hasher hasher;
+    initHasher( &hasher, seed );
+    hashUpdate( &hasher, data, length );
+    return hashFinish( &hasher );
+}
@@ -0,0 +1,84 @@
+/**
+ * @file hash.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the hash.c component. In this file it contains all the
+ * constants, structs and protypes used in hash.c
+ */
+
+#ifndef _HASH_H_
+#define _HASH_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Include filebuffer to get the byte type.
+#include "filebuffer.h"
+
+/** Number of bytes hashed together in each stripe, one 8 byte lane for each accumulator */
+#define HASH_STRIPE_SIZE 32
+
+/** Number of accumulators the stripes are shared between */
+#define HASH_LANES 4
+
+/** Number of hex digits needed to print a hash */
+#define HASH_HEX_LENGTH 16
+
+/**
+ * This is the Hasher struct. It holds everything needed to keep hashing bytes where the
+ * last block left off. The hash is XXH64, so it matches the hash printed by xxhsum -H1.
+ */
+typedef struct {
+  /** The accumulators, each one takes every fourth 8 byte lane of the input. */
+  uint64_t lanes[HASH_LANES];
+
+  /** The seed the hash was started with. */
+  uint64_t seed;
+
+  /** The number of bytes that have been hashed. */
+  uint64_t total;
+
+  /** The bytes at the end of the last block that don't make up a whole stripe. */
+  byte buffer[HASH_STRIPE_SIZE];
+
+  /** The number of bytes in the buffer. */
+  size_t buffered;
+} Hasher;
+
+/**
+ * This function starts a new Hasher.
+ * @param hasher The Hasher being started
+ * @param seed The seed of the hash, hashes with different seeds are unrelated
+ */
+void initHasher ( Hasher *hasher, uint64_t seed );
+
+/**
+ * This function hashes one block of bytes. Whole stripes are hashed straight from the
+ * block, and the bytes at the end that don't make up a stripe are kept in the Hasher
+ * for the next block.
+ * @param hasher The Hasher holding where the last block left off
+ * @param data The bytes being hashed
+ * @param length The number of bytes
+ */
+void hashUpdate ( Hasher *hasher, void const *data, size_t length );
+
+/**
+ * This function works out the hash of all the bytes given to the Hasher. The Hasher is
+ * left as it is, so more bytes can still be added to it.
+ * @param hasher The Hasher
+ * @return uint64_t The hash
+ */
+uint64_t hashFinish ( Hasher const *hasher );
+
+/**
+ * This function hashes a whole input at once.
+ * @param data The bytes being hashed
+ * @param length The number of bytes
+ * @param seed The seed of the hash
+ * @return uint64_t The hash
+ */
+uint64_t hashBytes ( void const *data, size_t length, uint64_t seed );
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * @file pipeline.c
+ * @author Daniel Avisse (djavisse)
+ * This is the pipeline component. This component runs the steps of a conversion, like
+ * reading, compressing and encoding, as stages on their own threads, so each one runs
+ * on its own core at the same time as the others. The stages pass buffers of bytes to
+ * each other through channels with a fixed number of buffers, so a fast stage waits
+ * for a slow one instead of using more memory, and nothing is ever written to disk
+ * between the stages.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include "pipeline.h"
+
+void initChannel ( Channel *channel, size_t size )
+{
+    channel->buffers = ( byte * )malloc( CHANNEL_DEPTH * size * sizeof( byte ) );
+    channel->size = size;
+    channel->taken = 0;
+    channel->filled = 0;
+    channel->ended = false;
+    channel->failed = false;
+    pthread_mutex_init( &channel->lock, NULL );
+    pthread_cond_init( &channel->changed, NULL );
+}
+
+void freeChannel ( Channel *channel )
+{
+    free( channel->buffers );
+    pthread_mutex_destroy( &channel->lock );
+    pthread_cond_destroy( &channel->changed );
+}
+
+byte *reserveChannel ( Channel *channel )
+{
+    pthread_mutex_lock( &channel->lock );
+    while ( !channel->failed && channel->filled - channel->taken == CHANNEL_DEPTH ) {
+        pthread_cond_wait( &channel->changed, &channel->lock );
+    }
+    byte *buffer = NULL;
+    if ( !channel->failed ) {
+        buffer = channel->buffers + channel->filled % CHANNEL_DEPTH * channel->size;
+    }
+    pthread_mutex_unlock( &channel->lock );
+    return buffer;
+}
+
+void publishChannel ( Channel *channel, size_t count )
+{
+    pthread_mutex_lock( &channel->lock );
+    channel->counts[channel->filled % CHANNEL_DEPTH] = count;
+    channel->filled++;
+    pthread_cond_broadcast( &channel->changed );
+    pthread_mutex_unlock( &channel->lock );
+}
+
+void endChannel ( Channel *channel )
+{
+    pthread_mutex_lock( &channel->lock );
+    channel->ended = true;
+    pthread_cond_broadcast( &channel->changed );
+    pthread_mutex_unlock( &channel->lock );
+}
+
+byte *takeChannel ( Channel *channel, size_t *count )
+{
+    pthread_mutex_lock( &channel->lock );
+    while ( !channel->failed && !channel->ended && channel->taken == channel->filled ) {
+        pthread_cond_wait( &channel->changed, &channel->lock );
+    }
+    byte *buffer = NULL;
+    *count = 0;
+    if ( !channel->failed && channel->taken < channel->filled ) {
+        buffer = channel->buffers + channel->taken % CHANNEL_DEPTH * channel->size;
+        *count = channel->counts[channel->taken % CHANNEL_DEPTH];
+    }
+    pthread_mutex_unlock( &channel->lock );
+    return buffer;
+}
+
+void releaseChannel ( Channel *channel )
+{
+    pthread_mutex_lock( &channel->lock );
+    channel->taken++;
+    pthread_cond_broadcast( &channel->changed );
+    pthread_mutex_unlock( &channel->lock );
+}
+
+void failChannel ( Channel *channel )
+{
+    pthread_mutex_lock( &channel->lock );
+    channel->failed = true;
+    pthread_cond_broadcast( &channel->changed );
+    pthread_mutex_unlock( &channel->lock );
+}
+
+bool channelFailed ( Channel *channel )
+{
+    pthread_mutex_lock( &channel->lock );
+    bool failed = channel->failed;
+    pthread_mutex_unlock( &channel->lock );
+    return failed;
+}
+
+void startStage ( pthread_t *thread, void *( *stage )( void * ), void *arg )
+{
+    if ( pthread_create( thread, NULL, stage, arg ) != 0 ) {
+        perror( "pthread_create" );
+        exit( EXIT_FAILURE );
+    }
+}
+
+void *readStage ( void *arg )
+{
+    ReadStage *reader = ( ReadStage * )arg;
+    Channel *output = reader->output;
+    bool done = false;
+    while ( !done ) {
+        byte *buffer = reserveChannel( output );
+        if ( !buffer ) {
+            return NULL;
+        }
+        //Fill the whole buffer unless the end of the input file is reached first
+        size_t count = 0;
+        while ( count < output->size ) {
+            ssize_t length = read( reader->fd, buffer + count, output->size - count );
+            if ( length < 0 && errno == EINTR ) {
+                continue;
+            }
+            if ( length < 0 ) {
+                reader->error = errno;
+                failChannel( output );
+                return NULL;
+            }
+            if ( length == 0 ) {
+                done = true;
+                break;
+            }
+            count += length;
+        }
+        if ( count > 0 ) {
+            digestUpdate( reader->digest, buffer, count );
+            reader->count += count;
+            publishChannel( output, count );
+        }
+    }
+    endChannel( output );
+    return NULL;
+}
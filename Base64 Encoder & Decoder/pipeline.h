@@ -0,0 +1,167 @@
+/**
+ * @file pipeline.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the pipeline.c component. In this file it contains all the
+ * constants, structs and protypes used in pipeline.c
+ */
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+// Include filebuffer to get the byte type.
+#include "filebuffer.h"
+
+// Include digest to get the Digest the bytes read can be added to.
+#include "digest.h"
+
+/** Number of buffers in each channel, so a stage can only get this far ahead of the next */
+#define CHANNEL_DEPTH 4
+
+/**
+ * This is the Channel struct. It passes buffers of bytes from one stage of a pipeline to
+ * the next, each stage running on its own thread. The channel has a fixed ring of
+ * buffers, so the stage before waits once they are all full and the stage after waits
+ * while they are all empty, and the memory used stays the same no matter how many bytes
+ * go through it. If any stage fails the channel is failed, which wakes up the stages on
+ * both sides so they stop as well.
+ */
+typedef struct {
+  /** The ring of buffers, one after the other. */
+  byte *buffers;
+
+  /** The number of bytes each buffer has room for. */
+  size_t size;
+
+  /** The number of bytes put in each buffer. */
+  size_t counts[CHANNEL_DEPTH];
+
+  /** The number of buffers that have been taken by the stage after. */
+  size_t taken;
+
+  /** The number of buffers that have been filled by the stage before. */
+  size_t filled;
+
+  /** True once the stage before has filled its last buffer. */
+  bool ended;
+
+  /** True once a stage has failed. */
+  bool failed;
+
+  /** Lock used when changing the channel. */
+  pthread_mutex_t lock;
+
+  /** Signalled every time the channel changes. */
+  pthread_cond_t changed;
+} Channel;
+
+/**
+ * This is the ReadStage struct. It holds what the stage that reads the input file into
+ * the first channel of a pipeline needs.
+ */
+typedef struct {
+  /** The file descriptor of the input file. */
+  int fd;
+
+  /** The channel the bytes are read into. */
+  Channel *output;
+
+  /** The Digest the bytes read are added to. */
+  Digest *digest;
+
+  /** The number of bytes read. */
+  size_t count;
+
+  /** The errno of the read that failed, or zero if none did. */
+  int error;
+} ReadStage;
+
+/**
+ * This function starts a new Channel with CHANNEL_DEPTH empty buffers.
+ * @param channel The Channel being started
+ * @param size The number of bytes each buffer has room for
+ */
+void initChannel ( Channel *channel, size_t size );
+
+/**
+ * This function frees the buffers of a Channel once no stage is using it.
+ * @param channel The Channel being freed
+ */
+void freeChannel ( Channel *channel );
+
+/**
+ * This function gives the stage before the channel the next empty buffer to fill. If
+ * all the buffers are full then this waits until the stage after has taken one.
+ * @param channel The Channel
+ * @return byte* The buffer, or NULL if the channel has failed
+ */
+byte *reserveChannel ( Channel *channel );
+
+/**
+ * This function passes the buffer that was reserved last to the stage after the channel.
+ * @param channel The Channel
+ * @param count The number of bytes put in the buffer
+ */
+void publishChannel ( Channel *channel, size_t count );
+
+/**
+ * This function tells the stage after the channel that there are no more buffers.
+ * @param channel The Channel
+ */
+void endChannel ( Channel *channel );
+
+/**
+ * This function gives the stage after the channel the next full buffer. If there isn't
+ * one yet then this waits until the stage before fills one. The buffer has to be given
+ * back with releaseChannel once its bytes have been used.
+ * @param channel The Channel
+ * @param count Gets the number of bytes in the buffer
+ * @return byte* The buffer, or NULL if there are no more buffers or the channel has failed
+ */
+byte *takeChannel ( Channel *channel, size_t *count );
+
+/**
+ * This function gives the buffer that was taken last back to the stage before the
+ * channel so it can be filled again.
+ * @param channel The Channel
+ */
+void releaseChannel ( Channel *channel );
+
+/**
+ * This function fails a channel, so the stages waiting on either side of it stop.
+ * @param channel The Channel
+ */
+void failChannel ( Channel *channel );
+
+/**
+ * This function checks if a channel has failed.
+ * @param channel The Channel
+ * @return true If a stage failed the channel
+ * @return false If it didn't
+ */
+bool channelFailed ( Channel *channel );
+
+/**
+ * This function starts a thread that runs one stage of a pipeline. The program exits
+ * with an error message if the thread can't be started.
+ * @param thread Gets the thread
+ * @param stage The function the thread runs
+ * @param arg The argument passed to the function
+ */
+void startStage ( pthread_t *thread, void *( *stage )( void * ), void *arg );
+
+/**
+ * This function is the stage that reads the input file into the first channel of a
+ * pipeline, filling each buffer before passing it on. The bytes are added to the digest
+ * while they are still in the cache. The channel is failed if a read fails.
+ * @param arg The ReadStage
+ * @return void* NULL once the input file has been read
+ */
+void *readStage ( void *arg );
+
+#endif
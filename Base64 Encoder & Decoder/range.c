@@ -0,0 +1,211 @@
+/**
+ * @file range.c
+ * @author Daniel Avisse (djavisse)
+ * This is the range component. This component finds where a decoded byte comes from in
+ * an encoded file, so only a range of the bytes has to be decoded. Files made by encode
+ * have lines that are all the same length, so the line and column of any char can be
+ * worked out straight away. For files with lines of different lengths an index file can
+ * be built once, which keeps where the file is after every INDEX_STRIDE chars, so only
+ * the chars after the closest offset have to be counted. Without either the file is
+ * counted from the start, using the codec to count the chars that aren't whitespace.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "range.h"
+#include "codec.h"
+
+/**
+ * This function is a helper function that makes the name of the index file of an
+ * encoded file.
+ * @param inputfile The path of the encoded file
+ * @return char* The path of the index file, which needs to be freed
+ */
+static char *indexName ( char const *inputfile )
+{
+    char *name = ( char * )malloc( strlen( inputfile ) + sizeof( INDEX_SUFFIX ) );
+    strcpy( name, inputfile );
+    strcat( name, INDEX_SUFFIX );
+    return name;
+}
+
+bool parseRange ( char const *text, size_t *start, size_t *length )
+{
+    char *end;
+    if ( *text < '0' || *text > '9' ) {
+        return false;
+    }
+    errno = 0;
+    *start = strtoull( text, &end, 10 );
+    if ( *end != RANGE_SEPARATOR || end[1] < '0' || end[1] > '9' ) {
+        return false;
+    }
+    *length = strtoull( end + 1, &end, 10 );
+    return *end == '\0' && errno == 0;
+}
+
+size_t scanOffset ( FileBuffer const *input, size_t from, size_t chars )
+{
+    char const *data = ( char const * )input->data;
+    char packed[RANGE_BLOCK_SIZE];
+    size_t offset = from;
+    //Go past whole blocks, counting the chars in each one that aren't whitespace
+    while ( offset < input->count ) {
+        size_t block = input->count - offset < RANGE_BLOCK_SIZE ? input->count - offset :
+                                                                   RANGE_BLOCK_SIZE;
+        size_t kept = compactSpace( data + offset, block, packed );
+        if ( kept >= chars ) {
+            break;
+        }
+        chars -= kept;
+        offset += block;
+    }
+    //Go through the block with the last char one char at a time
+    while ( chars > 0 && offset < input->count ) {
+        chars -= !IS_SPACE( data[offset] );
+        offset++;
+    }
+    return offset;
+}
+
+bool lineOffset ( FileBuffer const *input, size_t chars, size_t *offset )
+{
+    char const *data = ( char const * )input->data;
+    size_t count = input->count;
+    //Leave out the line ending at the end of the file
+    size_t end = count;
+    if ( end > 0 && data[end - 1] == '\n' ) {
+        end--;
+        if ( end > 0 && data[end - 1] == '\r' ) {
+            end--;
+        }
+    }
+    //If there is only one line then the chars are all in it
+    char const *newline = ( char const * )memchr( data, '\n', end );
+    if ( !newline ) {
+        *offset = chars < end ? chars : count;
+        return true;
+    }
+    //Get the line length and line ending from the first line
+    size_t endingLength = newline > data && newline[-1] == '\r' ? 2 : 1;
+    size_t lineChars = newline - data + 1 - endingLength;
+    size_t lineSize = lineChars + endingLength;
+    if ( lineChars == 0 ) {
+        return false;
+    }
+    //The last line has to start where it would if every line before it was full
+    size_t lastStart = ( char const * )memrchr( data, '\n', end ) - data + 1;
+    if ( lastStart % lineSize != 0 || end - lastStart > lineChars ) {
+        return false;
+    }
+    size_t line = chars / lineChars;
+    *offset = line * lineSize + chars % lineChars;
+    if ( *offset >= end ) {
+        *offset = count;
+        return true;
+    }
+    //The lines before and after the char have to end where they should
+    if ( line > 0 && data[line * lineSize - 1] != '\n' ) {
+        return false;
+    }
+    size_t lineEnd = line * lineSize + lineChars;
+    return lineEnd >= end || data[lineEnd] == data[lineChars];
+}
+
+bool indexOffset ( char const *inputfile, FileBuffer const *input, size_t chars,
+                   size_t *offset )
+{
+    char *name = indexName( inputfile );
+    FILE *stream = fopen( name, "rb" );
+    free( name );
+    if ( !stream ) {
+        return false;
+    }
+    //Only use the index file if it was built for the encoded file as it is now
+    IndexHeader header;
+    struct stat info;
+    bool current = fread( &header, sizeof( header ), 1, stream ) == 1 &&
+                   memcmp( header.magic, INDEX_MAGIC, INDEX_MAGIC_LENGTH ) == 0 &&
+                   header.stride > 0 && header.count > 0 &&
+                   stat( inputfile, &info ) == 0 && header.inputSize == input->count &&
+                   header.modified == info.st_mtim.tv_sec &&
+                   header.modifiedNanoseconds == info.st_mtim.tv_nsec;
+    //Read the closest offset before the char and count the chars after it
+    size_t entry = chars / header.stride;
+    if ( current && entry >= header.count ) {
+        entry = header.count - 1;
+    }
+    uint64_t start;
+    current = current &&
+              fseek( stream, sizeof( header ) + entry * sizeof( uint64_t ), SEEK_SET ) == 0 &&
+              fread( &start, sizeof( start ), 1, stream ) == 1 && start <= input->count;
+    fclose( stream );
+    if ( current ) {
+        *offset = scanOffset( input, start, chars - entry * header.stride );
+    }
+    return current;
+}
+
+size_t charOffset ( char const *inputfile, FileBuffer const *input, size_t chars )
+{
+    size_t offset;
+    if ( lineOffset( input, chars, &offset ) ||
+         indexOffset( inputfile, input, chars, &offset ) ) {
+        return offset;
+    }
+    return scanOffset( input, 0, chars );
+}
+
+void buildIndex ( char const *inputfile )
+{
+    FILE *inStream = fopen( inputfile, "r" );
+    if ( !inStream ) {
+        perror( inputfile );
+        exit( EXIT_FAILURE );
+    }
+    //An empty file can't be mapped, but its index file only has the offset of the start
+    FileBuffer *input = mapFileBuffer( fileno( inStream ) );
+    struct stat info;
+    if ( fstat( fileno( inStream ), &info ) != 0 ||
+         ( !input && ( !S_ISREG( info.st_mode ) || info.st_size != 0 ) ) ) {
+        fprintf( stderr, "%s: Can't map the file to index it\n", inputfile );
+        exit( EXIT_FAILURE );
+    }
+    //Go through the encoded file keeping where it is after every stride of chars
+    size_t size = input ? input->count : 0;
+    size_t capacity = size / INDEX_STRIDE + 1;
+    uint64_t *offsets = ( uint64_t * )malloc( capacity * sizeof( uint64_t ) );
+    size_t count = 1;
+    offsets[0] = 0;
+    while ( input && count < capacity ) {
+        size_t offset = scanOffset( input, offsets[count - 1], INDEX_STRIDE );
+        if ( offset == input->count ) {
+            break;
+        }
+        offsets[count++] = offset;
+    }
+    IndexHeader header;
+    memcpy( header.magic, INDEX_MAGIC, INDEX_MAGIC_LENGTH );
+    header.stride = INDEX_STRIDE;
+    header.inputSize = size;
+    header.modified = info.st_mtim.tv_sec;
+    header.modifiedNanoseconds = info.st_mtim.tv_nsec;
+    header.count = count;
+    if ( input ) {
+        freeFileBuffer( input );
+    }
+    fclose( inStream );
+    //Write the header and the offsets to the index file
+    char *name = indexName( inputfile );
+    FILE *outStream = fopen( name, "wb" );
+    if ( !outStream || fwrite( &header, sizeof( header ), 1, outStream ) != 1 ||
+         fwrite( offsets, sizeof( uint64_t ), count, outStream ) != count ||
+         fclose( outStream ) != 0 ) {
+        perror( name );
+        remove( name );
+        exit( EXIT_FAILURE );
+    }
+    free( name );
+    free( offsets );
+}
@@ -0,0 +1,139 @@
+/**
+ * @file range.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the range.c component. In this file it contains all the
+ * constants, structs and protypes used in range.c
+ */
+
+#ifndef _RANGE_H_
+#define _RANGE_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Include filebuffer to get the FileBuffer the encoded file is mapped into.
+#include "filebuffer.h"
+
+/** The command used to decode only a range of the bytes */
+#define RANGE_COMMAND "--range"
+
+/** The command used to build the index file of an encoded file */
+#define INDEX_COMMAND "--index"
+
+/** The char between the start and the length of a range */
+#define RANGE_SEPARATOR ':'
+
+/** Added to the name of an encoded file to get the name of its index file */
+#define INDEX_SUFFIX ".idx"
+
+/** The chars at the start of every index file */
+#define INDEX_MAGIC "B64INDX1"
+
+/** Number of chars at the start of every index file */
+#define INDEX_MAGIC_LENGTH 8
+
+/** Number of encoded chars between the offsets kept in an index file, a whole number of groups */
+#define INDEX_STRIDE 65536
+
+/** Number of chars counted at a time when going through the encoded file */
+#define RANGE_BLOCK_SIZE 4096
+
+/**
+ * This is the IndexHeader struct. It is at the start of every index file, and is
+ * followed by the offsets. Offset k is where the encoded file is after k times the
+ * stride chars that aren't whitespace. The size and time the encoded file was changed
+ * are kept so an index file that is out of date isn't used.
+ */
+typedef struct {
+  /** INDEX_MAGIC, without a null char at the end. */
+  char magic[INDEX_MAGIC_LENGTH];
+
+  /** The number of chars between the offsets. */
+  uint64_t stride;
+
+  /** The size of the encoded file when the index file was built. */
+  uint64_t inputSize;
+
+  /** The seconds of the time the encoded file was last changed. */
+  int64_t modified;
+
+  /** The nanoseconds of the time the encoded file was last changed. */
+  int64_t modifiedNanoseconds;
+
+  /** The number of offsets after the header. */
+  uint64_t count;
+} IndexHeader;
+
+/**
+ * This function reads a range given as START:LEN, where both are numbers of decoded
+ * bytes.
+ * @param text The range
+ * @param start Gets the offset of the first byte in the range
+ * @param length Gets the number of bytes in the range
+ * @return true If the range was read
+ * @return false If the range isn't two numbers with a colon between them
+ */
+bool parseRange ( char const *text, size_t *start, size_t *length );
+
+/**
+ * This function goes through an encoded file from an offset until it has gone past a
+ * number of chars that aren't whitespace. The blocks it goes past whole are counted by
+ * the codec, and only the last block is gone through one char at a time.
+ * @param input The mapped encoded file
+ * @param from The offset to start from
+ * @param chars The number of chars that aren't whitespace to go past
+ * @return size_t The offset right after the last of those chars, or the end of the file
+ */
+size_t scanOffset ( FileBuffer const *input, size_t from, size_t chars );
+
+/**
+ * This function works out where an encoded char is using the line length of the file.
+ * Files made by encode have lines that are all the same length apart from the last one,
+ * so the line and column of a char can be worked out without reading the lines before
+ * it. The line length and line ending are taken from the first line, and the last line
+ * and the lines around the char are checked to make sure they fit.
+ * @param input The mapped encoded file
+ * @param chars The number of chars that aren't whitespace before the char
+ * @param offset Gets the offset of the char, or the end of the file if it is past it
+ * @return true If the lines fit and the offset was worked out
+ * @return false If the lines aren't all the same length
+ */
+bool lineOffset ( FileBuffer const *input, size_t chars, size_t *offset );
+
+/**
+ * This function works out where an encoded char is using the index file of the encoded
+ * file. The closest offset before the char is read from the index file, and the file is
+ * gone through from there with scanOffset.
+ * @param inputfile The path of the encoded file
+ * @param input The mapped encoded file
+ * @param chars The number of chars that aren't whitespace before the char
+ * @param offset Gets the offset of the char
+ * @return true If the offset was worked out
+ * @return false If there isn't an index file or it is out of date
+ */
+bool indexOffset ( char const *inputfile, FileBuffer const *input, size_t chars,
+                   size_t *offset );
+
+/**
+ * This function works out where an encoded char is. The line length is tried first,
+ * then the index file, and if neither can be used then the file is gone through from
+ * the start.
+ * @param inputfile The path of the encoded file
+ * @param input The mapped encoded file
+ * @param chars The number of chars that aren't whitespace before the char
+ * @return size_t The offset of the char, or the end of the file if it is past it
+ */
+size_t charOffset ( char const *inputfile, FileBuffer const *input, size_t chars );
+
+/**
+ * This function builds the index file of an encoded file, which is named after it with
+ * INDEX_SUFFIX added. The program exits with an error message if the encoded file can't
+ * be mapped or the index file can't be written.
+ * @param inputfile The path of the encoded file
+ */
+void buildIndex ( char const *inputfile );
+
+#endif
@@ -0,0 +1,901 @@
+/**
+ * @file simd.c
+ * @author Daniel Avisse (djavisse)
+ * This is the SIMD component. This component has the engines that use vector
+ * instructions to convert many groups at a time. To encode, the bytes of each group
+ * are shuffled so every 6 bits can be moved into their own byte, and then the 6-bit
+ * values are turned into chars by adding an offset looked up from their range. To
+ * decode, the high and low half of each char are looked up to check it is in the
+ * alphabet and to find the offset that turns it back into its 6-bit value, and then
+ * the values are packed back together into bytes. Each
+ * function is compiled for its own instruction set, so the program still runs on CPUs
+ * without them, and the engine is only used after checking the CPU supports it. The
+ * kernels take the alphabet as a constant and are copied into the engines of each
+ * alphabet, so the chars of the alphabet are built into the instructions. To skip
+ * whitespace, the chars that are kept are packed to the left with a shuffle looked up
+ * from which of them are whitespace, so the decoder only sees chars of the alphabet.
+ */
+
+#include "simd.h"
+#include <immintrin.h>
+#include <stdint.h>
+
+bool ssse3Supported ()
+{
+    return __builtin_cpu_supports( "ssse3" );
+}
+
+bool avx2Supported ()
+{
+    return __builtin_cpu_supports( "avx2" );
+}
+
+bool avx512Supported ()
+{
+    return __builtin_cpu_supports( "avx512bw" ) && __builtin_cpu_supports( "avx512vbmi" );
+}
+
+/**
+ * This function is a helper function that encodes the groups left at the end using the
+ * scalar engine of an alphabet. The alphabet is a constant, so this is a direct call.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+static inline size_t encodeGroupsScalarFor ( byte const data[], size_t groups, char buffer[],
+                                             int alphabet )
+{
+    if ( alphabet == URL_ALPHABET ) {
+        return encodeGroupsScalarUrl( data, groups, buffer );
+    }
+    if ( alphabet == IMAP_ALPHABET ) {
+        return encodeGroupsScalarImap( data, groups, buffer );
+    }
+    return encodeGroupsScalar( data, groups, buffer );
+}
+
+/**
+ * This function is a helper function that decodes the groups left at the end using the
+ * scalar engine of an alphabet.
+ * @param data The chars that will be decoded, this should have 4 chars for each group
+ * @param groups The number of groups of 4 chars to decode
+ * @param buffer The buffer that will get 3 bytes for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of groups that were decoded
+ */
+static inline size_t decodeGroupsScalarFor ( char const data[], size_t groups, byte buffer[],
+                                             int alphabet )
+{
+    if ( alphabet == URL_ALPHABET ) {
+        return decodeGroupsScalarUrl( data, groups, buffer );
+    }
+    if ( alphabet == IMAP_ALPHABET ) {
+        return decodeGroupsScalarImap( data, groups, buffer );
+    }
+    return decodeGroupsScalar( data, groups, buffer );
+}
+
+/**
+ * This function moves each 6 bits of the groups in a 16 byte register into their own
+ * byte. The register should have the bytes of each group shuffled into the order
+ * 1, 0, 2, 1, so the multiplies can shift each 6 bits into place.
+ * @param in The register with the shuffled bytes of 4 groups
+ * @return __m128i The register with the 16 6-bit values
+ */
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i splitBitsSSSE3 ( __m128i in )
+{
+    //Get the first and third 6 bits of each group and shift them down into place
+    __m128i first = _mm_mulhi_epu16( _mm_and_si128( in, _mm_set1_epi32( 0x0FC0FC00 ) ),
+                                     _mm_set1_epi32( 0x04000040 ) );
+    //Get the second and last 6 bits of each group and shift them up into place
+    __m128i second = _mm_mullo_epi16( _mm_and_si128( in, _mm_set1_epi32( 0x003F03F0 ) ),
+                                      _mm_set1_epi32( 0x01000010 ) );
+    return _mm_or_si128( first, second );
+}
+
+/**
+ * This function turns the 6-bit values in a 16 byte register into chars. The values are
+ * sorted into the ranges A-Z, a-z, 0-9 and the last two chars of the alphabet, and the
+ * offset for each range is added.
+ * @param values The register with 16 6-bit values
+ * @param alphabet The index of the alphabet, a constant so the offsets are too
+ * @return __m128i The register with the 16 chars
+ */
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i translateSSSE3 ( __m128i values, int alphabet )
+{
+    //Values 0-25 give 13, values 26-51 give 0 and values 52-63 give 1-12
+    __m128i range = _mm_subs_epu8( values, _mm_set1_epi8( 51 ) );
+    __m128i upper = _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), values );
+    range = _mm_or_si128( range, _mm_and_si128( upper, _mm_set1_epi8( 13 ) ) );
+    //The offset added to the values in each range
+    __m128i offsets = _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                     '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                     '0' - 52, ALPHABET_CHAR_62( alphabet ) - 62,
+                                     ALPHABET_CHAR_63( alphabet ) - 63, 'A', 0, 0 );
+    return _mm_add_epi8( values, _mm_shuffle_epi8( offsets, range ) );
+}
+
+/**
+ * This function encodes 4 groups using SSSE3 instructions. It loads 16 bytes, so it
+ * reads 4 bytes past the groups.
+ * @param in The bytes of the 4 groups
+ * @param out The buffer that will get the 16 chars
+ * @param alphabet The index of the alphabet
+ */
+__attribute__(( target( "ssse3" ) ))
+static inline void encodeBlockSSSE3 ( byte const *in, char *out, int alphabet )
+{
+    //Order used to shuffle the bytes of each group into 1, 0, 2, 1
+    __m128i order = _mm_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+    __m128i values = splitBitsSSSE3( _mm_shuffle_epi8( _mm_loadu_si128( ( __m128i const * )in ),
+                                                       order ) );
+    _mm_storeu_si128( ( __m128i * )out, translateSSSE3( values, alphabet ) );
+}
+
+/**
+ * This function adds a line ending after a line. The ending is only one or two chars,
+ * so they are copied one at a time instead of calling memcpy.
+ * @param out The buffer right after the chars of the line
+ * @param ending The chars added at the end of the line
+ * @param endingLength The number of chars in the line ending
+ */
+static inline void addLineEnding ( char *out, char const ending[], size_t endingLength )
+{
+    for ( size_t i = 0; i < endingLength; i++ ) {
+        out[i] = ending[i];
+    }
+}
+
+/**
+ * This function works out how many lines at the start can be encoded a whole register at
+ * a time. The last register of a line reads and writes past the end of the line, so the
+ * lines after it need to cover everything the register touches.
+ * @param lines The number of lines
+ * @param lineBytes The number of bytes in each line of the input
+ * @param lineChars The number of chars in each line of the buffer, with the line ending
+ * @param readBytes The number of bytes read from the start of a line
+ * @param writeChars The number of chars written from the start of a line
+ * @return size_t The number of lines that can be encoded a whole register at a time
+ */
+static inline size_t fusedLines ( size_t lines, size_t lineBytes, size_t lineChars,
+                                  size_t readBytes, size_t writeChars )
+{
+    //The number of lines from the start of a line that the register touches
+    size_t reach = ( readBytes + lineBytes - 1 ) / lineBytes;
+    size_t writeReach = ( writeChars + lineChars - 1 ) / lineChars;
+    if ( writeReach > reach ) {
+        reach = writeReach;
+    }
+    return lines >= reach ? lines - reach + 1 : 0;
+}
+
+/**
+ * This function encodes whole groups 4 at a time using SSSE3 instructions for one
+ * alphabet, and is what encodeGroupsSSSE3 and its copies for the other alphabets run.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+__attribute__(( target( "ssse3" ), always_inline ))
+static inline size_t encodeGroupsSSSE3For ( byte const data[], size_t groups, char buffer[],
+                                            int alphabet )
+{
+    size_t i = 0;
+    //Encode 4 groups at a time while a full register can be loaded
+    for ( ; i + SSSE3_ENCODE_SLACK <= groups; i += SSSE3_GROUPS ) {
+        encodeBlockSSSE3( data + i * MAX_NUMBER_OF_BYTES, buffer + i * MAX_NUMBER_OF_CHARS,
+                          alphabet );
+    }
+    //Encode the groups left at the end using the lookup tables
+    encodeGroupsScalarFor( data + i * MAX_NUMBER_OF_BYTES, groups - i,
+                           buffer + i * MAX_NUMBER_OF_CHARS, alphabet );
+    return groups * MAX_NUMBER_OF_CHARS;
+}
+
+/**
+ * This function moves each 6 bits of the groups in a 32 byte register into their own
+ * byte, the same way as splitBitsSSSE3.
+ * @param in The register with the shuffled bytes of 8 groups
+ * @return __m256i The register with the 32 6-bit values
+ */
+__attribute__(( target( "avx2" ) ))
+static inline __m256i splitBitsAVX2 ( __m256i in )
+{
+    __m256i first = _mm256_mulhi_epu16( _mm256_and_si256( in, _mm256_set1_epi32( 0x0FC0FC00 ) ),
+                                        _mm256_set1_epi32( 0x04000040 ) );
+    __m256i second = _mm256_mullo_epi16( _mm256_and_si256( in, _mm256_set1_epi32( 0x003F03F0 ) ),
+                                         _mm256_set1_epi32( 0x01000010 ) );
+    return _mm256_or_si256( first, second );
+}
+
+/**
+ * This function turns the 6-bit values in a 32 byte register into chars, the same way
+ * as translateSSSE3.
+ * @param values The register with 32 6-bit values
+ * @param alphabet The index of the alphabet
+ * @return __m256i The register with the 32 chars
+ */
+__attribute__(( target( "avx2" ) ))
+static inline __m256i translateAVX2 ( __m256i values, int alphabet )
+{
+    __m256i range = _mm256_subs_epu8( values, _mm256_set1_epi8( 51 ) );
+    __m256i upper = _mm256_cmpgt_epi8( _mm256_set1_epi8( 26 ), values );
+    range = _mm256_or_si256( range, _mm256_and_si256( upper, _mm256_set1_epi8( 13 ) ) );
+    char last = ALPHABET_CHAR_62( alphabet ) - 62;
+    char end = ALPHABET_CHAR_63( alphabet ) - 63;
+    __m256i offsets = _mm256_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, last, end, 'A', 0, 0,
+                                        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, last, end, 'A', 0, 0 );
+    return _mm256_add_epi8( values, _mm256_shuffle_epi8( offsets, range ) );
+}
+
+/**
+ * This function encodes 8 groups using AVX2 instructions. It loads 16 bytes for each
+ * half, so it reads 4 bytes past the groups.
+ * @param in The bytes of the 8 groups
+ * @param out The buffer that will get the 32 chars
+ * @param alphabet The index of the alphabet
+ */
+__attribute__(( target( "avx2" ) ))
+static inline void encodeBlockAVX2 ( byte const *in, char *out, int alphabet )
+{
+    //Order used to shuffle the bytes of each group into 1, 0, 2, 1 in both halves
+    __m256i order = _mm256_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+    //Load 4 groups into each half of the register
+    __m256i both = _mm256_inserti128_si256(
+                   _mm256_castsi128_si256( _mm_loadu_si128( ( __m128i const * )in ) ),
+                   _mm_loadu_si128( ( __m128i const * )( in + SSSE3_GROUPS *
+                                                         MAX_NUMBER_OF_BYTES ) ), 1 );
+    __m256i values = splitBitsAVX2( _mm256_shuffle_epi8( both, order ) );
+    _mm256_storeu_si256( ( __m256i * )out, translateAVX2( values, alphabet ) );
+}
+
+/**
+ * This function encodes whole groups 8 at a time using AVX2 instructions for one
+ * alphabet, and is what encodeGroupsAVX2 and its copies run.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+__attribute__(( target( "avx2" ), always_inline ))
+static inline size_t encodeGroupsAVX2For ( byte const data[], size_t groups, char buffer[],
+                                           int alphabet )
+{
+    size_t i = 0;
+    //Encode 8 groups at a time while both halves of the register can be loaded
+    for ( ; i + AVX2_ENCODE_SLACK <= groups; i += AVX2_GROUPS ) {
+        encodeBlockAVX2( data + i * MAX_NUMBER_OF_BYTES, buffer + i * MAX_NUMBER_OF_CHARS,
+                         alphabet );
+    }
+    //Encode the groups left at the end using the SSSE3 engine
+    encodeGroupsSSSE3For( data + i * MAX_NUMBER_OF_BYTES, groups - i,
+                          buffer + i * MAX_NUMBER_OF_CHARS, alphabet );
+    return groups * MAX_NUMBER_OF_CHARS;
+}
+
+/**
+ * This function encodes up to 16 groups using AVX-512 VBMI instructions. Only the bytes
+ * of the groups are loaded and only their chars are stored, so nothing past them is
+ * touched.
+ * @param in The bytes of the groups
+ * @param out The buffer that will get 4 chars for each group
+ * @param loadMask The mask of the bytes that are loaded
+ * @param storeMask The mask of the chars that are stored
+ * @param alphabet The index of the alphabet
+ */
+__attribute__(( target( "avx512f,avx512bw,avx512vbmi" ) ))
+static inline void encodeBlockAVX512 ( byte const *in, char *out, __mmask64 loadMask,
+                                       __mmask64 storeMask, int alphabet )
+{
+    //Order used to shuffle the bytes of each group into 1, 0, 2, 1
+    __m512i order = _mm512_setr_epi32( 0x01020001, 0x04050304, 0x07080607, 0x0A0B090A,
+                                       0x0D0E0C0D, 0x10110F10, 0x13141213, 0x16171516,
+                                       0x191A1819, 0x1C1D1B1C, 0x1F201E1F, 0x22232122,
+                                       0x25262425, 0x28292728, 0x2B2C2A2B, 0x2E2F2D2E );
+    //Bit positions of the 6-bit values inside each shuffled group
+    __m512i shifts = _mm512_set1_epi64( 0x3036242A1016040AULL );
+    //The whole alphabet fits in one register, so each value can look up its char
+    __m512i chars = _mm512_loadu_si512( ( void const * )encodeTable[alphabet] );
+    __m512i values = _mm512_multishift_epi64_epi8( shifts, _mm512_permutexvar_epi8( order,
+                                                   _mm512_maskz_loadu_epi8( loadMask, in ) ) );
+    _mm512_mask_storeu_epi8( out, storeMask, _mm512_permutexvar_epi8( values, chars ) );
+}
+
+/**
+ * This function encodes whole groups 16 at a time using AVX-512 VBMI instructions for
+ * one alphabet, and is what encodeGroupsAVX512 and its copies run.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+__attribute__(( target( "avx512f,avx512bw,avx512vbmi" ), always_inline ))
+static inline size_t encodeGroupsAVX512For ( byte const data[], size_t groups, char buffer[],
+                                             int alphabet )
+{
+    size_t i = 0;
+    //Encode 16 groups at a time, only loading the 48 bytes that make up the groups
+    for ( ; i + AVX512_GROUPS <= groups; i += AVX512_GROUPS ) {
+        encodeBlockAVX512( data + i * MAX_NUMBER_OF_BYTES, buffer + i * MAX_NUMBER_OF_CHARS,
+                           AVX512_LOAD_MASK, AVX512_STORE_MASK, alphabet );
+    }
+    //Encode the groups left at the end using the AVX2 engine
+    encodeGroupsAVX2For( data + i * MAX_NUMBER_OF_BYTES, groups - i,
+                         buffer + i * MAX_NUMBER_OF_CHARS, alphabet );
+    return groups * MAX_NUMBER_OF_CHARS;
+}
+
+/**
+ * This function encodes full lines using SSSE3 instructions for one alphabet, and is
+ * what encodeLinesSSSE3 and its copies run.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+__attribute__(( target( "ssse3" ), always_inline ))
+static inline size_t encodeLinesSSSE3For ( byte const data[], size_t lines, size_t lineGroups,
+                                           char const ending[], size_t endingLength, char buffer[],
+                                           int alphabet )
+{
+    size_t lineBytes = lineGroups * MAX_NUMBER_OF_BYTES;
+    size_t lineChars = lineGroups * MAX_NUMBER_OF_CHARS + endingLength;
+    size_t blocks = ( lineGroups + SSSE3_GROUPS - 1 ) / SSSE3_GROUPS;
+    size_t fused = fusedLines( lines, lineBytes, lineChars,
+                               ( blocks - 1 ) * SSSE3_GROUPS * MAX_NUMBER_OF_BYTES +
+                               sizeof( __m128i ), blocks * sizeof( __m128i ) );
+    for ( size_t line = 0; line < lines; line++ ) {
+        byte const *in = data + line * lineBytes;
+        char *out = buffer + line * lineChars;
+        //Encode the whole line a register at a time, the ending covers the spill
+        if ( line < fused ) {
+            for ( size_t block = 0; block < blocks; block++ ) {
+                encodeBlockSSSE3( in + block * SSSE3_GROUPS * MAX_NUMBER_OF_BYTES,
+                                  out + block * sizeof( __m128i ), alphabet );
+            }
+        } else {
+            encodeGroupsSSSE3For( in, lineGroups, out, alphabet );
+        }
+        addLineEnding( out + lineGroups * MAX_NUMBER_OF_CHARS, ending, endingLength );
+    }
+    return lines * lineChars;
+}
+
+/**
+ * This function encodes full lines using AVX2 instructions for one alphabet, and is
+ * what encodeLinesAVX2 and its copies run.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+__attribute__(( target( "avx2" ), always_inline ))
+static inline size_t encodeLinesAVX2For ( byte const data[], size_t lines, size_t lineGroups,
+                                          char const ending[], size_t endingLength, char buffer[],
+                                          int alphabet )
+{
+    size_t lineBytes = lineGroups * MAX_NUMBER_OF_BYTES;
+    size_t lineChars = lineGroups * MAX_NUMBER_OF_CHARS + endingLength;
+    //Finish each line with a 16 byte register if the groups left fit in one
+    size_t blocks = lineGroups / AVX2_GROUPS;
+    size_t tail = lineGroups % AVX2_GROUPS;
+    if ( tail > SSSE3_GROUPS ) {
+        blocks++;
+        tail = 0;
+    }
+    size_t readBytes = blocks * AVX2_GROUPS * MAX_NUMBER_OF_BYTES;
+    size_t writeChars = blocks * sizeof( __m256i );
+    if ( tail > 0 ) {
+        readBytes += sizeof( __m128i );
+        writeChars += sizeof( __m128i );
+    } else {
+        readBytes += sizeof( __m128i ) - SSSE3_GROUPS * MAX_NUMBER_OF_BYTES;
+    }
+    size_t fused = fusedLines( lines, lineBytes, lineChars, readBytes, writeChars );
+    for ( size_t line = 0; line < lines; line++ ) {
+        byte const *in = data + line * lineBytes;
+        char *out = buffer + line * lineChars;
+        //Encode the whole line a register at a time, the ending covers the spill
+        if ( line < fused ) {
+            for ( size_t block = 0; block < blocks; block++ ) {
+                encodeBlockAVX2( in + block * AVX2_GROUPS * MAX_NUMBER_OF_BYTES,
+                                 out + block * sizeof( __m256i ), alphabet );
+            }
+            if ( tail > 0 ) {
+                encodeBlockSSSE3( in + blocks * AVX2_GROUPS * MAX_NUMBER_OF_BYTES,
+                                  out + blocks * sizeof( __m256i ), alphabet );
+            }
+        } else {
+            encodeGroupsAVX2For( in, lineGroups, out, alphabet );
+        }
+        addLineEnding( out + lineGroups * MAX_NUMBER_OF_CHARS, ending, endingLength );
+    }
+    return lines * lineChars;
+}
+
+/**
+ * This function encodes full lines using AVX-512 VBMI instructions for one alphabet, and
+ * is what encodeLinesAVX512 and its copies run.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of chars added into the buffer
+ */
+__attribute__(( target( "avx512f,avx512bw,avx512vbmi" ), always_inline ))
+static inline size_t encodeLinesAVX512For ( byte const data[], size_t lines, size_t lineGroups,
+                                            char const ending[], size_t endingLength, char buffer[],
+                                            int alphabet )
+{
+    size_t lineBytes = lineGroups * MAX_NUMBER_OF_BYTES;
+    size_t lineChars = lineGroups * MAX_NUMBER_OF_CHARS + endingLength;
+    size_t fullBlocks = lineGroups / AVX512_GROUPS;
+    //The masks for the groups at the end of each line that don't fill a register
+    size_t tail = lineGroups % AVX512_GROUPS;
+    __mmask64 tailLoad = ( 1ULL << ( tail * MAX_NUMBER_OF_BYTES ) ) - 1;
+    __mmask64 tailStore = ( 1ULL << ( tail * MAX_NUMBER_OF_CHARS ) ) - 1;
+    for ( size_t line = 0; line < lines; line++ ) {
+        byte const *in = data + line * lineBytes;
+        char *out = buffer + line * lineChars;
+        for ( size_t block = 0; block < fullBlocks; block++ ) {
+            encodeBlockAVX512( in + block * AVX512_GROUPS * MAX_NUMBER_OF_BYTES,
+                               out + block * sizeof( __m512i ), AVX512_LOAD_MASK,
+                               AVX512_STORE_MASK, alphabet );
+        }
+        if ( tail > 0 ) {
+            encodeBlockAVX512( in + fullBlocks * AVX512_GROUPS * MAX_NUMBER_OF_BYTES,
+                               out + fullBlocks * sizeof( __m512i ), tailLoad, tailStore,
+                               alphabet );
+        }
+        addLineEnding( out + lineGroups * MAX_NUMBER_OF_CHARS, ending, endingLength );
+    }
+    return lines * lineChars;
+}
+
+/**
+ * This function gives a mask of the chars in a 16 byte register that are between two
+ * chars, including them.
+ * @param in The register with 16 chars
+ * @param first The first char of the range
+ * @param last The last char of the range
+ * @return __m128i The register with 0xFF for each char in the range
+ */
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i inRangeSSSE3 ( __m128i in, char first, char last )
+{
+    return _mm_andnot_si128( _mm_cmpgt_epi8( _mm_set1_epi8( first ), in ),
+                             _mm_cmpgt_epi8( _mm_set1_epi8( last + 1 ), in ) );
+}
+
+/**
+ * This function checks the chars in a 16 byte register and turns them into their 6-bit
+ * values for an alphabet other than the standard one. Each char is compared against the
+ * ranges A-Z, a-z and 0-9 and the last two chars of the alphabet, and gets the offset of
+ * the range it is in.
+ * @param in The register with 16 chars
+ * @param values The register that will get the 16 6-bit values
+ * @param alphabet The index of the alphabet, a constant so the chars compared are too
+ * @return true If all the chars are in the alphabet
+ * @return false If any of the chars aren't in the alphabet
+ */
+__attribute__(( target( "ssse3" ) ))
+static inline bool rangeValuesSSSE3 ( __m128i in, __m128i *values, int alphabet )
+{
+    __m128i upper = inRangeSSSE3( in, 'A', 'Z' );
+    __m128i lower = inRangeSSSE3( in, 'a', 'z' );
+    __m128i digit = inRangeSSSE3( in, '0', '9' );
+    __m128i last = _mm_cmpeq_epi8( in, _mm_set1_epi8( ALPHABET_CHAR_62( alphabet ) ) );
+    __m128i end = _mm_cmpeq_epi8( in, _mm_set1_epi8( ALPHABET_CHAR_63( alphabet ) ) );
+    __m128i valid = _mm_or_si128( _mm_or_si128( upper, lower ),
+                                  _mm_or_si128( digit, _mm_or_si128( last, end ) ) );
+    if ( _mm_movemask_epi8( valid ) != 0xFFFF ) {
+        return false;
+    }
+    //Each char is only in one range, so the offsets of the ranges can be put together
+    __m128i offsets = _mm_or_si128(
+                      _mm_or_si128( _mm_and_si128( upper, _mm_set1_epi8( -'A' ) ),
+                                    _mm_and_si128( lower, _mm_set1_epi8( 26 - 'a' ) ) ),
+                      _mm_or_si128( _mm_and_si128( digit, _mm_set1_epi8( 52 - '0' ) ),
+                      _mm_or_si128( _mm_and_si128( last, _mm_set1_epi8(
+                                                   62 - ALPHABET_CHAR_62( alphabet ) ) ),
+                                    _mm_and_si128( end, _mm_set1_epi8(
+                                                   63 - ALPHABET_CHAR_63( alphabet ) ) ) ) ) );
+    *values = _mm_add_epi8( in, offsets );
+    return true;
+}
+
+/**
+ * This function checks the chars in a 16 byte register and turns them into their 6-bit
+ * values. Each char is split into its high and low half, and the two halves are looked
+ * up in tables whose entries only have a bit in common if the char isn't valid.
+ * The tables only work for the standard alphabet, so the other alphabets check the
+ * ranges of their chars instead.
+ * @param in The register with 16 chars
+ * @param values The register that will get the 16 6-bit values
+ * @param alphabet The index of the alphabet
+ * @return true If all the chars are in the alphabet
+ * @return false If any of the chars aren't in the alphabet
+ */
+__attribute__(( target( "ssse3" ) ))
+static inline bool valuesSSSE3 ( __m128i in, __m128i *values, int alphabet )
+{
+    if ( alphabet != STANDARD_ALPHABET ) {
+        return rangeValuesSSSE3( in, values, alphabet );
+    }
+    __m128i lowTable = _mm_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+    __m128i highTable = _mm_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                       0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+    //The offset that turns the chars for each high half back into their values
+    __m128i offsets = _mm_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71,
+                                     0, 0, 0, 0, 0, 0, 0, 0 );
+    __m128i slash = _mm_set1_epi8( '/' );
+    //Split the chars into their high and low halves
+    __m128i high = _mm_and_si128( _mm_srli_epi32( in, SHIFT_VALUE_FOUR ), slash );
+    __m128i low = _mm_and_si128( in, slash );
+    //Any char whose two halves share a bit isn't in the alphabet
+    __m128i invalid = _mm_and_si128( _mm_shuffle_epi8( lowTable, low ),
+                                     _mm_shuffle_epi8( highTable, high ) );
+    if ( _mm_movemask_epi8( _mm_cmpgt_epi8( invalid, _mm_setzero_si128() ) ) ) {
+        return false;
+    }
+    //The slash shares its high half with the plus so it uses the entry before it
+    __m128i range = _mm_add_epi8( _mm_cmpeq_epi8( in, slash ), high );
+    *values = _mm_add_epi8( in, _mm_shuffle_epi8( offsets, range ) );
+    return true;
+}
+
+/**
+ * This function decodes whole groups 4 at a time using SSSE3 instructions for one
+ * alphabet, and is what decodeGroupsSSSE3 and its copies run.
+ * @param data The chars that will be decoded, this should have 4 chars for each group
+ * @param groups The number of groups of 4 chars to decode
+ * @param buffer The buffer that will get 3 bytes for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of groups that were decoded
+ */
+__attribute__(( target( "ssse3" ), always_inline ))
+static inline size_t decodeGroupsSSSE3For ( char const data[], size_t groups, byte buffer[],
+                                            int alphabet )
+{
+    //Order used to put the 3 bytes of each group next to each other
+    __m128i order = _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+    size_t i = 0;
+    //Decode 4 groups at a time while a full register can be stored
+    for ( ; i + SSSE3_DECODE_SLACK <= groups; i += SSSE3_GROUPS ) {
+        __m128i values;
+        if ( !valuesSSSE3( _mm_loadu_si128( ( __m128i const * )( data + i * MAX_NUMBER_OF_CHARS ) ),
+                           &values, alphabet ) ) {
+            break;
+        }
+        //Put each pair of values together into 12 bits, and then each pair of those into 24
+        __m128i pairs = _mm_maddubs_epi16( values, _mm_set1_epi32( 0x01400140 ) );
+        __m128i bits = _mm_madd_epi16( pairs, _mm_set1_epi32( 0x00011000 ) );
+        _mm_storeu_si128( ( __m128i * )( buffer + i * MAX_NUMBER_OF_BYTES ),
+                          _mm_shuffle_epi8( bits, order ) );
+    }
+    //Decode the groups left at the end, or from the first invalid char, using the tables
+    return i + decodeGroupsScalarFor( data + i * MAX_NUMBER_OF_CHARS, groups - i,
+                                      buffer + i * MAX_NUMBER_OF_BYTES, alphabet );
+}
+
+/**
+ * This function gives a mask of the chars in a 32 byte register that are between two
+ * chars, the same way as inRangeSSSE3.
+ * @param in The register with 32 chars
+ * @param first The first char of the range
+ * @param last The last char of the range
+ * @return __m256i The register with 0xFF for each char in the range
+ */
+__attribute__(( target( "avx2" ) ))
+static inline __m256i inRangeAVX2 ( __m256i in, char first, char last )
+{
+    return _mm256_andnot_si256( _mm256_cmpgt_epi8( _mm256_set1_epi8( first ), in ),
+                                _mm256_cmpgt_epi8( _mm256_set1_epi8( last + 1 ), in ) );
+}
+
+/**
+ * This function checks the chars in a 32 byte register and turns them into their 6-bit
+ * values for an alphabet other than the standard one, the same way as rangeValuesSSSE3.
+ * @param in The register with 32 chars
+ * @param values The register that will get the 32 6-bit values
+ * @param alphabet The index of the alphabet
+ * @return true If all the chars are in the alphabet
+ * @return false If any of the chars aren't in the alphabet
+ */
+__attribute__(( target( "avx2" ) ))
+static inline bool rangeValuesAVX2 ( __m256i in, __m256i *values, int alphabet )
+{
+    __m256i upper = inRangeAVX2( in, 'A', 'Z' );
+    __m256i lower = inRangeAVX2( in, 'a', 'z' );
+    __m256i digit = inRangeAVX2( in, '0', '9' );
+    __m256i last = _mm256_cmpeq_epi8( in, _mm256_set1_epi8( ALPHABET_CHAR_62( alphabet ) ) );
+    __m256i end = _mm256_cmpeq_epi8( in, _mm256_set1_epi8( ALPHABET_CHAR_63( alphabet ) ) );
+    __m256i valid = _mm256_or_si256( _mm256_or_si256( upper, lower ),
+                                     _mm256_or_si256( digit, _mm256_or_si256( last, end ) ) );
+    if ( _mm256_movemask_epi8( valid ) != -1 ) {
+        return false;
+    }
+    __m256i offsets = _mm256_or_si256(
+                      _mm256_or_si256( _mm256_and_si256( upper, _mm256_set1_epi8( -'A' ) ),
+                                       _mm256_and_si256( lower, _mm256_set1_epi8( 26 - 'a' ) ) ),
+                      _mm256_or_si256( _mm256_and_si256( digit, _mm256_set1_epi8( 52 - '0' ) ),
+                      _mm256_or_si256( _mm256_and_si256( last, _mm256_set1_epi8(
+                                                         62 - ALPHABET_CHAR_62( alphabet ) ) ),
+                                       _mm256_and_si256( end, _mm256_set1_epi8(
+                                                         63 - ALPHABET_CHAR_63( alphabet ) ) ) ) ) );
+    *values = _mm256_add_epi8( in, offsets );
+    return true;
+}
+
+/**
+ * This function checks the chars in a 32 byte register and turns them into their 6-bit
+ * values, the same way as valuesSSSE3.
+ * @param in The register with 32 chars
+ * @param values The register that will get the 32 6-bit values
+ * @param alphabet The index of the alphabet
+ * @return true If all the chars are in the alphabet
+ * @return false If any of the chars aren't in the alphabet
+ */
+__attribute__(( target( "avx2" ) ))
+static inline bool valuesAVX2 ( __m256i in, __m256i *values, int alphabet )
+{
+    if ( alphabet != STANDARD_ALPHABET ) {
+        return rangeValuesAVX2( in, values, alphabet );
+    }
+    __m256i lowTable = _mm256_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                         0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+    __m256i highTable = _mm256_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                          0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                          0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                          0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+    __m256i offsets = _mm256_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71,
+                                        0, 0, 0, 0, 0, 0, 0, 0,
+                                        0, 16, 19, 4, -65, -65, -71, -71,
+                                        0, 0, 0, 0, 0, 0, 0, 0 );
+    __m256i slash = _mm256_set1_epi8( '/' );
+    __m256i high = _mm256_and_si256( _mm256_srli_epi32( in, SHIFT_VALUE_FOUR ), slash );
+    __m256i low = _mm256_and_si256( in, slash );
+    __m256i invalid = _mm256_and_si256( _mm256_shuffle_epi8( lowTable, low ),
+                                        _mm256_shuffle_epi8( highTable, high ) );
+    if ( !_mm256_testz_si256( invalid, invalid ) ) {
+        return false;
+    }
+    __m256i range = _mm256_add_epi8( _mm256_cmpeq_epi8( in, slash ), high );
+    *values = _mm256_add_epi8( in, _mm256_shuffle_epi8( offsets, range ) );
+    return true;
+}
+
+/**
+ * This function decodes whole groups 8 at a time using AVX2 instructions for one
+ * alphabet, and is what decodeGroupsAVX2 and its copies run.
+ * @param data The chars that will be decoded, this should have 4 chars for each group
+ * @param groups The number of groups of 4 chars to decode
+ * @param buffer The buffer that will get 3 bytes for each group
+ * @param alphabet The index of the alphabet
+ * @return size_t The number of groups that were decoded
+ */
+__attribute__(( target( "avx2" ), always_inline ))
+static inline size_t decodeGroupsAVX2For ( char const data[], size_t groups, byte buffer[],
+                                           int alphabet )
+{
+    //Order used to put the 3 bytes of each group next to each other in both halves
+    __m256i order = _mm256_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+    //Order used to move the 12 bytes from both halves next to each other
+    __m256i halves = _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 3, 7 );
+    size_t i = 0;
+    //Decode 8 groups at a time while a full register can be stored
+    for ( ; i + AVX2_DECODE_SLACK <= groups; i += AVX2_GROUPS ) {
+        __m256i values;
+        if ( !valuesAVX2( _mm256_loadu_si256( ( __m256i const * )( data + i * MAX_NUMBER_OF_CHARS ) ),
+                          &values, alphabet ) ) {
+            break;
+        }
+        __m256i pairs = _mm256_maddubs_epi16( values, _mm256_set1_epi32( 0x01400140 ) );
+        __m256i bits = _mm256_madd_epi16( pairs, _mm256_set1_epi32( 0x00011000 ) );
+        bits = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8( bits, order ), halves );
+        _mm256_storeu_si256( ( __m256i * )( buffer + i * MAX_NUMBER_OF_BYTES ), bits );
+    }
+    //Decode the groups left at the end, or from the first invalid char, using SSSE3
+    return i + decodeGroupsSSSE3For( data + i * MAX_NUMBER_OF_CHARS, groups - i,
+                                     buffer + i * MAX_NUMBER_OF_BYTES, alphabet );
+}
+
+/** Gives the number of bits set in the last 8 bits of a value, as a constant expression */
+#define BITS_SET_8( m ) ( ( ( m ) & 1 ) + ( ( m ) >> 1 & 1 ) + ( ( m ) >> 2 & 1 ) + \
+                          ( ( m ) >> 3 & 1 ) + ( ( m ) >> 4 & 1 ) + ( ( m ) >> 5 & 1 ) + \
+                          ( ( m ) >> 6 & 1 ) + ( ( m ) >> 7 & 1 ) )
+
+/**
+ * Gives the part of a pack table entry for char j of 8. If the char is kept then its
+ * position goes in the byte for the number of chars kept before it.
+ */
+#define PACK_POSITION( m, j ) ( ( ( m ) >> ( j ) & 1 ) ? ( uint64_t )( j ) << \
+                                ( SIZE_OF_BYTE * BITS_SET_8( ( m ) & ( ( 1 << ( j ) ) - 1 ) ) ) : 0 )
+
+/** Gives the pack table entry for a mask of the chars that are kept */
+#define PACK( m ) ( PACK_POSITION( m, 0 ) | PACK_POSITION( m, 1 ) | PACK_POSITION( m, 2 ) | \
+                    PACK_POSITION( m, 3 ) | PACK_POSITION( m, 4 ) | PACK_POSITION( m, 5 ) | \
+                    PACK_POSITION( m, 6 ) | PACK_POSITION( m, 7 ) )
+
+/** Builds the entries of a table for every mask of 8 chars, 4 at a time and then 256 at a time */
+#define MASKS_4( f, m ) f( m ), f( ( m ) + 1 ), f( ( m ) + 2 ), f( ( m ) + 3 )
+#define MASKS_16( f, m ) MASKS_4( f, m ), MASKS_4( f, ( m ) + 4 ), MASKS_4( f, ( m ) + 8 ), \
+                         MASKS_4( f, ( m ) + 12 )
+#define MASKS_64( f, m ) MASKS_16( f, m ), MASKS_16( f, ( m ) + 16 ), \
+                         MASKS_16( f, ( m ) + 32 ), MASKS_16( f, ( m ) + 48 )
+#define MASKS_256( f, m ) MASKS_64( f, m ), MASKS_64( f, ( m ) + 64 ), \
+                          MASKS_64( f, ( m ) + 128 ), MASKS_64( f, ( m ) + 192 )
+
+/** Mask used to get the bits for the 8 chars packed with one entry of the pack table */
+#define PACK_MASK 0xFF
+
+/** Mask with a bit for each of the 16 chars in a 16 byte register */
+#define SSSE3_SPACE_MASK 0xFFFF
+
+/**
+ * Table that gives the shuffle that packs the kept chars of 8 to the left, for each mask
+ * of the chars that are kept. Byte k of an entry is the position of the k-th kept char.
+ */
+static const uint64_t packTable[PACK_TABLE_SIZE] = { MASKS_256( PACK, 0 ) };
+
+/**
+ * Table that gives the number of chars that are kept for each mask of 8 chars, so it
+ * doesn't depend on the CPU having a popcount instruction.
+ */
+static const byte packCounts[PACK_TABLE_SIZE] = { MASKS_256( BITS_SET_8, 0 ) };
+
+/**
+ * This function is a helper function that packs the kept chars of the first 8 chars in
+ * a register to the left and stores them. All 8 chars are stored, so the buffer needs
+ * room for 8 chars, and the ones after the kept chars are written over by the next store.
+ * @param in The register with the 8 chars at the start
+ * @param keep The mask of the chars that are kept, one bit for each char
+ * @param buffer The buffer that will get the kept chars
+ * @return size_t The number of chars that were kept
+ */
+__attribute__(( target( "ssse3" ) ))
+static inline size_t packSSSE3 ( __m128i in, unsigned keep, char *buffer )
+{
+    __m128i order = _mm_cvtsi64_si128( packTable[keep] );
+    _mm_storel_epi64( ( __m128i * )buffer, _mm_shuffle_epi8( in, order ) );
+    return packCounts[keep];
+}
+
+__attribute__(( target( "ssse3" ) ))
+size_t compactSpaceSSSE3 ( char const data[], size_t length, char buffer[] )
+{
+    size_t count = 0;
+    size_t i = 0;
+    for ( ; i + SSSE3_SPACE_CHARS <= length; i += SSSE3_SPACE_CHARS ) {
+        __m128i in = _mm_loadu_si128( ( __m128i const * )( data + i ) );
+        __m128i space = _mm_or_si128( _mm_cmpeq_epi8( in, _mm_set1_epi8( ' ' ) ),
+                                      inRangeSSSE3( in, '\t', '\r' ) );
+        unsigned keep = ~_mm_movemask_epi8( space ) & SSSE3_SPACE_MASK;
+        //Store the whole register if none of it is whitespace
+        if ( keep == SSSE3_SPACE_MASK ) {
+            _mm_storeu_si128( ( __m128i * )( buffer + count ), in );
+            count += SSSE3_SPACE_CHARS;
+            continue;
+        }
+        count += packSSSE3( in, keep & PACK_MASK, buffer + count );
+        count += packSSSE3( _mm_srli_si128( in, PACK_CHARS ), keep >> PACK_CHARS,
+                            buffer + count );
+    }
+    //Copy the chars left at the end using the scalar engine
+    return count + compactSpaceScalar( data + i, length - i, buffer + count );
+}
+
+__attribute__(( target( "avx2" ) ))
+size_t compactSpaceAVX2 ( char const data[], size_t length, char buffer[] )
+{
+    size_t count = 0;
+    size_t i = 0;
+    for ( ; i + AVX2_SPACE_CHARS <= length; i += AVX2_SPACE_CHARS ) {
+        __m256i in = _mm256_loadu_si256( ( __m256i const * )( data + i ) );
+        __m256i space = _mm256_or_si256( _mm256_cmpeq_epi8( in, _mm256_set1_epi8( ' ' ) ),
+                                         inRangeAVX2( in, '\t', '\r' ) );
+        uint32_t keep = ~( uint32_t )_mm256_movemask_epi8( space );
+        //Store the whole register if none of it is whitespace
+        if ( keep == UINT32_MAX ) {
+            _mm256_storeu_si256( ( __m256i * )( buffer + count ), in );
+            count += AVX2_SPACE_CHARS;
+            continue;
+        }
+        //Otherwise pack each 8 chars, going through the two halves of the register
+        __m128i low = _mm256_castsi256_si128( in );
+        __m128i high = _mm256_extracti128_si256( in, 1 );
+        count += packSSSE3( low, keep & PACK_MASK, buffer + count );
+        count += packSSSE3( _mm_srli_si128( low, PACK_CHARS ), keep >> PACK_CHARS & PACK_MASK,
+                            buffer + count );
+        count += packSSSE3( high, keep >> ( PACK_CHARS * 2 ) & PACK_MASK, buffer + count );
+        count += packSSSE3( _mm_srli_si128( high, PACK_CHARS ), keep >> ( PACK_CHARS * 3 ),
+                            buffer + count );
+    }
+    //Copy the chars left at the end using SSSE3
+    return count + compactSpaceSSSE3( data + i, length - i, buffer + count );
+}
+
+/**
+ * Defines the SIMD engines for one alphabet, each one running its kernel with the
+ * alphabet as a constant. The standard alphabet has no suffix, so its functions keep
+ * their names.
+ */
+#define SIMD_ENGINES( suffix, alphabet ) \
+__attribute__(( target( "ssse3" ) )) \
+size_t encodeGroupsSSSE3##suffix ( byte const data[], size_t groups, char buffer[] ) \
+{ \
+    return encodeGroupsSSSE3For( data, groups, buffer, alphabet ); \
+} \
+__attribute__(( target( "avx2" ) )) \
+size_t encodeGroupsAVX2##suffix ( byte const data[], size_t groups, char buffer[] ) \
+{ \
+    return encodeGroupsAVX2For( data, groups, buffer, alphabet ); \
+} \
+__attribute__(( target( "avx512f,avx512bw,avx512vbmi" ) )) \
+size_t encodeGroupsAVX512##suffix ( byte const data[], size_t groups, char buffer[] ) \
+{ \
+    return encodeGroupsAVX512For( data, groups, buffer, alphabet ); \
+} \
+__attribute__(( target( "ssse3" ) )) \
+size_t encodeLinesSSSE3##suffix ( byte const data[], size_t lines, size_t lineGroups, \
+                                  char const ending[], size_t endingLength, char buffer[] ) \
+{ \
+    return encodeLinesSSSE3For( data, lines, lineGroups, ending, endingLength, buffer, \
+                                alphabet ); \
+} \
+__attribute__(( target( "avx2" ) )) \
+size_t encodeLinesAVX2##suffix ( byte const data[], size_t lines, size_t lineGroups, \
+                                 char const ending[], size_t endingLength, char buffer[] ) \
+{ \
+    return encodeLinesAVX2For( data, lines, lineGroups, ending, endingLength, buffer, \
+                               alphabet ); \
+} \
+__attribute__(( target( "avx512f,avx512bw,avx512vbmi" ) )) \
+size_t encodeLinesAVX512##suffix ( byte const data[], size_t lines, size_t lineGroups, \
+                                   char const ending[], size_t endingLength, char buffer[] ) \
+{ \
+    return encodeLinesAVX512For( data, lines, lineGroups, ending, endingLength, buffer, \
+                                 alphabet ); \
+} \
+__attribute__(( target( "ssse3" ) )) \
+size_t decodeGroupsSSSE3##suffix ( char const data[], size_t groups, byte buffer[] ) \
+{ \
+    return decodeGroupsSSSE3For( data, groups, buffer, alphabet ); \
+} \
+__attribute__(( target( "avx2" ) )) \
+size_t decodeGroupsAVX2##suffix ( char const data[], size_t groups, byte buffer[] ) \
+{ \
+    return decodeGroupsAVX2For( data, groups, buffer, alphabet ); \
+}
+
+SIMD_ENGINES( , STANDARD_ALPHABET )
+SIMD_ENGINES( Url, URL_ALPHABET )
+SIMD_ENGINES( Imap, IMAP_ALPHABET )
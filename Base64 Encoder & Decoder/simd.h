@@ -0,0 +1,232 @@
+/**
+ * @file simd.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the simd.c component. In this file it contains all the
+ * constants and protypes used in simd.c
+ */
+
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include codec to get the byte type and the scalar engine used for leftover groups.
+#include "codec.h"
+
+/** Number of groups encoded at a time in a 16 byte register */
+#define SSSE3_GROUPS 4
+
+/** Number of groups that need to be left for a 16 byte load to stay inside the input */
+#define SSSE3_ENCODE_SLACK 6
+
+/** Number of groups encoded at a time in a 32 byte register */
+#define AVX2_GROUPS 8
+
+/** Number of groups that need to be left for two 16 byte loads to stay inside the input */
+#define AVX2_ENCODE_SLACK 10
+
+/** Number of groups encoded at a time in a 64 byte register */
+#define AVX512_GROUPS 16
+
+/** Number of groups that need to be left for a 16 byte store to stay inside the output */
+#define SSSE3_DECODE_SLACK 6
+
+/** Number of groups that need to be left for a 32 byte store to stay inside the output */
+#define AVX2_DECODE_SLACK 11
+
+/** Number of chars checked for whitespace at a time in a 16 byte register */
+#define SSSE3_SPACE_CHARS 16
+
+/** Number of chars checked for whitespace at a time in a 32 byte register */
+#define AVX2_SPACE_CHARS 32
+
+/** Number of chars packed together with each entry of the pack table */
+#define PACK_CHARS 8
+
+/** Number of entries in the pack table, one for each way of keeping 8 chars */
+#define PACK_TABLE_SIZE 256
+
+/** Mask used to load only the 48 bytes of the groups into a 64 byte register */
+#define AVX512_LOAD_MASK 0x0000FFFFFFFFFFFFULL
+
+/** Mask used to store all 64 chars of a 64 byte register */
+#define AVX512_STORE_MASK 0xFFFFFFFFFFFFFFFFULL
+
+/**
+ * This function checks if the CPU supports the SSSE3 instructions.
+ * @return true If the SSSE3 engine can be used
+ * @return false If the SSSE3 engine can't be used
+ */
+bool ssse3Supported ();
+
+/**
+ * This function checks if the CPU supports the AVX2 instructions.
+ * @return true If the AVX2 engine can be used
+ * @return false If the AVX2 engine can't be used
+ */
+bool avx2Supported ();
+
+/**
+ * This function checks if the CPU supports the AVX-512 VBMI instructions.
+ * @return true If the AVX-512 engine can be used
+ * @return false If the AVX-512 engine can't be used
+ */
+bool avx512Supported ();
+
+/**
+ * This function encodes whole groups of 3 bytes into groups of 4 chars, 4 groups at a
+ * time using SSSE3 instructions. The groups left at the end are encoded by the scalar
+ * engine.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeGroupsSSSE3 ( byte const data[], size_t groups, char buffer[] );
+
+/**
+ * This function encodes whole groups of 3 bytes into groups of 4 chars, 8 groups at a
+ * time using AVX2 instructions. The groups left at the end are encoded by the scalar
+ * engine.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeGroupsAVX2 ( byte const data[], size_t groups, char buffer[] );
+
+/**
+ * This function encodes whole groups of 3 bytes into groups of 4 chars, 16 groups at a
+ * time using AVX-512 VBMI instructions. The groups left at the end are encoded by the
+ * scalar engine.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param groups The number of groups of 3 bytes to encode
+ * @param buffer The buffer that will get 4 chars for each group
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeGroupsAVX512 ( byte const data[], size_t groups, char buffer[] );
+
+/**
+ * This function encodes full lines of groups, 4 groups at a time using SSSE3
+ * instructions, and adds the line ending after each line. The last register of a line
+ * spills into the start of the next line, which is fine since that line is written
+ * afterwards. The last few lines, where the spill would go past the end of the input or
+ * the buffer, are encoded by encodeGroupsSSSE3 instead.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeLinesSSSE3 ( byte const data[], size_t lines, size_t lineGroups,
+                          char const ending[], size_t endingLength, char buffer[] );
+
+/**
+ * This function encodes full lines of groups, 8 groups at a time using AVX2
+ * instructions, and adds the line ending after each line. The spill at the end of each
+ * line is handled the same way as in encodeLinesSSSE3.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeLinesAVX2 ( byte const data[], size_t lines, size_t lineGroups,
+                         char const ending[], size_t endingLength, char buffer[] );
+
+/**
+ * This function encodes full lines of groups, 16 groups at a time using AVX-512 VBMI
+ * instructions, and adds the line ending after each line. The groups at the end of each
+ * line are loaded and stored with a mask, so nothing outside the line is touched.
+ * @param data The bytes that will be encoded, this should have 3 bytes for each group
+ * @param lines The number of lines to encode
+ * @param lineGroups The number of groups in each line
+ * @param ending The chars added at the end of each line
+ * @param endingLength The number of chars in the line ending
+ * @param buffer The buffer that will get the lines of chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t encodeLinesAVX512 ( byte const data[], size_t lines, size_t lineGroups,
+                           char const ending[], size_t endingLength, char buffer[] );
+
+/**
+ * This function decodes whole groups of 4 chars into groups of 3 bytes, 4 groups at a
+ * time using SSSE3 instructions. The chars are checked while they are converted, and as
+ * soon as a register has a char that isn't in the alphabet the rest of the groups are
+ * handed to the scalar engine, which stops at the exact group with that char.
+ * @param data The chars that will be decoded, this should have 4 chars for each group
+ * @param groups The number of groups of 4 chars to decode
+ * @param buffer The buffer that will get 3 bytes for each group
+ * @return size_t The number of groups that were decoded
+ */
+size_t decodeGroupsSSSE3 ( char const data[], size_t groups, byte buffer[] );
+
+/**
+ * This function decodes whole groups of 4 chars into groups of 3 bytes, 8 groups at a
+ * time using AVX2 instructions. The chars are checked the same way as in
+ * decodeGroupsSSSE3.
+ * @param data The chars that will be decoded, this should have 4 chars for each group
+ * @param groups The number of groups of 4 chars to decode
+ * @param buffer The buffer that will get 3 bytes for each group
+ * @return size_t The number of groups that were decoded
+ */
+size_t decodeGroupsAVX2 ( char const data[], size_t groups, byte buffer[] );
+
+/**
+ * This function copies the chars that aren't whitespace into the buffer, 16 chars at a
+ * time using SSSE3 instructions. The whitespace in a register is found with compares,
+ * and each half of the register is packed to the left with a shuffle looked up from
+ * which of its 8 chars are kept. A register without whitespace is stored as it is. The
+ * chars left at the end are copied by the scalar engine.
+ * @param data The chars that will be copied
+ * @param length The number of chars
+ * @param buffer The buffer that will get the chars that aren't whitespace, this needs
+ * room for length chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t compactSpaceSSSE3 ( char const data[], size_t length, char buffer[] );
+
+/**
+ * This function copies the chars that aren't whitespace into the buffer, 32 chars at a
+ * time using AVX2 instructions. The whitespace is found and packed out the same way as
+ * in compactSpaceSSSE3, 8 chars at a time.
+ * @param data The chars that will be copied
+ * @param length The number of chars
+ * @param buffer The buffer that will get the chars that aren't whitespace, this needs
+ * room for length chars
+ * @return size_t The number of chars added into the buffer
+ */
+size_t compactSpaceAVX2 ( char const data[], size_t length, char buffer[] );
+
+/**
+ * Declares the SIMD engines for an alphabet other than the standard one. The functions
+ * have the alphabet name at the end, like encodeGroupsAVX2Url, and work the same way as
+ * the functions for the standard alphabet.
+ */
+#define SIMD_ENGINE_PROTOTYPES( suffix ) \
+    size_t encodeGroupsSSSE3##suffix ( byte const data[], size_t groups, char buffer[] ); \
+    size_t encodeGroupsAVX2##suffix ( byte const data[], size_t groups, char buffer[] ); \
+    size_t encodeGroupsAVX512##suffix ( byte const data[], size_t groups, char buffer[] ); \
+    size_t encodeLinesSSSE3##suffix ( byte const data[], size_t lines, size_t lineGroups, \
+                                      char const ending[], size_t endingLength, \
+                                      char buffer[] ); \
+    size_t encodeLinesAVX2##suffix ( byte const data[], size_t lines, size_t lineGroups, \
+                                     char const ending[], size_t endingLength, \
+                                     char buffer[] ); \
+    size_t encodeLinesAVX512##suffix ( byte const data[], size_t lines, size_t lineGroups, \
+                                       char const ending[], size_t endingLength, \
+                                       char buffer[] ); \
+    size_t decodeGroupsSSSE3##suffix ( char const data[], size_t groups, byte buffer[] ); \
+    size_t decodeGroupsAVX2##suffix ( char const data[], size_t groups, byte buffer[] );
+
+SIMD_ENGINE_PROTOTYPES( Url )
+SIMD_ENGINE_PROTOTYPES( Imap )
+
+#endif
@@ -10,6 +10,7 @@
  */
 
 #include "state24.h"
+#include "codec.h"
 
 void initState ( State24 *state )
 {
@@ -24,13 +25,8 @@ void initState ( State24 *state )
 
 bool validChar ( char ch )
 {
-    //Returns true if any of these chars are used
-    if( ( ch >= 'A' && ch <= 'Z' ) || ( ch >= 'a' && ch <= 'z' ) || 
-    ( ch >= '/' && ch <= '9') || ch == '+' ) {
-        return true;
-    }
-    //Return false if not valid
-    return false;
+    //Returns true if the char has a value in the decode table of the alphabet
+    return decodeTable[selectedAlphabet()][( byte )ch] != INVALID_VALUE;
 }
 
 void addByte ( State24 *state, byte b)
@@ -44,30 +40,13 @@ void addByte ( State24 *state, byte b)
 
 void addChar ( State24 *state, char ch)
 {
-    //Have a table containing all the different chars avaiable
-    char base64Table[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
-                        'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
-                        'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
-                        'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
-                        'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
-                        'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
-                        'w', 'x', 'y', 'z', '0', '1', '2', '3',
-                        '4', '5', '6', '7', '8', '9', '+', '/'};
-
     //Create a bitValue that will be used to store in the data array
     unsigned char bitValue = 0x0;
     //Check if the ch being added is valid
     if ( validChar( ch ) ) {
 
-        //Iterate through until the ch matches with one of the chars in the table
-        for ( int i = 0; i < BASE64; i++ ) {
-            if ( ch == base64Table[i] ) {
-                //Break out of loop when they match
-                break;
-            }
-        //Increment the bitValue if the chars don't match
-        bitValue++;
-        }
+        //Look up the value of the ch in the decode table
+        bitValue = decodeTable[selectedAlphabet()][( byte )ch];
         //Shift to the left by two to get the 6 bits we need
         bitValue = bitValue << SHIFT_VALUE_TWO;
 
@@ -134,17 +113,8 @@ int getBytes ( State24 *state, byte buffer[] )
 
 int getChars ( State24 *state, char buffer[] )
 {
-    //Have a table containing all the different chars avaiable
-    char base64Table[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
-                        'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
-                        'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
-                        'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
-                        'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
-                        'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
-                        'w', 'x', 'y', 'z', '0', '1', '2', '3',
-                        '4', '5', '6', '7', '8', '9', '+', '/'};
-
-    //Get number of characters that will be returned
+    //Get the encode table of the alphabet and the number of characters that will be returned
+    char const *table = encodeTable[selectedAlphabet()];
     int numberOfChars = state->byteCount + 1;
     //Loop enough times to get the value of each character
     for ( int i = 0; i < numberOfChars; i++ ) {
@@ -179,18 +149,8 @@ int getChars ( State24 *state, char buffer[] )
             bitFieldFromByte = ( state->data[i -1] & mask );
         }
 
-        //Create a value that will be used to find the bitValue of a char
-        unsigned char findChar = 0x0;
-        //Iterate through all the chars in the table until a value is found
-        for( int j = 0; j < BASE64; j++ ) {
-            //If the values match then break out of the loop and add the char to the buffer
-            if ( findChar == bitFieldFromByte ) {
-                buffer[i] = base64Table[j];
-                break;
-            }
-            //Increment findChar value if they don't match
-            findChar++;
-        }
+        //Look up the char for the bitField in the encode table
+        buffer[i] = table[bitFieldFromByte];
     }
     //Reinitialize the State24
     initState( state );
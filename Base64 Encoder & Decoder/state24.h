@@ -91,7 +91,7 @@ void initState ( State24 *state );
 
 /**
  * This function takes a char and makes sure that is a valid char in the Base64
- * encoding. If not then this fucntion will return false.
+ * alphabet that has been picked. If not then this fucntion will return false.
  * @param ch The char that will be checked to see if it's valid. 
  * @return true If the char is a valid char
  * @return false If the char is not valid
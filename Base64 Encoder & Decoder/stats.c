@@ -0,0 +1,87 @@
+/**
+ * @file stats.c
+ * @author Daniel Avisse (djavisse)
+ * This is the stats component. This component is used by --stats to time each phase of
+ * an encode or decode, using both the wall clock and the CPU time of the whole process,
+ * and to print the results along with the bytes in and out, the growth of the
+ * filebuffers and the peak resident memory. When the stats aren't enabled none of the
+ * clocks are read.
+ */
+
+#include <time.h>
+#include <sys/resource.h>
+#include "stats.h"
+#include "filebuffer.h"
+
+/** Number of nanoseconds in a second */
+#define NANOSECONDS 1000000000.0
+
+/** Number of bytes in the kilobytes given by getrusage */
+#define KILOBYTE 1024
+
+/** The names of the phases in the JSON output */
+static char const *const phaseNames[NUMBER_OF_PHASES] = {
+    "setup", "read", "convert", "write", "finish"
+};
+
+/**
+ * This function is a helper function that reads a clock in seconds.
+ * @param clock The clock being read
+ * @return double The time in seconds
+ */
+static double readClock ( clockid_t clock )
+{
+    struct timespec time;
+    clock_gettime( clock, &time );
+    return time.tv_sec + time.tv_nsec / NANOSECONDS;
+}
+
+void startStats ( Stats *stats, bool enabled )
+{
+    memset( stats, 0, sizeof( Stats ) );
+    stats->enabled = enabled;
+    stats->phase = PHASE_SETUP;
+    if ( enabled ) {
+        stats->wallStart = readClock( CLOCK_MONOTONIC );
+        stats->cpuStart = readClock( CLOCK_PROCESS_CPUTIME_ID );
+    }
+}
+
+void switchPhase ( Stats *stats, Phase phase )
+{
+    if ( !stats->enabled ) {
+        return;
+    }
+    //Add the time since the phase started to the phase, and start the next one
+    double wall = readClock( CLOCK_MONOTONIC );
+    double cpu = readClock( CLOCK_PROCESS_CPUTIME_ID );
+    stats->wall[stats->phase] += wall - stats->wallStart;
+    stats->cpu[stats->phase] += cpu - stats->cpuStart;
+    stats->phase = phase;
+    stats->wallStart = wall;
+    stats->cpuStart = cpu;
+}
+
+void printStats ( Stats *stats, char const *program )
+{
+    if ( !stats->enabled ) {
+        return;
+    }
+    switchPhase( stats, stats->phase );
+    double wall = 0;
+    double cpu = 0;
+    fprintf( stderr, "{\"program\":\"%s\",\"phases\":{", program );
+    for ( int i = 0; i < NUMBER_OF_PHASES; i++ ) {
+        fprintf( stderr, "%s\"%s\":{\"wall_seconds\":%.6f,\"cpu_seconds\":%.6f}",
+                 i > 0 ? "," : "", phaseNames[i], stats->wall[i], stats->cpu[i] );
+        wall += stats->wall[i];
+        cpu += stats->cpu[i];
+    }
+    //Peak resident memory, getrusage gives this in kilobytes on Linux
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    fprintf( stderr, "},\"wall_seconds\":%.6f,\"cpu_seconds\":%.6f,\"bytes_in\":%zu,"
+             "\"bytes_out\":%zu,\"reallocations\":%zu,\"realloc_bytes_copied\":%zu,"
+             "\"peak_rss_bytes\":%zu}\n", wall, cpu, stats->bytesIn, stats->bytesOut,
+             fileBufferGrowths, fileBufferBytesCopied, ( size_t )usage.ru_maxrss * KILOBYTE );
+}
@@ -0,0 +1,98 @@
+/**
+ * @file stats.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the stats.c component. In this file it contains all the
+ * constants, structs and protypes used in stats.c
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/** The command used to print the stats of a run */
+#define STATS_COMMAND "--stats"
+
+/**
+ * This is the Phase enum. It lists the parts of a run that are timed on their own.
+ */
+typedef enum {
+  /** Opening and mapping the files. */
+  PHASE_SETUP,
+
+  /** Reading chunks of the input file when it isn't mapped. */
+  PHASE_READ,
+
+  /** Encoding or decoding, this includes reading a mapped input file. */
+  PHASE_CONVERT,
+
+  /** Writing chunks of the output file when it isn't mapped. */
+  PHASE_WRITE,
+
+  /** Finishing the output and closing the files. */
+  PHASE_FINISH,
+
+  /** The number of phases. */
+  NUMBER_OF_PHASES
+} Phase;
+
+/**
+ * This is the Stats struct. It holds the time used by each phase of a run and the
+ * number of bytes read and written.
+ */
+typedef struct {
+  /** True if the stats are being kept, when this is false nothing else is used. */
+  bool enabled;
+
+  /** The phase the run is in. */
+  Phase phase;
+
+  /** The wall time when the phase started, in seconds. */
+  double wallStart;
+
+  /** The CPU time used by the process when the phase started, in seconds. */
+  double cpuStart;
+
+  /** The wall time used by each phase, in seconds. */
+  double wall[NUMBER_OF_PHASES];
+
+  /** The CPU time used by each phase, in seconds. */
+  double cpu[NUMBER_OF_PHASES];
+
+  /** The number of bytes read from the input files. */
+  size_t bytesIn;
+
+  /** The number of bytes written to the output files. */
+  size_t bytesOut;
+} Stats;
+
+/**
+ * This function starts keeping stats, starting with the setup phase. If the stats
+ * aren't enabled then none of the other functions do anything.
+ * @param stats The stats being started
+ * @param enabled True if the stats should be kept
+ */
+void startStats ( Stats *stats, bool enabled );
+
+/**
+ * This function adds the time since the last phase started to that phase, and starts
+ * the next one. This does nothing if the stats aren't enabled, so it is cheap to call
+ * for every chunk.
+ * @param stats The stats being kept
+ * @param phase The phase being started
+ */
+void switchPhase ( Stats *stats, Phase phase );
+
+/**
+ * This function ends the current phase and prints the stats as one JSON object on
+ * stderr. This includes the time used by each phase, the bytes in and out, the growth
+ * of the filebuffers and the peak resident memory of the process.
+ * @param stats The stats being printed
+ * @param program The name of the program the stats are for
+ */
+void printStats ( Stats *stats, char const *program );
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file stream.c
+ * @author Daniel Avisse (djavisse)
+ * This is the stream component. This component lets the encode and decode programs use
+ * "-" for the standard input and the standard output, so they can be put in the middle
+ * of a pipeline without going through temporary files. Pipes are made bigger so the
+ * bytes move through them in fewer system calls, and a whole converted chunk fits in
+ * the pipe at once. Writes to a pipe wait while it is full instead of polling it, so a
+ * slow reader doesn't use any CPU time and a reader that goes away stops the program.
+ */
+
+#include "stream.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * This function is a helper function that makes a pipe PIPE_SIZE bytes. If the pipe
+ * can't be made that big, which happens when the limit for pipes is lower, then it is
+ * left the size it was.
+ * @param fd The file descriptor that might be a pipe
+ * @return size_t The number of bytes the pipe can hold, or zero if it isn't a pipe
+ */
+static size_t growPipe ( int fd )
+{
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || !S_ISFIFO( info.st_mode ) ) {
+        return 0;
+    }
+    fcntl( fd, F_SETPIPE_SZ, PIPE_SIZE );
+    int size = fcntl( fd, F_GETPIPE_SZ );
+    return size > 0 ? size : 0;
+}
+
+bool isStandardStream ( char const *filename )
+{
+    return strcmp( filename, STANDARD_STREAM ) == 0;
+}
+
+FILE *openStream ( char const *filename, char const *mode )
+{
+    FILE *stream = stdin;
+    if ( !isStandardStream( filename ) ) {
+        stream = fopen( filename, mode );
+    } else if ( mode[0] != 'r' ) {
+        stream = stdout;
+    }
+    if ( stream ) {
+        growPipe( fileno( stream ) );
+    }
+    return stream;
+}
+
+/**
+ * This function is a helper function that gets the info of a file, or of the standard
+ * input or output for STANDARD_STREAM.
+ * @param filename The path of the file, or STANDARD_STREAM
+ * @param fd The file descriptor used for STANDARD_STREAM
+ * @param info Gets the info of the file
+ * @return true If the info was found
+ * @return false If the file doesn't exist or can't be looked at
+ */
+static bool streamInfo ( char const *filename, int fd, struct stat *info )
+{
+    return isStandardStream( filename ) ? fstat( fd, info ) == 0 : stat( filename, info ) == 0;
+}
+
+bool sameStream ( char const *inputfile, char const *outputfile )
+{
+    struct stat input;
+    struct stat output;
+    //Only regular files are emptied when they are opened, so devices like /dev/null can
+    //be both
+    return streamInfo( inputfile, STDIN_FILENO, &input ) &&
+           streamInfo( outputfile, STDOUT_FILENO, &output ) && S_ISREG( input.st_mode ) &&
+           S_ISREG( output.st_mode ) && input.st_dev == output.st_dev &&
+           input.st_ino == output.st_ino;
+}
+
+void removeStream ( char const *filename )
+{
+    if ( !isStandardStream( filename ) ) {
+        remove( filename );
+    }
+}
+
+void initWriter ( StreamWriter *writer, FILE *stream, size_t bufferSize )
+{
+    growPipe( fileno( stream ) );
+    writer->stream = stream;
+    writer->bufferSize = bufferSize;
+    writer->buffer = ( byte * )malloc( bufferSize );
+}
+
+void *writerBuffer ( StreamWriter *writer )
+{
+    return writer->buffer;
+}
+
+void writeStream ( StreamWriter *writer, void const *data, size_t length )
+{
+    if ( fwrite( data, sizeof( byte ), length, writer->stream ) != length ) {
+        perror( "fwrite" );
+        exit( EXIT_FAILURE );
+    }
+}
+
+void freeWriter ( StreamWriter *writer )
+{
+    free( writer->buffer );
+}
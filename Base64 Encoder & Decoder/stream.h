@@ -0,0 +1,114 @@
+/**
+ * @file stream.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the stream.c component. In this file it contains all the
+ * constants, structs and protypes used in stream.c
+ */
+
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include filebuffer to get the byte type.
+#include "filebuffer.h"
+
+/** The file name used for the standard input or the standard output */
+#define STANDARD_STREAM "-"
+
+/** The error for an output file that is the same file as the input file */
+#define SAME_FILE_ERROR "The output file is the input file"
+
+/** The size pipes are made when reading from them or writing to them */
+#define PIPE_SIZE 1048576
+
+/**
+ * This is the StreamWriter struct. It holds the buffer that each chunk is converted into
+ * before it is written to an output stream.
+ */
+typedef struct {
+  /** The output stream being written to. */
+  FILE *stream;
+
+  /** The buffer each chunk is converted into. */
+  byte *buffer;
+
+  /** The number of bytes in the buffer. */
+  size_t bufferSize;
+} StreamWriter;
+
+/**
+ * This function checks if a file name is the one used for the standard input or the
+ * standard output.
+ * @param filename The file name being checked
+ * @return true If the file name is STANDARD_STREAM
+ * @return false If the file name is the path of a file
+ */
+bool isStandardStream ( char const *filename );
+
+/**
+ * This function opens a file the same way as fopen, except that STANDARD_STREAM opens the
+ * standard input if the mode is for reading and the standard output otherwise. If the
+ * stream is a pipe then the pipe is made PIPE_SIZE bytes, so fewer system calls are
+ * needed to move the bytes through it.
+ * @param filename The path of the file, or STANDARD_STREAM
+ * @param mode The mode passed to fopen
+ * @return FILE* The stream, or NULL if the file couldn't be opened
+ */
+FILE *openStream ( char const *filename, char const *mode );
+
+/**
+ * This function checks if the input file and the output file are the same regular file,
+ * even through a link or STANDARD_STREAM. Opening the output file empties it, so it has
+ * to be checked before the input file is read.
+ * @param inputfile The path of the input file, or STANDARD_STREAM
+ * @param outputfile The path of the output file, or STANDARD_STREAM
+ * @return true If both are the same regular file
+ * @return false If they aren't, or the output file doesn't exist yet
+ */
+bool sameStream ( char const *inputfile, char const *outputfile );
+
+/**
+ * This function removes an output file that was only partly written. The standard
+ * output can't be removed, so nothing is done for STANDARD_STREAM.
+ * @param filename The path of the file, or STANDARD_STREAM
+ */
+void removeStream ( char const *filename );
+
+/**
+ * This function starts a StreamWriter for an output stream. If the stream is a pipe then
+ * it is made PIPE_SIZE bytes, so a chunk can be written to it in one go.
+ * @param writer The StreamWriter being started
+ * @param stream The output stream
+ * @param bufferSize The number of bytes in each buffer
+ */
+void initWriter ( StreamWriter *writer, FILE *stream, size_t bufferSize );
+
+/**
+ * This function hands out the buffer a chunk is converted into. The buffer is the same
+ * every time, so its bytes have to be written before the next chunk is converted.
+ * @param writer The StreamWriter
+ * @return void* The buffer, which has room for bufferSize bytes
+ */
+void *writerBuffer ( StreamWriter *writer );
+
+/**
+ * This function writes bytes to the output stream. When the output is a pipe this waits
+ * while the pipe is full, and if the pipe has no reader left the program is stopped by
+ * SIGPIPE. The program exits with an error message if the bytes can't be written.
+ * @param writer The StreamWriter
+ * @param data The bytes being written
+ * @param length The number of bytes
+ */
+void writeStream ( StreamWriter *writer, void const *data, size_t length );
+
+/**
+ * This function frees the buffer of a StreamWriter. The stream itself isn't closed.
+ * @param writer The StreamWriter being freed
+ */
+void freeWriter ( StreamWriter *writer );
+
+#endif
@@ -118,53 +118,536 @@ checkEmpty() {
   return 0
 }
 
-# Test the encode program.
+# Test the encode program.  The output should match the expected file, or
+# not be made if that file doesn't exist, and stderr should match the
+# expected stderr file, or be empty if there isn't one.
 testEncode() {
+  INPUT=$1
+  EXPECTED=$2
+  ESTATUS=$3
+  ESTDERR=$4
+
+  echo "Encode test $INPUT"
+  rm -f output.txt stdout.txt stderr.txt
+
+  echo "   ./encode ${args[@]} $INPUT output.txt > stdout.txt 2> stderr.txt"
+  ./encode ${args[@]} $INPUT output.txt > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus "$ESTATUS" "$ASTATUS" ||
+     ! checkFileOrMissing "Encoded output" "$EXPECTED" "output.txt" ||
+     ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkFileOrEmpty "Stderr output" "$ESTDERR" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  echo "Encode test $INPUT PASS"
+  return 0
+}
+
+# Test appending onto an encoded file.  The first bytes of the original file
+# are encoded, the rest are appended, and the output should match encoding the
+# whole file.
+testAppend() {
+  INPUT=$1
+  EXPECTED=$2
+  SPLIT=$3
+
+  echo "Append test $INPUT $SPLIT"
+  rm -f output.txt range.bin stdout.txt stderr.txt
+  head -c $SPLIT $INPUT > range.bin
+  ./encode ${args[@]} range.bin output.txt
+  tail -c +$((SPLIT + 1)) $INPUT > range.bin
+
+  echo "   ./encode ${args[@]} --append range.bin output.txt > stdout.txt 2> stderr.txt"
+  ./encode ${args[@]} --append range.bin output.txt > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 0 "$ASTATUS" ||
+     ! checkFile "Encoded output" "$EXPECTED" "output.txt" ||
+     ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkEmpty "Stderr output" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  rm -f range.bin
+  echo "Append test $INPUT $SPLIT PASS"
+  return 0
+}
+
+# Test working out the digest of the input while encoding.  The digest should
+# be printed on stderr and the output should be the same as without it.
+testDigest() {
+  INPUT=$1
+  EXPECTED=$2
+  EDIGEST=$3
+
+  echo "Digest test $INPUT"
+  rm -f output.txt stdout.txt stderr.txt
+
+  echo "   ./encode ${args[@]} --digest $INPUT output.txt > stdout.txt 2> stderr.txt"
+  ./encode ${args[@]} --digest $INPUT output.txt > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 0 "$ASTATUS" ||
+     ! checkFile "Encoded output" "$EXPECTED" "output.txt" ||
+     ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkFile "Stderr output" "$EDIGEST" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  echo "Digest test $INPUT PASS"
+  return 0
+}
+
+# Test checking the digest of the decoded bytes.  If the digest doesn't match
+# then the output file should be removed.
+testVerify() {
+  INPUT=$1
+  EXPECTED=$2
+  DIGEST=$3
+  ESTATUS=$4
+  ESTDERR=$5
+
+  echo "Verify test $INPUT $DIGEST"
+  rm -f output.bin stdout.txt stderr.txt
+
+  echo "   ./decode ${args[@]} --verify $DIGEST $INPUT output.bin > stdout.txt 2> stderr.txt"
+  ./decode ${args[@]} --verify $DIGEST $INPUT output.bin > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus "$ESTATUS" "$ASTATUS" ||
+     ! checkFileOrMissing "Decoded output" "$EXPECTED" "output.bin" ||
+     ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkFileOrEmpty "Stderr output" "$ESTDERR" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  echo "Verify test $INPUT $DIGEST PASS"
+  return 0
+}
+
+# Test compressing with gzip while encoding and decompressing while decoding.
+# Decoding the encoded output should give back the original bytes.
+testGzip() {
   TESTNO=$1
+
+  echo "Gzip test $TESTNO"
+  rm -f output.txt output.bin stdout.txt stderr.txt
+
+  echo "   ./encode ${args[@]} --gzip original-$TESTNO.bin output.txt > stdout.txt 2> stderr.txt"
+  ./encode ${args[@]} --gzip original-$TESTNO.bin output.txt > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 0 "$ASTATUS" ||
+     ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkEmpty "Stderr output" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  echo "   ./decode --gzip output.txt output.bin > stdout.txt 2> stderr.txt"
+  ./decode --gzip output.txt output.bin > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 0 "$ASTATUS" ||
+     ! checkFile "Decoded output" "original-$TESTNO.bin" "output.bin" ||
+     ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkEmpty "Stderr output" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  echo "Gzip test $TESTNO PASS"
+  return 0
+}
+
+# Test using the same file as the input and the output.  The program should
+# fail without changing the file.
+testSame() {
+  PROGRAM=$1
+  INPUT=$2
+
+  echo "Same file $PROGRAM test $INPUT"
+  rm -f same.txt stdout.txt stderr.txt
+  cp $INPUT same.txt
+
+  echo "   ./$PROGRAM ${args[@]} same.txt same.txt > stdout.txt 2> stderr.txt"
+  ./$PROGRAM ${args[@]} same.txt same.txt > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 1 "$ASTATUS" ||
+     ! checkFile "Input file" "$INPUT" "same.txt" ||
+     ! checkEmpty "Stdout output" "stdout.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  if ! grep -q "^same.txt: The output file is the input file$" stderr.txt; then
+      fail "FAILED - same.txt should be reported in stderr.txt"
+      FAIL=1
+      return 1
+  fi
+
+  rm -f same.txt
+  echo "Same file $PROGRAM test $INPUT PASS"
+  return 0
+}
+
+# Test picking an engine that doesn't exist.  The program should fail without
+# writing the output, and print the engines that can be used.
+testEngine() {
+  PROGRAM=$1
+  INPUT=$2
+  ENGINE=$3
+
+  echo "Engine $PROGRAM test $ENGINE"
+  rm -f output.txt stdout.txt stderr.txt
+
+  echo "   BASE64_ENGINE=$ENGINE ./$PROGRAM $INPUT output.txt > stdout.txt 2> stderr.txt"
+  BASE64_ENGINE=$ENGINE ./$PROGRAM $INPUT output.txt > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 1 "$ASTATUS" || ! checkEmpty "Stdout output" "stdout.txt"; then
+      FAIL=1
+      return 1
+  fi
+  if [ -f output.txt ]; then
+      fail "FAILED - Output (output.txt) should not be created."
+      FAIL=1
+      return 1
+  fi
+  if ! grep -q "^BASE64_ENGINE=$ENGINE: .* scalar" stderr.txt; then
+      fail "FAILED - The engines that can be used should be printed in stderr.txt"
+      FAIL=1
+      return 1
+  fi
+
+  echo "Engine $PROGRAM test $ENGINE PASS"
+  return 0
+}
+
+# Test the decode program.  The arguments are the same as for testEncode.
+testDecode() {
+  INPUT=$1
+  EXPECTED=$2
+  ESTATUS=$3
+  ESTDERR=$4
+
+  echo "Decode test $INPUT"
+  rm -f output.bin stdout.txt stderr.txt
+
+  echo "   ./decode ${args[@]} $INPUT output.bin > stdout.txt 2> stderr.txt"
+  ./decode ${args[@]} $INPUT output.bin > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus "$ESTATUS" "$ASTATUS" ||
+     ! checkFileOrMissing "Decoded output" "$EXPECTED" "output.bin" ||
+     ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkFileOrEmpty "Stderr output" "$ESTDERR" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  echo "Decode test $INPUT PASS"
+  return 0
+}
+
+# Test encoding or decoding a batch of files in one run.  Each test number
+# gets a line in a manifest, and every output should match the expected file.
+# Files that can't be converted should each be reported on stderr.
+testBatch() {
+  PROGRAM=$1
   ESTATUS=$2
+  shift 2
+
+  echo "Batch $PROGRAM test $@"
+  rm -rf batch stdout.txt stderr.txt
+  mkdir batch
+  for TESTNO in "$@"; do
+      if [ "$PROGRAM" = encode ]; then
+          printf 'original-%s.bin\tbatch/%s\n' $TESTNO $TESTNO >> batch/manifest.txt
+      else
+          printf 'encoded-%s.txt\tbatch/%s\n' $TESTNO $TESTNO >> batch/manifest.txt
+      fi
+  done
+
+  echo "   ./$PROGRAM ${args[@]} --batch batch/manifest.txt > stdout.txt 2> stderr.txt"
+  ./$PROGRAM ${args[@]} --batch batch/manifest.txt > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus "$ESTATUS" "$ASTATUS" || ! checkEmpty "Stdout output" "stdout.txt"; then
+      FAIL=1
+      return 1
+  fi
+  for TESTNO in "$@"; do
+      if [ "$PROGRAM" = encode ]; then
+          INPUT=original-$TESTNO.bin
+          EXPECTED=encoded-$TESTNO.txt
+      else
+          INPUT=encoded-$TESTNO.txt
+          EXPECTED=original-$TESTNO.bin
+      fi
+      if ! checkFileOrMissing "Batch output" "$EXPECTED" "batch/$TESTNO"; then
+          FAIL=1
+          return 1
+      fi
+      if [ ! -f "$EXPECTED" ] && ! grep -q "^$INPUT: " stderr.txt; then
+          fail "FAILED - $INPUT should be reported in stderr.txt"
+          return 1
+      fi
+  done
+
+  rm -rf batch
+  echo "Batch $PROGRAM test $@ PASS"
+  return 0
+}
+
+# Test a batch with an output file that can't be created.  The output file
+# should be reported on stderr, not the input file.
+testBatchOutput() {
+  PROGRAM=$1
+  INPUT=$2
+
+  echo "Batch $PROGRAM output test $INPUT"
+  rm -rf batch stdout.txt stderr.txt
+  mkdir batch
+  printf '%s\tbatch/missing/out\n' $INPUT > batch/manifest.txt
+
+  echo "   ./$PROGRAM ${args[@]} --batch batch/manifest.txt > stdout.txt 2> stderr.txt"
+  ./$PROGRAM ${args[@]} --batch batch/manifest.txt > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 1 "$ASTATUS" || ! checkEmpty "Stdout output" "stdout.txt"; then
+      FAIL=1
+      return 1
+  fi
+  if ! grep -q "^batch/missing/out: " stderr.txt || grep -q "^$INPUT: " stderr.txt; then
+      fail "FAILED - batch/missing/out should be reported in stderr.txt instead of $INPUT"
+      FAIL=1
+      return 1
+  fi
+
+  rm -rf batch
+  echo "Batch $PROGRAM output test $INPUT PASS"
+  return 0
+}
+
+# Test encoding every file in a directory tree.  The files are copied into
+# a tree with a sub directory, and the same tree should be made with the
+# encoded files in the output directory, which can be inside the input tree.
+testTree() {
+  OUTDIR=$1
+  shift
+
+  echo "Tree encode test $OUTDIR $@"
+  rm -rf batch stdout.txt stderr.txt
+  mkdir -p batch/in/sub
+  for TESTNO in "$@"; do
+      cp original-$TESTNO.bin batch/in/$TESTNO
+      cp original-$TESTNO.bin batch/in/sub/$TESTNO
+  done
+
+  echo "   ./encode ${args[@]} --tree batch/in $OUTDIR > stdout.txt 2> stderr.txt"
+  ./encode ${args[@]} --tree batch/in $OUTDIR > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 0 "$ASTATUS" || ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkEmpty "Stderr output" "stderr.txt"; then
+      FAIL=1
+      return 1
+  fi
+  for TESTNO in "$@"; do
+      if ! checkFile "Tree output" "encoded-$TESTNO.txt" "$OUTDIR/$TESTNO" ||
+         ! checkFile "Tree output" "encoded-$TESTNO.txt" "$OUTDIR/sub/$TESTNO"; then
+          FAIL=1
+          return 1
+      fi
+  done
+  if [ -e "$OUTDIR/$(basename $OUTDIR)" ]; then
+      fail "FAILED - Tree output ($OUTDIR) should not be converted again"
+      FAIL=1
+      return 1
+  fi
+
+  rm -rf batch
+  echo "Tree encode test $OUTDIR $@ PASS"
+  return 0
+}
+
+# Test that --stats doesn't change the output, and prints one line of JSON
+# with the bytes in and out on stderr.
+testStats() {
+  PROGRAM=$1
+  INPUT=$2
+  EXPECTED=$3
 
-  echo "Encode test $TESTNO"
+  echo "Stats $PROGRAM test $INPUT"
   rm -f output.txt stdout.txt stderr.txt
 
-  echo "   ./encode ${args[@]} original-$TESTNO.bin output.txt > stdout.txt 2> stderr.txt"
-  ./encode ${args[@]} original-$TESTNO.bin output.txt > stdout.txt 2> stderr.txt
+  echo "   ./$PROGRAM --stats $INPUT output.txt > stdout.txt 2> stderr.txt"
+  ./$PROGRAM --stats $INPUT output.txt > stdout.txt 2> stderr.txt
   ASTATUS=$?
 
+  if ! checkStatus 0 "$ASTATUS" ||
+     ! checkFile "Output" "$EXPECTED" "output.txt" ||
+     ! checkEmpty "Stdout output" "stdout.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+  BYTES="\"bytes_in\":$(stat -c %s $INPUT),\"bytes_out\":$(stat -c %s $EXPECTED),"
+  if [ $(wc -l < stderr.txt) -ne 1 ] || ! grep -q "^{\"program\":\"$PROGRAM\".*$BYTES.*}$" stderr.txt; then
+      fail "FAILED - stderr.txt doesn't have the stats for $INPUT"
+      return 1
+  fi
+
+  echo "Stats $PROGRAM test $INPUT PASS"
+  return 0
+}
+
+# Test that "-" reads from the standard input and writes to the standard output
+# when the program is in the middle of a pipeline.
+testStream() {
+  PROGRAM=$1
+  INPUT=$2
+  EXPECTED=$3
+  ESTATUS=$4
+
+  echo "Stream $PROGRAM test $INPUT"
+  rm -f output.txt stdout.txt stderr.txt
+
+  echo "   cat $INPUT | ./$PROGRAM ${args[@]} - - 2> stderr.txt | cat > output.txt"
+  cat $INPUT | ./$PROGRAM ${args[@]} - - 2> stderr.txt | cat > output.txt
+  ASTATUS=${PIPESTATUS[1]}
+
   if ! checkStatus "$ESTATUS" "$ASTATUS" ||
-     ! checkFileOrMissing "Encoded output" "encoded-$TESTNO.txt" "output.txt" ||
+     ! checkFileOrEmpty "Output" "$EXPECTED" "output.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  echo "Stream $PROGRAM test $INPUT PASS"
+  return 0
+}
+
+# Test the digest of a decoded range.  The digest should be the one of the
+# bytes in the range, and checking the range against it should pass.
+testRangeDigest() {
+  INPUT=$1
+  ORIGINAL=$2
+  RANGE=$3
+  START=${RANGE%%:*}
+  LENGTH=${RANGE##*:}
+
+  echo "Range digest test $INPUT $RANGE"
+  rm -f output.bin output.txt range.bin range.txt digest.txt stdout.txt stderr.txt
+  tail -c +$((START + 1)) $ORIGINAL | head -c $LENGTH > range.bin
+  ./encode --digest-file range.txt range.bin output.txt
+
+  echo "   ./decode ${args[@]} --digest-file digest.txt --range $RANGE $INPUT output.bin > stdout.txt 2> stderr.txt"
+  ./decode ${args[@]} --digest-file digest.txt --range $RANGE $INPUT output.bin > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 0 "$ASTATUS" ||
+     ! checkFile "Decoded output" "range.bin" "output.bin" ||
+     ! checkEmpty "Stderr output" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  if [ "$(cut -d ' ' -f 4 digest.txt)" != "$(cut -d ' ' -f 4 range.txt)" ]; then
+      fail "FAILED - Digest (digest.txt) doesn't match the digest of the range (range.txt)"
+      FAIL=1
+      return 1
+  fi
+
+  echo "   ./decode ${args[@]} --verify range.txt --range $RANGE $INPUT output.bin > stdout.txt 2> stderr.txt"
+  ./decode ${args[@]} --verify range.txt --range $RANGE $INPUT output.bin > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 0 "$ASTATUS" ||
+     ! checkFile "Decoded output" "range.bin" "output.bin" ||
      ! checkEmpty "Stdout output" "stdout.txt" ||
-     ! checkFileOrEmpty "Stderr output" "expected-stderr-$TESTNO.txt" "stderr.txt"
+     ! checkEmpty "Stderr output" "stderr.txt"
   then
       FAIL=1
       return 1
   fi
 
-  echo "Encode test $TESTNO PASS"
+  rm -f range.bin range.txt digest.txt
+  echo "Range digest test $INPUT $RANGE PASS"
   return 0
 }
 
-# Test the decode program.
-testDecode() {
-  TESTNO=$1
+# Test checking an encoded file without decoding it.  Nothing should be
+# written, and the first error should be reported on stderr.
+testCheck() {
+  INPUT=$1
   ESTATUS=$2
+  ESTDERR=$3
 
-  echo "Decode test $TESTNO"
-  rm -f output.bin stdout.txt stderr.txt
+  echo "Check test $INPUT"
+  rm -f stdout.txt stderr.txt
 
-  echo "   ./decode ${args[@]} encoded-$TESTNO.txt output.bin > stdout.txt 2> stderr.txt"
-  ./decode ${args[@]} encoded-$TESTNO.txt output.bin > stdout.txt 2> stderr.txt
+  echo "   ./decode ${args[@]} --check $INPUT > stdout.txt 2> stderr.txt"
+  ./decode ${args[@]} --check $INPUT > stdout.txt 2> stderr.txt
   ASTATUS=$?
 
   if ! checkStatus "$ESTATUS" "$ASTATUS" ||
-     ! checkFileOrMissing "Decoded output" "original-$TESTNO.bin" "output.bin" ||
      ! checkEmpty "Stdout output" "stdout.txt" ||
-     ! checkFileOrEmpty "Stderr output" "expected-stderr-$TESTNO.txt" "stderr.txt"
+     ! checkFileOrEmpty "Stderr output" "$ESTDERR" "stderr.txt"
+  then
+      FAIL=1
+      return 1
+  fi
+
+  echo "Check test $INPUT PASS"
+  return 0
+}
+
+# Test decoding only a range of the bytes.  The output should match the same
+# range of the original file.
+testRange() {
+  INPUT=$1
+  ORIGINAL=$2
+  RANGE=$3
+  START=${RANGE%%:*}
+  LENGTH=${RANGE##*:}
+
+  echo "Range test $INPUT $RANGE"
+  rm -f output.bin range.bin stdout.txt stderr.txt
+  tail -c +$((START + 1)) $ORIGINAL | head -c $LENGTH > range.bin
+
+  echo "   ./decode ${args[@]} --range $RANGE $INPUT output.bin > stdout.txt 2> stderr.txt"
+  ./decode ${args[@]} --range $RANGE $INPUT output.bin > stdout.txt 2> stderr.txt
+  ASTATUS=$?
+
+  if ! checkStatus 0 "$ASTATUS" ||
+     ! checkFile "Decoded output" "range.bin" "output.bin" ||
+     ! checkEmpty "Stdout output" "stdout.txt" ||
+     ! checkEmpty "Stderr output" "stderr.txt"
   then
       FAIL=1
       return 1
   fi
 
-  echo "Decode test $TESTNO PASS"
+  rm -f range.bin
+  echo "Range test $INPUT $RANGE PASS"
   return 0
 }
 
@@ -178,34 +661,178 @@ fi
 # Test the encode program
 if [ -x encode ]; then
     args=()
-    testEncode 01 0
+    testEncode original-01.bin encoded-01.txt 0
     
     args=()
-    testEncode 02 0
+    testEncode original-02.bin encoded-02.txt 0
     
     args=()
-    testEncode 03 0
+    testEncode original-03.bin encoded-03.txt 0
     
     args=()
-    testEncode 04 0
+    testEncode original-04.bin encoded-04.txt 0
     
     args=()
-    testEncode 05 0
+    testEncode original-05.bin encoded-05.txt 0
     
     args=()
-    testEncode 06 0
+    testEncode original-06.bin encoded-06.txt 0
     
     args=()
-    testEncode 07 0
+    testEncode original-07.bin encoded-07.txt 0
     
     args=(-b -p)
-    testEncode 08 0
+    testEncode original-08.bin encoded-08.txt 0
     
     args=(-p -break)
-    testEncode 09 1
+    testEncode original-09.bin "" 1 expected-stderr-09.txt
+
+    args=(-j 4)
+    testEncode original-07.bin encoded-07.txt 0
+
+    args=(-b -j 3 -p)
+    testEncode original-08.bin encoded-08.txt 0
     
     args=()
-    testEncode 10 1
+    testEncode original-10.bin "" 1 expected-stderr-10.txt
+
+    args=(-w 64)
+    testEncode original-08.bin encoded-13.txt 0
+
+    args=(-w 64 --crlf -p)
+    testEncode original-14.bin encoded-14.txt 0
+
+    args=(-w 64 -j 2)
+    testEncode original-08.bin encoded-13.txt 0
+
+    args=(-j 3)
+    testBatch encode 0 01 02 03 04 05 06 07
+
+    args=(-j 2)
+    testBatch encode 1 01 10 05
+
+    args=()
+    testBatchOutput encode original-07.bin
+
+    args=()
+    testTree batch/out 01 05 07
+    testTree batch/in/out 01 05 07
+
+    testStats encode original-07.bin encoded-07.txt
+
+    args=()
+    testStream encode original-07.bin encoded-07.txt 0
+
+    args=(-w 64 --crlf -p)
+    testStream encode original-14.bin encoded-14.txt 0
+
+    # The stream tests use io_uring when the kernel has it, so read with stdio too
+    export BASE64_IO=stdio
+    args=()
+    testStream encode original-07.bin encoded-07.txt 0
+    unset BASE64_IO
+
+    args=(--url)
+    testEncode original-07.bin encoded-15.txt 0
+
+    args=(--alphabet imap)
+    testEncode original-14.bin encoded-17.txt 0
+
+    # Encode with the cache twice, the second time the output is copied from the cache
+    export BASE64_CACHE=cache
+    args=()
+    testEncode original-07.bin encoded-07.txt 0
+    testEncode original-07.bin encoded-07.txt 0
+
+    args=(-w 64)
+    testEncode original-08.bin encoded-13.txt 0
+    testEncode original-08.bin encoded-13.txt 0
+
+    args=(-b -p)
+    testEncode original-08.bin encoded-08.txt 0
+    testEncode original-08.bin encoded-08.txt 0
+
+    testStats encode original-07.bin encoded-07.txt
+    testStats encode original-07.bin encoded-07.txt
+
+    args=()
+    testEncode original-10.bin "" 1 expected-stderr-10.txt
+    unset BASE64_CACHE
+    rm -rf cache
+
+    args=()
+    testDigest original-07.bin encoded-07.txt expected-digest-07.txt
+
+    args=(-w 64)
+    testDigest original-08.bin encoded-13.txt expected-digest-08.txt
+
+    args=(--url)
+    testDigest original-07.bin encoded-15.txt expected-digest-07.txt
+
+    args=()
+    testSame encode original-07.bin
+
+    args=(--append)
+    testSame encode original-07.bin
+
+    args=(--gzip)
+    testSame encode original-07.bin
+
+    args=()
+    testGzip 07
+
+    args=()
+    testGzip 01
+
+    args=(-w 64)
+    testGzip 08
+
+    args=(--gzip -j 2)
+    testEncode original-07.bin "" 1 expected-stderr-09.txt
+
+    args=()
+    testAppend original-07.bin encoded-07.txt 0
+    testAppend original-07.bin encoded-07.txt 1
+    testAppend original-07.bin encoded-07.txt 56
+    testAppend original-07.bin encoded-07.txt 100000
+    testAppend original-05.bin encoded-05.txt 3
+
+    args=(-b -p)
+    testAppend original-08.bin encoded-08.txt 7
+
+    args=(-w 64 --crlf -p)
+    testAppend original-14.bin encoded-14.txt 47
+
+    args=(--url)
+    testAppend original-07.bin encoded-15.txt 4097
+
+    testEngine encode original-07.bin avx512
+
+    # Test each engine, skipping the ones the CPU doesn't support
+    for engine in scalar ssse3 avx2 avx512vbmi; do
+        if ! BASE64_ENGINE=$engine ./encode original-01.bin output.txt 2> /dev/null; then
+            echo "Engine $engine not supported by this CPU"
+            continue
+        fi
+        echo "Engine $engine"
+        export BASE64_ENGINE=$engine
+
+        args=()
+        testEncode original-05.bin encoded-05.txt 0
+
+        args=()
+        testEncode original-07.bin encoded-07.txt 0
+
+        args=(-b -p)
+        testEncode original-08.bin encoded-08.txt 0
+
+        args=(-w 64 --crlf -p)
+        testEncode original-14.bin encoded-14.txt 0
+
+        args=(--url)
+        testEncode original-07.bin encoded-15.txt 0
+    done
+    unset BASE64_ENGINE
 else
     fail "Since your encode program didn't compile, it couldn't be tested."
 fi
@@ -213,31 +840,212 @@ fi
 # Test the decode program
 if [ -x decode ]; then
     args=()
-    testDecode 01 0
+    testDecode encoded-01.txt original-01.bin 0
     
     args=()
-    testDecode 02 0
+    testDecode encoded-02.txt original-02.bin 0
     
     args=()
-    testDecode 03 0
+    testDecode encoded-03.txt original-03.bin 0
     
     args=()
-    testDecode 04 0
+    testDecode encoded-04.txt original-04.bin 0
     
     args=()
-    testDecode 05 0
+    testDecode encoded-05.txt original-05.bin 0
     
     args=()
-    testDecode 06 0
+    testDecode encoded-06.txt original-06.bin 0
     
     args=()
-    testDecode 07 0
+    testDecode encoded-07.txt original-07.bin 0
     
     args=()
-    testDecode 08 0
+    testDecode encoded-08.txt original-08.bin 0
     
     args=()
-    testDecode 11 1
+    testDecode encoded-11.txt "" 1 expected-stderr-11.txt
+
+    args=()
+    testDecode encoded-13.txt original-08.bin 0
+
+    args=(-j 4)
+    testDecode encoded-07.txt original-07.bin 0
+
+    args=(-j 2)
+    testDecode encoded-11.txt "" 1 expected-stderr-11.txt
+
+    args=(--url)
+    testDecode encoded-15.txt original-07.bin 0
+
+    args=(--url -j 3)
+    testDecode encoded-15.txt original-07.bin 0
+
+    args=(--url)
+    testDecode encoded-07.txt "" 1 expected-stderr-11.txt
+
+    args=(--alphabet imap)
+    testDecode encoded-17.txt original-14.bin 0
+
+    args=(--lenient)
+    testDecode encoded-18.txt original-07.bin 0
+
+    args=(--lenient -j 3)
+    testDecode encoded-18.txt original-07.bin 0
+
+    args=()
+    testDecode encoded-18.txt "" 1 expected-stderr-11.txt
+
+    args=(--lenient)
+    testDecode encoded-11.txt "" 1 expected-stderr-11.txt
+
+    args=()
+    testVerify encoded-07.txt original-07.bin expected-digest-07.txt 0
+    testVerify encoded-07.txt original-07.bin $(cut -d ' ' -f 4 expected-digest-07.txt) 0
+    testVerify encoded-13.txt "" expected-digest-07.txt 1 expected-verify-13.txt
+
+    args=(--url)
+    testVerify encoded-15.txt original-07.bin expected-digest-07.txt 0
+
+    args=(--lenient -j 3)
+    testVerify encoded-07.txt original-07.bin expected-digest-07.txt 0
+
+    args=(--gzip)
+    testDecode encoded-22.txt original-07.bin 0
+
+    args=(--gzip)
+    testDecode encoded-07.txt "" 1 expected-gzip-07.txt
+
+    args=(--gzip -j 2)
+    testDecode encoded-22.txt "" 1 expected-usage-22.txt
+
+    args=(--gzip)
+    testDecode encoded-11.txt "" 1 expected-stderr-11.txt
+
+    args=()
+    testSame decode encoded-07.txt
+
+    args=(-j 3)
+    testSame decode encoded-07.txt
+
+    args=(--range 0:10)
+    testSame decode encoded-07.txt
+
+    args=()
+    testCheck encoded-07.txt 0
+
+    args=()
+    testCheck encoded-11.txt 1 expected-check-11.txt
+
+    args=(--lenient)
+    testCheck encoded-18.txt 0
+
+    args=()
+    testCheck encoded-18.txt 1 expected-check-18.txt
+
+    args=()
+    testCheck encoded-20.txt 1 expected-check-20.txt
+
+    args=()
+    testCheck encoded-21.txt 1 expected-check-21.txt
+
+    args=(--url)
+    testCheck encoded-15.txt 0
+
+    args=()
+    testRange encoded-07.txt original-07.bin 0:10
+
+    args=()
+    testRange encoded-07.txt original-07.bin 1000:5000
+
+    args=()
+    testRange encoded-07.txt original-07.bin 269999:1000
+
+    args=()
+    testRange encoded-07.txt original-07.bin 300000:10
+
+    args=()
+    testRange encoded-13.txt original-08.bin 2:7
+
+    args=(--url)
+    testRange encoded-15.txt original-07.bin 4097:300
+
+    # Lines with other lengths are counted from the start, or from the index
+    args=(--lenient)
+    testRange encoded-18.txt original-07.bin 12345:678
+
+    ./decode --index encoded-18.txt
+    args=(--lenient)
+    testRange encoded-18.txt original-07.bin 200001:5000
+
+    args=()
+    testRangeDigest encoded-07.txt original-07.bin 1000:5000
+
+    args=(--lenient)
+    testRangeDigest encoded-18.txt original-07.bin 12345:678
+    rm -f encoded-18.txt.idx
+
+    testStats decode encoded-07.txt original-07.bin
+
+    args=()
+    testStream decode encoded-07.txt original-07.bin 0
+
+    args=()
+    testStream decode encoded-11.txt /dev/null 1
+
+    export BASE64_IO=stdio
+    args=()
+    testStream decode encoded-07.txt original-07.bin 0
+    testStream decode encoded-11.txt /dev/null 1
+    args=(--lenient)
+    testStream decode encoded-18.txt original-07.bin 0
+    unset BASE64_IO
+
+    args=(--lenient)
+    testStream decode encoded-18.txt original-07.bin 0
+
+    args=(-j 3)
+    testBatch decode 1 01 02 11 03 04 05 06 07 08
+
+    args=()
+    testBatchOutput decode encoded-07.txt
+
+    testEngine decode encoded-07.txt sse3
+
+    # Test each engine, skipping the ones the CPU doesn't support
+    for engine in scalar ssse3 avx2 avx512vbmi; do
+        if ! BASE64_ENGINE=$engine ./decode encoded-01.txt output.bin 2> /dev/null; then
+            echo "Engine $engine not supported by this CPU"
+            continue
+        fi
+        echo "Engine $engine"
+        export BASE64_ENGINE=$engine
+
+        args=()
+        testDecode encoded-07.txt original-07.bin 0
+
+        args=()
+        testDecode encoded-08.txt original-08.bin 0
+
+        args=()
+        testDecode encoded-11.txt "" 1 expected-stderr-11.txt
+
+        args=(--url)
+        testDecode encoded-15.txt original-07.bin 0
+
+        args=(--url)
+        testDecode encoded-07.txt "" 1 expected-stderr-11.txt
+
+        args=(--lenient)
+        testDecode encoded-18.txt original-07.bin 0
+
+        args=()
+        testCheck encoded-11.txt 1 expected-check-11.txt
+
+        args=()
+        testCheck encoded-20.txt 1 expected-check-20.txt
+    done
+    unset BASE64_ENGINE
 else
     fail "Since your encode program didn't compile, it couldn't be tested."
 fi
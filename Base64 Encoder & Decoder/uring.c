@@ -0,0 +1,362 @@
+/**
+ * @file uring.c
+ * @author Daniel Avisse (djavisse)
+ * This is the uring component. This component is used by the encode and decode programs
+ * when the input can't be mapped, like when it is a pipe, so the reads and writes happen
+ * while the chunks are being converted instead of one after the other. It talks to
+ * io_uring with the system calls directly, so it doesn't need liburing. The chunks go
+ * through a ring of buffers, and the reads and writes are queued on the io_uring
+ * submission queue and picked up from the completion queue once they are done. If the
+ * kernel doesn't support io_uring then nothing is read, and the programs fall back to
+ * reading with stdio.
+ */
+
+#include "uring.h"
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/** Number of entries in the submission queue, there is at most one read and one write */
+#define RING_ENTRIES 4
+
+/** Tag on the completions of reads */
+#define READ_TAG 0
+
+/** Tag on the completions of writes */
+#define WRITE_TAG 1
+
+/** Offset used to read or write at the current position of the file */
+#define CURRENT_POSITION ( ( uint64_t )-1 )
+
+/**
+ * This is the Ring struct. It holds the io_uring file descriptor and the queues that
+ * are shared with the kernel.
+ */
+typedef struct {
+  /** The io_uring file descriptor. */
+  int fd;
+
+  /** The tail of the submission queue, moved by this program. */
+  unsigned *sqTail;
+
+  /** The mask used to turn a position in the submission queue into an index. */
+  unsigned *sqMask;
+
+  /** The indexes of the submission queue entries, in the order they are submitted. */
+  unsigned *sqArray;
+
+  /** The submission queue entries. */
+  struct io_uring_sqe *sqes;
+
+  /** The head of the completion queue, moved by this program. */
+  unsigned *cqHead;
+
+  /** The tail of the completion queue, moved by the kernel. */
+  unsigned *cqTail;
+
+  /** The mask used to turn a position in the completion queue into an index. */
+  unsigned *cqMask;
+
+  /** The completion queue entries. */
+  struct io_uring_cqe *cqes;
+
+  /** The mapping of the submission queue, and of the completion queue if it is shared. */
+  void *sqRing;
+
+  /** The size of the mapping of the submission queue. */
+  size_t sqRingSize;
+
+  /** The mapping of the completion queue. */
+  void *cqRing;
+
+  /** The size of the mapping of the completion queue. */
+  size_t cqRingSize;
+
+  /** The size of the mapping of the submission queue entries. */
+  size_t sqesSize;
+
+  /** The number of entries queued that haven't been submitted yet. */
+  unsigned queued;
+} Ring;
+
+/**
+ * This is the UringSlot struct. It holds one chunk as it goes from being read to being
+ * written.
+ */
+typedef struct {
+  /** The bytes read from the input. */
+  byte *input;
+
+  /** The number of bytes read. */
+  size_t inLength;
+
+  /** The converted bytes. */
+  byte *output;
+
+  /** The number of converted bytes. */
+  size_t outLength;
+
+  /** The number of converted bytes written so far. */
+  size_t written;
+} UringSlot;
+
+/**
+ * This function is a helper function that sets up io_uring and maps its queues.
+ * @param ring The Ring being set up
+ * @return true If io_uring can be used
+ * @return false If the kernel doesn't support io_uring or doesn't allow it
+ */
+static bool initRing ( Ring *ring )
+{
+    struct io_uring_params params;
+    memset( &params, 0, sizeof( params ) );
+    ring->fd = syscall( __NR_io_uring_setup, RING_ENTRIES, &params );
+    if ( ring->fd < 0 ) {
+        return false;
+    }
+    //Reads and writes at the current position are needed for pipes
+    if ( !( params.features & IORING_FEAT_RW_CUR_POS ) ) {
+        close( ring->fd );
+        return false;
+    }
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+    //Newer kernels put both queues in one mapping
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if ( single && ring->cqRingSize > ring->sqRingSize ) {
+        ring->sqRingSize = ring->cqRingSize;
+    }
+    ring->sqRing = mmap( NULL, ring->sqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING );
+    ring->cqRing = ring->sqRing;
+    if ( !single && ring->sqRing != MAP_FAILED ) {
+        ring->cqRing = mmap( NULL, ring->cqRingSize, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING );
+    }
+    ring->sqesSize = params.sq_entries * sizeof( struct io_uring_sqe );
+    ring->sqes = ( struct io_uring_sqe * )mmap( NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+                                                MAP_SHARED | MAP_POPULATE, ring->fd,
+                                                IORING_OFF_SQES );
+    if ( ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED ||
+         ring->sqes == MAP_FAILED ) {
+        close( ring->fd );
+        return false;
+    }
+    byte *sq = ( byte * )ring->sqRing;
+    byte *cq = ( byte * )ring->cqRing;
+    ring->sqTail = ( unsigned * )( sq + params.sq_off.tail );
+    ring->sqMask = ( unsigned * )( sq + params.sq_off.ring_mask );
+    ring->sqArray = ( unsigned * )( sq + params.sq_off.array );
+    ring->cqHead = ( unsigned * )( cq + params.cq_off.head );
+    ring->cqTail = ( unsigned * )( cq + params.cq_off.tail );
+    ring->cqMask = ( unsigned * )( cq + params.cq_off.ring_mask );
+    ring->cqes = ( struct io_uring_cqe * )( cq + params.cq_off.cqes );
+    ring->queued = 0;
+    return true;
+}
+
+/**
+ * This function is a helper function that unmaps the queues and closes io_uring.
+ * @param ring The Ring being freed
+ */
+static void freeRing ( Ring *ring )
+{
+    munmap( ring->sqes, ring->sqesSize );
+    if ( ring->cqRing != ring->sqRing ) {
+        munmap( ring->cqRing, ring->cqRingSize );
+    }
+    munmap( ring->sqRing, ring->sqRingSize );
+    close( ring->fd );
+}
+
+/**
+ * This function is a helper function that queues a read or write at the current
+ * position of a file. It is only started once the queue is submitted.
+ * @param ring The Ring
+ * @param opcode IORING_OP_READ or IORING_OP_WRITE
+ * @param fd The file being read or written
+ * @param data The buffer being read into or written from
+ * @param length The number of bytes
+ * @param tag The tag given back with the completion
+ */
+static void queueRing ( Ring *ring, int opcode, int fd, void *data, size_t length,
+                        uint64_t tag )
+{
+    unsigned tail = *ring->sqTail;
+    unsigned index = tail & *ring->sqMask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset( sqe, 0, sizeof( *sqe ) );
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = ( uint64_t )( uintptr_t )data;
+    sqe->len = length;
+    sqe->off = CURRENT_POSITION;
+    sqe->user_data = tag;
+    ring->sqArray[index] = index;
+    //Let the kernel see the entry only once it has been filled in
+    __atomic_store_n( ring->sqTail, tail + 1, __ATOMIC_RELEASE );
+    ring->queued++;
+}
+
+/**
+ * This function is a helper function that submits the queued entries, and waits for a
+ * completion if asked to.
+ * @param ring The Ring
+ * @param wait True to wait until there is at least one completion
+ */
+static void enterRing ( Ring *ring, bool wait )
+{
+    if ( ring->queued == 0 && !wait ) {
+        return;
+    }
+    int submitted;
+    do {
+        submitted = syscall( __NR_io_uring_enter, ring->fd, ring->queued, wait ? 1 : 0,
+                             wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0 );
+    } while ( submitted < 0 && errno == EINTR );
+    if ( submitted < 0 ) {
+        perror( "io_uring_enter" );
+        exit( EXIT_FAILURE );
+    }
+    ring->queued -= submitted;
+}
+
+/**
+ * This function is a helper function that takes the next completion if there is one.
+ * @param ring The Ring
+ * @param tag Gets the tag of the read or write that finished
+ * @param result Gets the number of bytes, or a negative errno value
+ * @return true If there was a completion
+ * @return false If there are no completions waiting
+ */
+static bool reapRing ( Ring *ring, uint64_t *tag, int *result )
+{
+    unsigned head = *ring->cqHead;
+    if ( head == __atomic_load_n( ring->cqTail, __ATOMIC_ACQUIRE ) ) {
+        return false;
+    }
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+    *tag = cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n( ring->cqHead, head + 1, __ATOMIC_RELEASE );
+    return true;
+}
+
+int runUring ( int input, StreamWriter *writer, size_t chunkSize, ChunkFunction convert,
+               void *state, Stats *stats )
+{
+    Ring ring;
+    if ( !initRing( &ring ) ) {
+        return URING_UNAVAILABLE;
+    }
+    int output = fileno( writer->stream );
+    //Make the buffers for each chunk
+    UringSlot slots[URING_DEPTH];
+    for ( int i = 0; i < URING_DEPTH; i++ ) {
+        slots[i].input = ( byte * )malloc( chunkSize );
+        slots[i].output = ( byte * )malloc( writer->bufferSize );
+    }
+    //The chunks go through in order, so counting them is enough to know where each one is
+    size_t reads = 0;
+    size_t readsDone = 0;
+    size_t converted = 0;
+    size_t writes = 0;
+    size_t writesDone = 0;
+    int inFlight = 0;
+    bool end = false;
+    int status = 0;
+    while ( status == 0 ) {
+        //Start the next read once the last one is done and there is a free buffer
+        if ( !end && reads == readsDone && reads - writesDone < URING_DEPTH ) {
+            queueRing( &ring, IORING_OP_READ, input, slots[reads % URING_DEPTH].input,
+                       chunkSize, READ_TAG );
+            reads++;
+            inFlight++;
+        }
+        //Skip the chunks with nothing to write, then start the next write
+        while ( writes == writesDone && writes < converted &&
+                slots[writes % URING_DEPTH].outLength == 0 ) {
+            writes++;
+            writesDone++;
+        }
+        if ( writes == writesDone && writes < converted ) {
+            UringSlot *slot = &slots[writes % URING_DEPTH];
+            queueRing( &ring, IORING_OP_WRITE, output, slot->output + slot->written,
+                       slot->outLength - slot->written, WRITE_TAG );
+            writes++;
+            inFlight++;
+        }
+        enterRing( &ring, false );
+        //Convert the next chunk that has been read while the reads and writes go on
+        if ( converted < readsDone ) {
+            UringSlot *slot = &slots[converted % URING_DEPTH];
+            size_t count = 0;
+            if ( !convert( state, slot->input, slot->inLength, slot->output, &count ) ) {
+                status = URING_INVALID;
+                break;
+            }
+            slot->outLength = count;
+            slot->written = 0;
+            stats->bytesOut += count;
+            converted++;
+            continue;
+        }
+        //Stop once everything has been read, converted and written
+        if ( end && converted == readsDone && writesDone == converted ) {
+            break;
+        }
+        //Otherwise wait for a read or write to finish
+        switchPhase( stats, reads > readsDone ? PHASE_READ : PHASE_WRITE );
+        enterRing( &ring, true );
+        switchPhase( stats, PHASE_CONVERT );
+        uint64_t tag;
+        int result;
+        while ( reapRing( &ring, &tag, &result ) ) {
+            inFlight--;
+            //Try again if the read or write was interrupted
+            bool retry = result == -EINTR || result == -EAGAIN;
+            if ( result < 0 && !retry ) {
+                errno = -result;
+                perror( tag == READ_TAG ? "read" : "write" );
+                status = URING_FAILED;
+            } else if ( tag == READ_TAG ) {
+                //Nothing was read, so the end of the input has been reached
+                if ( retry || result == 0 ) {
+                    end = result == 0;
+                    reads--;
+                } else {
+                    slots[readsDone % URING_DEPTH].inLength = result;
+                    stats->bytesIn += result;
+                    readsDone++;
+                }
+            } else {
+                //Write the rest of the chunk if only part of it was written
+                UringSlot *slot = &slots[writesDone % URING_DEPTH];
+                slot->written += retry ? 0 : result;
+                if ( slot->written < slot->outLength ) {
+                    writes--;
+                } else {
+                    writesDone++;
+                }
+            }
+        }
+    }
+    //Wait for the reads and writes still in flight before the buffers are freed
+    while ( inFlight > 0 ) {
+        enterRing( &ring, true );
+        uint64_t tag;
+        int result;
+        while ( reapRing( &ring, &tag, &result ) ) {
+            inFlight--;
+        }
+    }
+    for ( int i = 0; i < URING_DEPTH; i++ ) {
+        free( slots[i].input );
+        free( slots[i].output );
+    }
+    freeRing( &ring );
+    return status;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file uring.h
+ * @author Daniel Avisse (djavisse)
+ * This is the header file for the uring.c component. In this file it contains all the
+ * constants, types and protypes used in uring.c
+ */
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include stream to get the StreamWriter the output is written with.
+#include "stream.h"
+
+// Include stats to count the time and bytes used while reading and converting.
+#include "stats.h"
+
+/** Name of the environment variable that can be set to stdio to not use io_uring */
+#define IO_VARIABLE "BASE64_IO"
+
+/** The value of the IO_VARIABLE that turns off io_uring */
+#define STDIO_BACKEND "stdio"
+
+/** Number of chunks that can be read, converted and written at the same time */
+#define URING_DEPTH 4
+
+/** Returned by runUring when the convert function finds the input isn't valid */
+#define URING_INVALID -1
+
+/** Returned by runUring when io_uring can't be used, before anything was read */
+#define URING_UNAVAILABLE -2
+
+/** Returned by runUring when a read or write failed, after printing the error */
+#define URING_FAILED -3
+
+/**
+ * This is the ChunkFunction type. It converts one chunk of the input into the output
+ * buffer, keeping anything it needs for the next chunk in its state.
+ * @param state The state passed to runUring
+ * @param data The bytes of the chunk
+ * @param length The number of bytes in the chunk
+ * @param output The buffer that gets the converted bytes
+ * @param outCount Gets the number of bytes put in the output buffer
+ * @return true If the chunk was converted
+ * @return false If the chunk wasn't valid
+ */
+typedef bool ( *ChunkFunction )( void *state, byte const data[], size_t length,
+                                 byte output[], size_t *outCount );
+
+/**
+ * This function converts a whole input stream using io_uring, so reading, converting
+ * and writing overlap. The chunks go through a ring of URING_DEPTH buffers: while one
+ * chunk is being converted the next one is being read and the one before it is being
+ * written. Only one read and one write are in flight at a time, so the bytes stay in
+ * order even when the input or output is a pipe. Anything left in the state at the end
+ * is finished by the caller, once everything before it has been written.
+ * @param input The file descriptor of the input
+ * @param writer The StreamWriter for the output, its buffer size is the room each
+ * chunk has for its converted bytes
+ * @param chunkSize The number of bytes read at a time
+ * @param convert The function used to convert each chunk
+ * @param state The state passed to the convert function
+ * @param stats The stats kept for --stats
+ * @return int Zero if the input was converted, otherwise URING_INVALID,
+ * URING_UNAVAILABLE or URING_FAILED
+ */
+int runUring ( int input, StreamWriter *writer, size_t chunkSize, ChunkFunction convert,
+               void *state, Stats *stats );
+
+#endif